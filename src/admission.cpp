@@ -0,0 +1,139 @@
+#include "admission.h"
+#include <string.h>
+#include <vector>
+
+AdmissionScheduler::AdmissionScheduler(size_t window, Order order, Dispatch dispatch)
+    : window_(window ? window : 1), order_(order), dispatch_(dispatch) {
+}
+
+void AdmissionScheduler::submit(size_t index, int priority) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopped_) {
+            return;
+        }
+        if (in_flight_ >= window_) {
+            int level = order_ == ORDER_FIFO ? 0 : (priority < 0 ? 0 : (priority >= kLevels ? kLevels - 1 : priority));
+            queues_[level].push_back(index);
+            ++ queued_;
+            if (++ depth_ > max_depth_) {
+                max_depth_ = depth_;
+            }
+            return;
+        }
+        ++ in_flight_;
+        ++ dispatching_;
+    }
+    dispatch(index);
+}
+
+void AdmissionScheduler::complete() {
+    size_t index;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        -- in_flight_;
+        if (stopped_ || in_flight_ >= window_ || !popLocked(&index)) {
+            return;
+        }
+        ++ in_flight_;
+        ++ dispatching_;
+    }
+    dispatch(index);
+}
+
+bool AdmissionScheduler::tryAcquire() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopped_ || in_flight_ >= window_) {
+        return false;
+    }
+    ++ in_flight_;
+    return true;
+}
+
+bool AdmissionScheduler::popLocked(size_t* index) {
+    for (int level = kLevels - 1; level >= 0; -- level) {
+        if (!queues_[level].empty()) {
+            *index = queues_[level].front();
+            queues_[level].pop_front();
+            -- depth_;
+            return true;
+        }
+    }
+    return false;
+}
+
+void AdmissionScheduler::dispatch(size_t index) {
+    dispatch_(index);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (-- dispatching_ == 0 && stopped_) {
+        idle_.notify_all();
+    }
+}
+
+size_t AdmissionScheduler::stop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stopped_ = true;
+    idle_.wait(lock, [this]() { return dispatching_ == 0; });
+    size_t dropped = depth_;
+    for (int level = 0; level < kLevels; ++ level) {
+        queues_[level].clear();
+    }
+    depth_ = 0;
+    return dropped;
+}
+
+void AdmissionScheduler::setWindow(size_t window) {
+    std::vector<size_t> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        window_ = window ? window : 1;
+        size_t index;
+        while (!stopped_ && in_flight_ < window_ && popLocked(&index)) {
+            ready.push_back(index);
+            ++ in_flight_;
+            ++ dispatching_;
+        }
+    }
+    for (size_t i = 0; i < ready.size(); ++ i) {
+        dispatch(ready[i]);
+    }
+}
+
+size_t AdmissionScheduler::window() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return window_;
+}
+
+size_t AdmissionScheduler::inFlight() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return in_flight_;
+}
+
+uint64_t AdmissionScheduler::queued() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queued_;
+}
+
+size_t AdmissionScheduler::maxDepth() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return max_depth_;
+}
+
+void AdmissionScheduler::report(std::ostream& os) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    os << "admission: window=" << window_ << " order=" << (order_ == ORDER_FIFO ? "fifo" : "priority")
+       << " queued=" << queued_ << " max_depth=" << max_depth_ << std::endl;
+}
+
+bool AdmissionScheduler::parseOrder(const char* name, Order* out) {
+    if (strcmp(name, "priority") == 0) {
+        *out = ORDER_PRIORITY;
+    }
+    else if (strcmp(name, "fifo") == 0) {
+        *out = ORDER_FIFO;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,72 @@
+#ifndef CRONET_CONN_STAT_ADMISSION_H
+#define CRONET_CONN_STAT_ADMISSION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <ostream>
+
+// 本地准入：最多 window 个请求在飞，窗口满时新请求在本地排队，有请求结束时放行下一个。
+// 按优先级时先放行高优先级的队列，同优先级先到先出；fifo 时忽略优先级，用来对比。
+// 放行在调用 submit/complete 的线程上进行（complete 通常在回调线程上），不持锁
+class AdmissionScheduler {
+public:
+    enum Order {
+        ORDER_PRIORITY,
+        ORDER_FIFO,
+    };
+    // index 为请求序号，由调用方发起该请求
+    typedef std::function<void(size_t index)> Dispatch;
+
+    AdmissionScheduler(size_t window, Order order, Dispatch dispatch);
+
+    // 提交请求，priority 为 Cronet_UrlRequestParams_REQUEST_PRIORITY
+    void submit(size_t index, int priority);
+    // 一个已放行的请求结束
+    void complete();
+    // 窗口有空位时直接占一个（不排队），用完后调 complete；已满或已停止时返回 false
+    bool tryAcquire();
+    // 不再放行，等正在放行的调用返回；返回仍在排队、不会再发起的请求数
+    size_t stop();
+    // 调整窗口（自适应限流用），变大时立即放行排队的请求，变小时等在飞的请求结束后生效
+    void setWindow(size_t window);
+
+    size_t window() const;
+    size_t inFlight() const;
+    Order order() const { return order_; }
+    // 提交时窗口已满、进过本地队列的请求数
+    uint64_t queued() const;
+    size_t maxDepth() const;
+
+    void report(std::ostream& os) const;
+
+    static bool parseOrder(const char* name, Order* out);
+
+private:
+    AdmissionScheduler(const AdmissionScheduler&);
+    AdmissionScheduler& operator=(const AdmissionScheduler&);
+
+    static const int kLevels = 5;
+
+    // 在锁内取出下一个可放行的请求
+    bool popLocked(size_t* index);
+    void dispatch(size_t index);
+
+    size_t window_;
+    const Order order_;
+    Dispatch dispatch_;
+    mutable std::mutex mutex_;
+    std::condition_variable idle_;
+    std::deque<size_t> queues_[kLevels];     // ORDER_FIFO 时只用 queues_[0]
+    size_t depth_ = 0;
+    size_t max_depth_ = 0;
+    size_t in_flight_ = 0;
+    size_t dispatching_ = 0;
+    uint64_t queued_ = 0;
+    bool stopped_ = false;
+};
+
+#endif // CRONET_CONN_STAT_ADMISSION_H
@@ -0,0 +1,412 @@
+#include "bidi_bench.h"
+#include "executor_thread.h"
+#include "timer_thread.h"
+#include <cronet/bidirectional_stream_c.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+static uint64_t elapsed_us(Clock::time_point since) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - since).count();
+}
+
+class BidiBench;
+
+// 一个流的状态，只在压测的执行器线程上访问
+struct StreamState {
+    BidiBench* bench = nullptr;
+    bidirectional_stream* stream = nullptr;
+    std::vector<char> write_buffers;        // window 条消息的槽位，第 n 条用 n % window
+    std::vector<char> read_buffer;
+    std::deque<Clock::time_point> in_flight;
+    uint64_t sent = 0;
+    uint64_t partial = 0;                   // 下一条消息已读到的字节数
+    Clock::time_point started;
+    bool ended = false;                     // 已写 end_of_stream
+    bool finished = false;
+    // 批量写：in_flight 末尾 pending 条已 write 未 flush
+    size_t pending = 0;
+    size_t pending_bytes = 0;
+    uint64_t flushes = 0;                   // 用来识别过期的超时 flush
+    bool timer_armed = false;
+};
+
+class BidiBench {
+public:
+    BidiBench(Cronet_EnginePtr engine, const BidiBenchOptions& options);
+    ~BidiBench();
+
+    bool run(BidiBenchResult* result);
+
+    // 网络线程上的回调转到执行器线程
+    void post(std::function<void()> task) { executor_.postTask(std::move(task)); }
+
+    void onReady(StreamState* s);
+    void onHeaders(const std::string& protocol);
+    void onRead(StreamState* s, int bytes);
+    void onFinished(StreamState* s, bool ok);
+    void onFlushTimer(StreamState* s, uint64_t flushes);
+
+private:
+    bool canSend(const StreamState* s) const;
+    void fillWindow(StreamState* s);
+    void write(StreamState* s, const char* buffer, size_t size, bool end_of_stream);
+    void flush(StreamState* s);
+    void endStream(StreamState* s);
+
+    Cronet_EnginePtr engine_;
+    BidiBenchOptions options_;
+    bidirectional_stream_header_array headers_;
+    std::vector<bidirectional_stream_header> header_items_;
+    std::vector<std::unique_ptr<StreamState>> streams_;
+    ExecutorThread executor_;
+    Clock::time_point begin_;
+    Clock::time_point deadline_;
+
+    // 以下只在执行器线程上写
+    std::string protocol_;
+    uint64_t messages_ = 0;
+    uint64_t bytes_written_ = 0;
+    uint64_t bytes_read_ = 0;
+    uint64_t ok_ = 0;
+    uint64_t failed_ = 0;
+    LatencyHistogram rtt_;
+    LatencyHistogram ready_;
+    uint64_t writes_ = 0;
+    uint64_t flushes_ = 0;
+    LatencyHistogram batch_delay_;
+    TimerThread timer_;            // 批量写的超时 flush，到期时把任务投回执行器
+
+    std::mutex mutex_;
+    std::condition_variable idle_;
+    size_t active_ = 0;
+    Clock::time_point end_;
+};
+
+static StreamState* state_of(bidirectional_stream* stream) {
+    return (StreamState*)stream->annotation;
+}
+
+static void on_stream_ready(bidirectional_stream* stream) {
+    StreamState* s = state_of(stream);
+    s->bench->post([s]() { s->bench->onReady(s); });
+}
+
+static void on_response_headers_received(bidirectional_stream* stream, const bidirectional_stream_header_array*,
+                                         const char* negotiated_protocol) {
+    StreamState* s = state_of(stream);
+    std::string protocol = negotiated_protocol ? negotiated_protocol : "";
+    s->bench->post([s, protocol]() { s->bench->onHeaders(protocol); });
+}
+
+static void on_read_completed(bidirectional_stream* stream, char*, int bytes_read) {
+    StreamState* s = state_of(stream);
+    s->bench->post([s, bytes_read]() { s->bench->onRead(s, bytes_read); });
+}
+
+static void on_write_completed(bidirectional_stream*, const char*) {
+}
+
+static void on_response_trailers_received(bidirectional_stream*, const bidirectional_stream_header_array*) {
+}
+
+static void on_succeded(bidirectional_stream* stream) {
+    StreamState* s = state_of(stream);
+    s->bench->post([s]() { s->bench->onFinished(s, true); });
+}
+
+static void on_failed(bidirectional_stream* stream, int) {
+    StreamState* s = state_of(stream);
+    s->bench->post([s]() { s->bench->onFinished(s, false); });
+}
+
+static void on_canceled(bidirectional_stream* stream) {
+    StreamState* s = state_of(stream);
+    s->bench->post([s]() { s->bench->onFinished(s, false); });
+}
+
+static bidirectional_stream_callback kCallbacks = {
+    on_stream_ready,
+    on_response_headers_received,
+    on_read_completed,
+    on_write_completed,
+    on_response_trailers_received,
+    on_succeded,
+    on_failed,
+    on_canceled,
+};
+
+BidiBench::BidiBench(Cronet_EnginePtr engine, const BidiBenchOptions& options)
+    : engine_(engine), options_(options), executor_("bidi-executor") {
+    options_.window = std::max<size_t>(options_.window, 1);
+    options_.message_bytes = std::max<size_t>(options_.message_bytes, 1);
+    for (size_t i = 0; i < options_.headers.size(); ++ i) {
+        bidirectional_stream_header h = {options_.headers[i].first.c_str(), options_.headers[i].second.c_str()};
+        header_items_.push_back(h);
+    }
+    headers_.count = header_items_.size();
+    headers_.capacity = header_items_.size();
+    headers_.headers = header_items_.empty() ? nullptr : header_items_.data();
+}
+
+BidiBench::~BidiBench() {
+}
+
+bool BidiBench::canSend(const StreamState* s) const {
+    if (options_.messages > 0) {
+        return s->sent < options_.messages;
+    }
+    return Clock::now() < deadline_;
+}
+
+void BidiBench::fillWindow(StreamState* s) {
+    const size_t size = options_.message_bytes;
+    while (!s->ended && s->in_flight.size() < options_.window && canSend(s)) {
+        // 槽位上一条消息的回显已读完，写缓冲可以复用
+        const char* buffer = s->write_buffers.data() + (s->sent % options_.window) * size;
+        s->in_flight.push_back(Clock::now());
+        ++ s->sent;
+        bytes_written_ += size;
+        write(s, buffer, size, false);
+    }
+    if (!s->ended && s->in_flight.empty() && !canSend(s)) {
+        endStream(s);
+    }
+    if (s->pending == 0) {
+        return;
+    }
+    // 不会再有新消息，或者只按字节攒而窗口已满（回显要等这批发出去才回来），立即 flush；
+    // 否则等超时，期间读回来的回显腾出的槽位可以继续攒进这一批
+    if (s->ended || (options_.batch_us == 0 && s->in_flight.size() >= options_.window)) {
+        flush(s);
+    }
+    else if (options_.batch_us > 0 && !s->timer_armed) {
+        s->timer_armed = true;
+        uint64_t flushes = s->flushes;
+        timer_.schedule(Clock::now() + std::chrono::microseconds(options_.batch_us),
+                        [this, s, flushes]() { post([this, s, flushes]() { onFlushTimer(s, flushes); }); });
+    }
+}
+
+void BidiBench::write(StreamState* s, const char* buffer, size_t size, bool end_of_stream) {
+    ++ writes_;
+    bidirectional_stream_write(s->stream, buffer, (int)size, end_of_stream);
+    if (!options_.batching()) {
+        // 自动 flush，每次 write 都 flush 一次
+        ++ flushes_;
+        return;
+    }
+    ++ s->pending;
+    s->pending_bytes += size;
+    if (options_.batch_bytes > 0 && s->pending_bytes >= options_.batch_bytes) {
+        flush(s);
+    }
+}
+
+void BidiBench::flush(StreamState* s) {
+    if (s->pending == 0) {
+        return;
+    }
+    // 这一批消息在 in_flight 末尾，记录它们等 flush 的时间；end_of_stream 不对应消息
+    Clock::time_point now = Clock::now();
+    size_t messages = std::min(s->pending, s->in_flight.size());
+    for (size_t i = s->in_flight.size() - messages; i < s->in_flight.size(); ++ i) {
+        batch_delay_.record((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(now - s->in_flight[i]).count());
+    }
+    bidirectional_stream_flush(s->stream);
+    ++ flushes_;
+    ++ s->flushes;
+    s->pending = 0;
+    s->pending_bytes = 0;
+    s->timer_armed = false;
+}
+
+void BidiBench::onFlushTimer(StreamState* s, uint64_t flushes) {
+    // 到期前已经按字节或窗口 flush 过的是过期任务
+    if (s->finished || s->flushes != flushes) {
+        return;
+    }
+    flush(s);
+}
+
+void BidiBench::endStream(StreamState* s) {
+    s->ended = true;
+    write(s, s->write_buffers.data(), 0, true);
+}
+
+void BidiBench::onReady(StreamState* s) {
+    if (s->finished) {
+        return;
+    }
+    ready_.record(elapsed_us(s->started));
+    bidirectional_stream_read(s->stream, s->read_buffer.data(), (int)s->read_buffer.size());
+    fillWindow(s);
+}
+
+void BidiBench::onHeaders(const std::string& protocol) {
+    if (protocol_.empty()) {
+        protocol_ = protocol;
+    }
+}
+
+void BidiBench::onRead(StreamState* s, int bytes) {
+    if (s->finished || bytes <= 0) {
+        // 服务端已结束响应，随后回调 on_succeded
+        return;
+    }
+    bytes_read_ += bytes;
+    s->partial += bytes;
+    Clock::time_point now = Clock::now();
+    while (s->partial >= options_.message_bytes && !s->in_flight.empty()) {
+        s->partial -= options_.message_bytes;
+        rtt_.record((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(now - s->in_flight.front()).count());
+        s->in_flight.pop_front();
+        ++ messages_;
+    }
+    fillWindow(s);
+    bidirectional_stream_read(s->stream, s->read_buffer.data(), (int)s->read_buffer.size());
+}
+
+void BidiBench::onFinished(StreamState* s, bool ok) {
+    if (s->finished) {
+        return;
+    }
+    s->finished = true;
+    ++ (ok ? ok_ : failed_);
+    if (s->stream) {
+        bidirectional_stream_destroy(s->stream);
+        s->stream = nullptr;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (-- active_ == 0) {
+        end_ = Clock::now();
+        idle_.notify_all();
+    }
+}
+
+bool BidiBench::run(BidiBenchResult* result) {
+    stream_engine* se = Cronet_Engine_GetStreamEngine(engine_);
+    const size_t window = options_.window;
+    const size_t size = options_.message_bytes;
+    // 读缓冲至少放得下一条消息，最多 64KB
+    const size_t read_size = std::min<size_t>(std::max<size_t>(size, 4096), 64 * 1024);
+    for (size_t i = 0; i < options_.streams; ++ i) {
+        streams_.push_back(std::unique_ptr<StreamState>(new StreamState));
+        StreamState* s = streams_.back().get();
+        s->bench = this;
+        s->write_buffers.assign(window * size, 'x');
+        s->read_buffer.resize(read_size);
+        s->stream = bidirectional_stream_create(se, s, &kCallbacks);
+        if (s->stream && options_.batching()) {
+            // 请求头留到第一次 flush 与数据同包发出
+            bidirectional_stream_disable_auto_flush(s->stream, true);
+            bidirectional_stream_delay_request_headers_until_flush(s->stream, true);
+        }
+        else if (s->stream) {
+            // 请求头单独 flush 一次
+            ++ flushes_;
+        }
+    }
+
+    begin_ = Clock::now();
+    deadline_ = begin_ + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options_.duration_s));
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        active_ = streams_.size();
+    }
+    for (size_t i = 0; i < streams_.size(); ++ i) {
+        StreamState* s = streams_[i].get();
+        s->started = Clock::now();
+        if (!s->stream || bidirectional_stream_start(s->stream, options_.url.c_str(), 0, options_.method.c_str(),
+                                                     &headers_, false) != 0) {
+            post([this, s]() { onFinished(s, false); });
+        }
+    }
+
+    bool completed = true;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!idle_.wait_for(lock, std::chrono::seconds(options_.timeout_s), [this]() { return active_ == 0; })) {
+            completed = false;
+        }
+    }
+    if (!completed) {
+        // 超时：取消还在跑的流，等它们的 on_canceled
+        post([this]() {
+            for (size_t i = 0; i < streams_.size(); ++ i) {
+                if (!streams_[i]->finished && streams_[i]->stream) {
+                    bidirectional_stream_cancel(streams_[i]->stream);
+                }
+            }
+        });
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_.wait_for(lock, std::chrono::seconds(5), [this]() { return active_ == 0; });
+    }
+
+    // 在执行器线程上取结果，之后不会再有该流的任务
+    std::mutex done_mutex;
+    std::condition_variable done;
+    bool collected = false;
+    post([&]() {
+        result->protocol = protocol_;
+        result->streams_ok = ok_;
+        result->streams_failed = failed_;
+        result->messages = messages_;
+        result->bytes_written = bytes_written_;
+        result->bytes_read = bytes_read_;
+        result->rtt = rtt_.snapshot();
+        result->ready = ready_.snapshot();
+        result->batching = options_.batching();
+        result->writes = writes_;
+        result->flushes = flushes_;
+        result->batch_delay = batch_delay_.snapshot();
+        std::lock_guard<std::mutex> lock(done_mutex);
+        collected = true;
+        done.notify_all();
+    });
+    std::unique_lock<std::mutex> lock(done_mutex);
+    done.wait(lock, [&]() { return collected; });
+    Clock::time_point end = completed ? end_ : Clock::now();
+    result->seconds = std::chrono::duration<double>(end - begin_).count();
+    return completed;
+}
+
+} // namespace
+
+bool run_bidi_bench(Cronet_EnginePtr engine, const BidiBenchOptions& options, BidiBenchResult* result) {
+    BidiBench bench(engine, options);
+    return bench.run(result);
+}
+
+void print_bidi_result(std::ostream& os, const BidiBenchResult& r) {
+    std::ios::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << "==== bidirectional streams ====" << std::endl;
+    os << std::fixed << std::setprecision(2);
+    os << "streams: ok=" << r.streams_ok << " failed=" << r.streams_failed
+       << " protocol=" << (r.protocol.empty() ? "-" : r.protocol) << std::endl;
+    double mb = 1024.0 * 1024.0;
+    os << "messages: " << r.messages << " in " << r.seconds << " s, "
+       << (r.seconds > 0 ? r.messages / r.seconds : 0.0) << " msg/s" << std::endl;
+    os << "bytes: written=" << r.bytes_written << " read=" << r.bytes_read << ", "
+       << (r.seconds > 0 ? r.bytes_written / mb / r.seconds : 0.0) << " MB/s up "
+       << (r.seconds > 0 ? r.bytes_read / mb / r.seconds : 0.0) << " MB/s down" << std::endl;
+    // 这里只数调用，一次 flush 实际发出几个帧、几次写 socket 由网络栈决定
+    os << "flushes: writes=" << r.writes << " flush calls=" << r.flushes << " ("
+       << (r.flushes ? (double)r.writes / r.flushes : 0.0) << " writes/flush)" << std::endl;
+    print_percentiles(os, "stream ready", r.ready);
+    print_percentiles(os, "message rtt", r.rtt);
+    if (r.batching) {
+        print_percentiles(os, "batch delay", r.batch_delay);
+    }
+    os.flags(flags);
+    os.precision(precision);
+}
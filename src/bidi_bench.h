@@ -0,0 +1,54 @@
+#ifndef CRONET_CONN_STAT_BIDI_BENCH_H
+#define CRONET_CONN_STAT_BIDI_BENCH_H
+
+#include "histogram.h"
+#include <cronet/cronet_c.h>
+#include <stdint.h>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// 双向流压测参数：streams 个流同时跑，每个流保持 window 条消息在途（已写、回显未读完）
+struct BidiBenchOptions {
+    std::string url;
+    std::string method = "POST";
+    std::vector<std::pair<std::string, std::string>> headers;
+    size_t streams = 1;
+    size_t message_bytes = 1024;
+    size_t window = 1;
+    uint64_t messages = 0;      // 每个流发送的消息数，0 时按 duration_s
+    double duration_s = 0;
+    int timeout_s = 60;
+    // 批量写：关掉自动 flush 并延迟请求头，攒够 batch_bytes 字节或最早一条等了 batch_us 微秒再 flush，
+    // 请求头随第一批数据一起发出。两者都为 0 时每次 write 单独成帧
+    size_t batch_bytes = 0;
+    uint64_t batch_us = 0;
+
+    bool batching() const { return batch_bytes > 0 || batch_us > 0; }
+};
+
+struct BidiBenchResult {
+    std::string protocol;
+    uint64_t streams_ok = 0;
+    uint64_t streams_failed = 0;
+    uint64_t messages = 0;          // 回显读完的消息数
+    uint64_t bytes_written = 0;
+    uint64_t bytes_read = 0;
+    double seconds = 0;
+    HistogramSnapshot rtt;          // 写入到回显读完，微秒
+    HistogramSnapshot ready;        // start 到 on_stream_ready，微秒
+    bool batching = false;
+    uint64_t writes = 0;            // bidirectional_stream_write 次数，含 end_of_stream
+    uint64_t flushes = 0;           // flush 次数；自动 flush 时每次 write 与单独发的请求头各算一次
+    HistogramSnapshot batch_delay;  // 批量写时每条消息从 write 到 flush 的等待，微秒
+};
+
+// 在 engine 的 stream_engine 上开双向流，循环写消息并读回显，服务端需要原样回显请求体。
+// 回调在网络线程上到达后转到压测自己的执行器线程处理；写缓冲与读缓冲按流预分配并复用。
+// 超时仍未结束的流会被取消，返回 false
+bool run_bidi_bench(Cronet_EnginePtr engine, const BidiBenchOptions& options, BidiBenchResult* result);
+
+void print_bidi_result(std::ostream& os, const BidiBenchResult& result);
+
+#endif // CRONET_CONN_STAT_BIDI_BENCH_H
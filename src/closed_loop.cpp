@@ -0,0 +1,77 @@
+#include "closed_loop.h"
+#include <iomanip>
+
+ClosedLoop::ClosedLoop(size_t concurrency, uint64_t max_requests, double duration_s)
+    : concurrency_(concurrency ? concurrency : 1), max_requests_(max_requests), begin_(Clock::now()),
+      deadline_(begin_ + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(duration_s))),
+      timed_(duration_s > 0), active_(concurrency ? concurrency : 1) {
+}
+
+bool ClosedLoop::acquire(uint64_t* seq) {
+    if (stop_ || (timed_ && Clock::now() >= deadline_)) {
+        release();
+        return false;
+    }
+    uint64_t n = issued_.fetch_add(1);
+    if (max_requests_ && n >= max_requests_) {
+        release();
+        return false;
+    }
+    *seq = n;
+    return true;
+}
+
+void ClosedLoop::complete(bool succeeded) {
+    completed_.fetch_add(1, std::memory_order_relaxed);
+    if (!succeeded) {
+        failed_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void ClosedLoop::release() {
+    if (active_.fetch_sub(1) == 1) {
+        end_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin_).count();
+        std::lock_guard<std::mutex> lock(mutex_);
+        idle_.notify_all();
+    }
+}
+
+bool ClosedLoop::waitIdle(std::chrono::seconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return idle_.wait_for(lock, timeout, [this]() { return active_.load() == 0; });
+}
+
+uint64_t ClosedLoop::issued() const {
+    uint64_t n = issued_.load();
+    // 超过上限的领取不算发出
+    return (max_requests_ && n > max_requests_) ? max_requests_ : n;
+}
+
+double ClosedLoop::elapsed() const {
+    int64_t ns = end_ns_.load();
+    if (ns == 0) {
+        ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin_).count();
+    }
+    return ns / 1e9;
+}
+
+void print_concurrency_table(std::ostream& os, const std::vector<ConcurrencyResult>& results) {
+    std::ios::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << "==== throughput vs concurrency ====" << std::endl;
+    os << std::setw(8) << "N" << std::setw(10) << "requests" << std::setw(8) << "failed"
+       << std::setw(10) << "seconds" << std::setw(12) << "req/s"
+       << std::setw(10) << "p50 ms" << std::setw(10) << "p99 ms" << std::setw(10) << "max ms" << std::endl;
+    os << std::fixed;
+    for (size_t i = 0; i < results.size(); ++ i) {
+        const ConcurrencyResult& r = results[i];
+        os << std::setw(8) << r.concurrency << std::setw(10) << r.completed << std::setw(8) << r.failed
+           << std::setprecision(2) << std::setw(10) << r.seconds
+           << std::setw(12) << (r.seconds > 0 ? r.completed / r.seconds : 0)
+           << std::setw(10) << r.latency.percentile(0.50) / 1000.0
+           << std::setw(10) << r.latency.percentile(0.99) / 1000.0
+           << std::setw(10) << r.latency.max / 1000.0 << std::endl;
+    }
+    os.flags(flags);
+    os.precision(precision);
+}
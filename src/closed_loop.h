@@ -0,0 +1,69 @@
+#ifndef CRONET_CONN_STAT_CLOSED_LOOP_H
+#define CRONET_CONN_STAT_CLOSED_LOOP_H
+
+#include "histogram.h"
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+// 闭环发压的一轮：concurrency 个槽位各自串行发请求，直到总数或时长用完。
+// 槽位在回调线程上调用 acquire() 领取下一个请求的序号，只有原子操作；
+// 最后一个槽位停下时才加锁唤醒等待的 main 线程
+class ClosedLoop {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    // max_requests 为 0 表示不限数量，duration_s 为 0 表示不限时长
+    ClosedLoop(size_t concurrency, uint64_t max_requests, double duration_s);
+
+    // 领取下一个请求的序号；返回 false 时该槽位停止，不应再调用
+    bool acquire(uint64_t* seq);
+    // 请求结束时调用
+    void complete(bool succeeded);
+    // 不再发新请求，在飞的请求照常结束
+    void stop() { stop_ = true; }
+    // 等待所有槽位停止
+    bool waitIdle(std::chrono::seconds timeout);
+
+    size_t concurrency() const { return concurrency_; }
+    uint64_t issued() const;
+    uint64_t completed() const { return completed_.load(); }
+    uint64_t failed() const { return failed_.load(); }
+    // 开始到最后一个槽位停止（或当前）的秒数
+    double elapsed() const;
+
+private:
+    void release();
+
+    const size_t concurrency_;
+    const uint64_t max_requests_;
+    const Clock::time_point begin_;
+    const Clock::time_point deadline_;
+    const bool timed_;
+    std::atomic<bool> stop_{false};
+    std::atomic<uint64_t> issued_{0};
+    std::atomic<uint64_t> completed_{0};
+    std::atomic<uint64_t> failed_{0};
+    std::atomic<size_t> active_;
+    std::atomic<int64_t> end_ns_{0};
+    std::mutex mutex_;
+    std::condition_variable idle_;
+};
+
+// 某个并发数下的结果，延迟单位微秒
+struct ConcurrencyResult {
+    size_t concurrency = 0;
+    uint64_t completed = 0;
+    uint64_t failed = 0;
+    double seconds = 0;
+    HistogramSnapshot latency;
+};
+
+// 吞吐随并发数变化的表格，吞吐不再随 N 增长而延迟开始上升的位置即拐点
+void print_concurrency_table(std::ostream& os, const std::vector<ConcurrencyResult>& results);
+
+#endif // CRONET_CONN_STAT_CLOSED_LOOP_H
@@ -0,0 +1,118 @@
+#include "concurrency_limit.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+bool LimitPolicy::parseAlgorithm(const char* name, Algorithm* out) {
+    if (strcmp(name, "aimd") == 0) {
+        *out = ALGORITHM_AIMD;
+    }
+    else if (strcmp(name, "gradient") == 0) {
+        *out = ALGORITHM_GRADIENT;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+ConcurrencyLimiter::ConcurrencyLimiter(const LimitPolicy& policy, Apply apply)
+    : policy_(policy), apply_(apply), begin_(std::chrono::steady_clock::now()),
+      limit_((double)policy.initial), applied_(policy.initial), peak_(policy.initial) {
+}
+
+void ConcurrencyLimiter::onSample(uint64_t rtt_us, size_t in_flight, bool failed) {
+    size_t changed = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++ samples_;
+        if (!failed && rtt_us > 0) {
+            if (min_rtt_us_ == 0 || rtt_us < min_rtt_us_) {
+                min_rtt_us_ = rtt_us;
+            }
+            if (window_min_us_ == 0 || rtt_us < window_min_us_) {
+                window_min_us_ = rtt_us;
+            }
+        }
+        if (samples_ % policy_.baseline_window == 0 && window_min_us_ > 0) {
+            min_rtt_us_ = window_min_us_;
+            window_min_us_ = 0;
+        }
+        double next = policy_.algorithm == LimitPolicy::ALGORITHM_GRADIENT
+            ? (failed ? limit_ : gradientLocked(rtt_us, in_flight))
+            : aimdLocked(rtt_us, in_flight, failed);
+        limit_ = std::max((double)policy_.min_limit, std::min((double)policy_.max_limit, next));
+        size_t limit = (size_t)limit_;
+        if (limit != applied_) {
+            applied_ = limit;
+            changed = limit;
+            peak_ = std::max(peak_, limit);
+        }
+
+        size_t second = (size_t)std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::steady_clock::now() - begin_).count();
+        if (seconds_.size() <= second) {
+            seconds_.resize(second + 1);
+        }
+        Second& s = seconds_[second];
+        s.limit = applied_;
+        s.max_in_flight = std::max(s.max_in_flight, in_flight + 1);
+        ++ s.samples;
+        if (failed) {
+            ++ s.failed;
+        }
+        s.rtt_sum_us += rtt_us;
+    }
+    if (changed) {
+        apply_(changed);
+    }
+}
+
+double ConcurrencyLimiter::aimdLocked(uint64_t rtt_us, size_t in_flight, bool failed) {
+    if (failed || (min_rtt_us_ > 0 && rtt_us > policy_.tolerance * min_rtt_us_)) {
+        ++ decreases_;
+        return limit_ * policy_.backoff;
+    }
+    // 在飞的请求不到上限的一半时说明负载本身不够，上限再大也没有意义
+    if (in_flight * 2 >= (size_t)limit_) {
+        return limit_ + 1.0 / limit_;
+    }
+    return limit_;
+}
+
+double ConcurrencyLimiter::gradientLocked(uint64_t rtt_us, size_t in_flight) {
+    // 在飞的请求不到上限的一半时说明负载本身不够，不调整
+    if (rtt_us == 0 || min_rtt_us_ == 0 || in_flight * 2 < (size_t)limit_) {
+        return limit_;
+    }
+    double gradient = std::max(0.5, std::min(1.0, policy_.tolerance * min_rtt_us_ / rtt_us));
+    double next = limit_ * gradient + sqrt(limit_);
+    // gradient < 1 时加上排队余量后仍可能变大，只有新上限确实变小才算一次减小
+    if (next < limit_) {
+        ++ decreases_;
+    }
+    return limit_ * (1 - policy_.smoothing) + next * policy_.smoothing;
+}
+
+size_t ConcurrencyLimiter::limit() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return applied_;
+}
+
+void ConcurrencyLimiter::report(std::ostream& os) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    os << "adaptive limit: " << (policy_.algorithm == LimitPolicy::ALGORITHM_GRADIENT ? "gradient" : "aimd")
+       << " initial=" << policy_.initial << " final=" << applied_ << " peak=" << peak_ << " range=["
+       << policy_.min_limit << ", " << policy_.max_limit << "] samples=" << samples_ << " decreases=" << decreases_
+       << " baseline=" << min_rtt_us_ / 1000.0 << " ms" << std::endl;
+    size_t limit = policy_.initial;
+    for (size_t i = 0; i < seconds_.size(); ++ i) {
+        const Second& s = seconds_[i];
+        if (s.samples > 0) {
+            limit = s.limit;
+        }
+        os << "  +" << i << "s limit=" << limit << " max_in_flight=" << s.max_in_flight << " samples=" << s.samples
+           << " failed=" << s.failed << " rtt mean=" << (s.samples ? s.rtt_sum_us / 1000.0 / s.samples : 0) << " ms"
+           << std::endl;
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef CRONET_CONN_STAT_CONCURRENCY_LIMIT_H
+#define CRONET_CONN_STAT_CONCURRENCY_LIMIT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+// 自适应并发上限的参数。基线为最近一个窗口内的最小延迟，即没有排队时的延迟。
+// aimd：延迟超过 tolerance 倍基线或请求失败时乘性减小，否则每个窗口大小的样本加一；
+// gradient：按 tolerance 倍基线与当前延迟之比（限制在 [0.5, 1]）缩放上限，再加 sqrt(limit) 的排队余量
+struct LimitPolicy {
+    enum Algorithm {
+        ALGORITHM_NONE,
+        ALGORITHM_AIMD,
+        ALGORITHM_GRADIENT,
+    };
+    Algorithm algorithm = ALGORITHM_NONE;
+    size_t initial = 10;
+    size_t min_limit = 1;
+    size_t max_limit = 1000;
+    double tolerance = 2.0;         // 延迟超过基线的这个倍数视为排队
+    double backoff = 0.9;           // aimd 减小时乘的系数
+    double smoothing = 0.2;         // gradient 新上限的平滑系数
+    size_t baseline_window = 1000;  // 每这么多个样本用这段时间的最小延迟更新基线，网络本身变慢时跟着变
+
+    bool enabled() const { return algorithm != ALGORITHM_NONE; }
+
+    static bool parseAlgorithm(const char* name, Algorithm* out);
+};
+
+// 按请求结束时的延迟调整并发上限，上限变化时调用 apply（不持锁）。
+// 每秒记一次上限与延迟，用来看上限如何收敛。各方法可在任意线程上调用
+class ConcurrencyLimiter {
+public:
+    typedef std::function<void(size_t limit)> Apply;
+
+    ConcurrencyLimiter(const LimitPolicy& policy, Apply apply);
+
+    // 一个请求结束：rtt_us 为 Start 到结束，in_flight 为结束时仍在飞的请求数，failed 为失败或取消
+    void onSample(uint64_t rtt_us, size_t in_flight, bool failed);
+
+    size_t limit() const;
+    void report(std::ostream& os) const;
+
+private:
+    ConcurrencyLimiter(const ConcurrencyLimiter&);
+    ConcurrencyLimiter& operator=(const ConcurrencyLimiter&);
+
+    struct Second {
+        size_t limit = 0;
+        size_t max_in_flight = 0;
+        uint64_t samples = 0;
+        uint64_t failed = 0;
+        uint64_t rtt_sum_us = 0;
+    };
+
+    double aimdLocked(uint64_t rtt_us, size_t in_flight, bool failed);
+    double gradientLocked(uint64_t rtt_us, size_t in_flight);
+
+    const LimitPolicy policy_;
+    Apply apply_;
+    std::chrono::steady_clock::time_point begin_;
+    mutable std::mutex mutex_;
+    double limit_;
+    size_t applied_;
+    uint64_t min_rtt_us_ = 0;       // 基线
+    uint64_t window_min_us_ = 0;    // 当前窗口内的最小延迟
+    uint64_t samples_ = 0;
+    uint64_t decreases_ = 0;
+    size_t peak_ = 0;
+    std::vector<Second> seconds_;
+};
+
+#endif // CRONET_CONN_STAT_CONCURRENCY_LIMIT_H
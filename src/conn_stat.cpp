@@ -0,0 +1,210 @@
+#include "conn_stat.h"
+#include <iomanip>
+#include <algorithm>
+
+ConnStat::ConnStat() {
+    for (int i = 0; i < kReasonCount; ++ i) {
+        finished_[i].store(0);
+    }
+    for (int i = 0; i < kErrorCodeCount; ++ i) {
+        errors_[i].store(0);
+    }
+}
+
+ConnPoolStat* ConnStat::pool(const Key& key) {
+    auto it = pools_.find(key);
+    if (it == pools_.end()) {
+        it = pools_.insert(std::make_pair(key, std::unique_ptr<ConnPoolStat>(new ConnPoolStat))).first;
+    }
+    return it->second.get();
+}
+
+void ConnStat::record(const RequestMetrics& m) {
+    if (m.finished_reason >= 0 && m.finished_reason < kReasonCount) {
+        finished_[m.finished_reason].fetch_add(1, std::memory_order_relaxed);
+    }
+    if (m.error_code >= 0 && m.error_code < kErrorCodeCount) {
+        errors_[m.error_code].fetch_add(1, std::memory_order_relaxed);
+    }
+    // 缓存命中没有用到连接，不计入连接复用
+    if (!m.has_metrics || m.was_cached) {
+        return;
+    }
+
+    // 没复用 socket 的请求不一定建了连接：DNS 失败、排队时被取消的请求没拿到 socket
+    bool fresh = !m.socket_reused &&
+        (m.connect_start_ms > 0 || m.finished_reason == Cronet_RequestFinishedInfo_FINISHED_REASON_SUCCEEDED);
+    ConnPoolStat* ps = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ps = pool(Key(m.host.empty() ? "unknown" : m.host, m.protocol));
+        // 请求全部一次发出时 request_start 都在第一秒，按实际建连与结束的时间分桶
+        int64_t end_ms = m.request_end_ms > 0 ? m.request_end_ms : m.request_start_ms;
+        if (end_ms > 0) {
+            ++ seconds_[end_ms / 1000].requests;
+        }
+        int64_t connect_ms = m.connect_start_ms > 0 ? m.connect_start_ms : end_ms;
+        if (fresh && connect_ms > 0) {
+            ++ seconds_[connect_ms / 1000].fresh;
+        }
+    }
+
+    ps->requests.fetch_add(1, std::memory_order_relaxed);
+    if (m.wire_received_bytes > 0) {
+        ps->wire_bytes.fetch_add((uint64_t)m.wire_received_bytes, std::memory_order_relaxed);
+    }
+    int64_t total = phase_ms(m.request_start_ms, m.request_end_ms);
+    int64_t ttfb = phase_ms(m.request_start_ms, m.response_start_ms);
+    if (m.socket_reused) {
+        ps->reused.fetch_add(1, std::memory_order_relaxed);
+        if (total >= 0) ps->total_reused.record(total * 1000);
+        if (ttfb >= 0) ps->ttfb_reused.record(ttfb * 1000);
+    }
+    else if (fresh) {
+        ps->fresh.fetch_add(1, std::memory_order_relaxed);
+        if (total >= 0) ps->total_new.record(total * 1000);
+        if (ttfb >= 0) ps->ttfb_new.record(ttfb * 1000);
+
+        int64_t dns = phase_ms(m.dns_start_ms, m.dns_end_ms);
+        int64_t connect = phase_ms(m.connect_start_ms, m.connect_end_ms);
+        int64_t ssl = phase_ms(m.ssl_start_ms, m.ssl_end_ms);
+        if (dns >= 0) ps->dns.record(dns * 1000);
+        if (connect >= 0) ps->connect.record(connect * 1000);
+        if (ssl >= 0) ps->ssl.record(ssl * 1000);
+    }
+}
+
+void ConnStat::reset() {
+    for (int i = 0; i < kReasonCount; ++ i) {
+        finished_[i].store(0);
+    }
+    for (int i = 0; i < kErrorCodeCount; ++ i) {
+        errors_[i].store(0);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = pools_.begin(); it != pools_.end(); ++ it) {
+        ConnPoolStat& ps = *it->second;
+        ps.requests.store(0);
+        ps.reused.store(0);
+        ps.fresh.store(0);
+        ps.wire_bytes.store(0);
+        ps.total_new.reset();
+        ps.total_reused.reset();
+        ps.ttfb_new.reset();
+        ps.ttfb_reused.reset();
+        ps.dns.reset();
+        ps.connect.reset();
+        ps.ssl.reset();
+    }
+    seconds_.clear();
+}
+
+std::map<int64_t, ConnSecond> ConnStat::perSecond() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return seconds_;
+}
+
+void ConnStat::report(std::ostream& os) const {
+    report(os, std::vector<const ConnStat*>(1, this));
+}
+
+ConnSummary ConnStat::summarize(const std::vector<const ConnStat*>& stats) {
+    ConnSummary sum;
+    for (size_t i = 0; i < stats.size(); ++ i) {
+        stats[i]->forEach([&sum](const Key& key, const ConnPoolStat& ps) {
+            uint64_t requests = ps.requests.load();
+            sum.requests += requests;
+            sum.reused += ps.reused.load();
+            sum.wire_bytes += ps.wire_bytes.load();
+            sum.protocols[key.second] += requests;
+            sum.total_new.merge(ps.total_new.snapshot());
+            sum.total_reused.merge(ps.total_reused.snapshot());
+            sum.ttfb_new.merge(ps.ttfb_new.snapshot());
+            sum.ttfb_reused.merge(ps.ttfb_reused.snapshot());
+            sum.dns.merge(ps.dns.snapshot());
+            sum.connect.merge(ps.connect.snapshot());
+            sum.ssl.merge(ps.ssl.snapshot());
+        });
+    }
+    return sum;
+}
+
+void ConnStat::report(std::ostream& os, const std::vector<const ConnStat*>& stats) {
+    uint64_t finished_total[kReasonCount] = {0, 0, 0};
+    struct Merged {
+        uint64_t requests = 0;
+        uint64_t reused = 0;
+        uint64_t fresh = 0;
+        HistogramSnapshot total_new, total_reused, ttfb_new, ttfb_reused, dns, connect, ssl;
+    };
+    std::map<Key, Merged> merged;
+    std::map<int64_t, ConnSecond> seconds;
+    for (size_t i = 0; i < stats.size(); ++ i) {
+        for (int r = 0; r < kReasonCount; ++ r) {
+            finished_total[r] += stats[i]->finished(r);
+        }
+        stats[i]->forEach([&merged](const Key& key, const ConnPoolStat& ps) {
+            Merged& m = merged[key];
+            m.requests += ps.requests.load();
+            m.reused += ps.reused.load();
+            m.fresh += ps.fresh.load();
+            m.total_new.merge(ps.total_new.snapshot());
+            m.total_reused.merge(ps.total_reused.snapshot());
+            m.ttfb_new.merge(ps.ttfb_new.snapshot());
+            m.ttfb_reused.merge(ps.ttfb_reused.snapshot());
+            m.dns.merge(ps.dns.snapshot());
+            m.connect.merge(ps.connect.snapshot());
+            m.ssl.merge(ps.ssl.snapshot());
+        });
+        std::map<int64_t, ConnSecond> per_second = stats[i]->perSecond();
+        for (auto it = per_second.begin(); it != per_second.end(); ++ it) {
+            seconds[it->first].requests += it->second.requests;
+            seconds[it->first].fresh += it->second.fresh;
+        }
+    }
+
+    os << "==== connection reuse ====" << std::endl;
+    os << "succeeded=" << finished_total[Cronet_RequestFinishedInfo_FINISHED_REASON_SUCCEEDED]
+       << " failed=" << finished_total[Cronet_RequestFinishedInfo_FINISHED_REASON_FAILED]
+       << " canceled=" << finished_total[Cronet_RequestFinishedInfo_FINISHED_REASON_CANCELED] << std::endl;
+    for (auto it = merged.begin(); it != merged.end(); ++ it) {
+        const Merged& m = it->second;
+        if (m.requests == 0) {
+            // reset 之后本轮没用到
+            continue;
+        }
+        double ratio = m.requests ? 100.0 * m.reused / m.requests : 0.0;
+        os << it->first.first << " [" << it->first.second << "] requests=" << m.requests
+           << " reused=" << m.reused << " new=" << m.fresh
+           << " reuse_ratio=" << std::fixed << std::setprecision(1) << ratio << "%"
+           << std::defaultfloat << std::endl;
+        print_percentiles(os, "total (new socket)", m.total_new);
+        print_percentiles(os, "total (reused socket)", m.total_reused);
+        print_percentiles(os, "ttfb (new socket)", m.ttfb_new);
+        print_percentiles(os, "ttfb (reused socket)", m.ttfb_reused);
+        print_percentiles(os, "dns", m.dns);
+        print_percentiles(os, "connect", m.connect);
+        print_percentiles(os, "ssl", m.ssl);
+    }
+
+    if (seconds.empty()) {
+        return;
+    }
+    // 每秒负载触发的新建连接数，连接池热的时候应接近 0
+    uint64_t peak = 0, total_fresh = 0, total_requests = 0;
+    int64_t first = seconds.begin()->first;
+    os << "fresh connects per second:" << std::endl;
+    for (auto it = seconds.begin(); it != seconds.end(); ++ it) {
+        const ConnSecond& sec = it->second;
+        os << "  +" << (it->first - first) << "s requests=" << sec.requests
+           << " fresh=" << sec.fresh << std::endl;
+        peak = std::max(peak, sec.fresh);
+        total_fresh += sec.fresh;
+        total_requests += sec.requests;
+    }
+    int64_t span = seconds.rbegin()->first - first + 1;
+    os << "  avg=" << std::fixed << std::setprecision(2) << (double)total_fresh / span
+       << "/s peak=" << peak << "/s fresh_per_request="
+       << (total_requests ? (double)total_fresh / total_requests : 0.0)
+       << std::defaultfloat << std::endl;
+}
@@ -0,0 +1,96 @@
+#ifndef CRONET_CONN_STAT_CONN_STAT_H
+#define CRONET_CONN_STAT_CONN_STAT_H
+
+#include "histogram.h"
+#include "request_metrics.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <ostream>
+
+// 每个 host + 协议 的连接复用统计，延迟按 新建连接 / 复用连接 分开
+struct ConnPoolStat {
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> reused{0};
+    std::atomic<uint64_t> fresh{0};
+    LatencyHistogram total_new;     // request_start -> request_end
+    LatencyHistogram total_reused;
+    LatencyHistogram ttfb_new;      // request_start -> response_start
+    LatencyHistogram ttfb_reused;
+    LatencyHistogram dns;           // 以下仅新建连接才有
+    LatencyHistogram connect;
+    LatencyHistogram ssl;
+    std::atomic<uint64_t> wire_bytes{0};    // UrlResponseInfo.received_byte_count 之和
+};
+
+// 所有 host 合并后的汇总，用于不同引擎参数之间对比
+struct ConnSummary {
+    uint64_t requests = 0;
+    uint64_t reused = 0;
+    uint64_t wire_bytes = 0;
+    std::map<std::string, uint64_t> protocols;  // 协议 -> 请求数
+    HistogramSnapshot total_new, total_reused, ttfb_new, ttfb_reused, dns, connect, ssl;
+};
+
+// 某一秒内完成的请求数与这一秒开始建立的新连接数
+struct ConnSecond {
+    uint64_t requests = 0;
+    uint64_t fresh = 0;
+};
+
+class ConnStat {
+public:
+    typedef std::pair<std::string, std::string> Key;   // host, protocol
+    static const int kReasonCount = 3;      // Cronet_RequestFinishedInfo_FINISHED_REASON
+    static const int kErrorCodeCount = 12;  // Cronet_Error_ERROR_CODE
+
+    ConnStat();
+
+    // 在 request finished listener 的执行线程上调用
+    void record(const RequestMetrics& m);
+
+    uint64_t finished(int reason) const {
+        return (reason >= 0 && reason < kReasonCount) ? finished_[reason].load(std::memory_order_relaxed) : 0;
+    }
+    uint64_t errors(int code) const {
+        return (code >= 0 && code < kErrorCodeCount) ? errors_[code].load(std::memory_order_relaxed) : 0;
+    }
+
+    // 清零所有计数，用于多轮之间；不释放 ConnPoolStat，forEach 拿到的指针仍然有效
+    void reset();
+    // 拷贝一份按秒统计的新建连接数，便于报告或导出
+    std::map<int64_t, ConnSecond> perSecond() const;
+    // 遍历各 host/协议，回调中只能读原子计数与直方图快照。
+    // 锁内只拷贝指针（ConnPoolStat 创建后不会释放），读取在锁外进行，不阻塞 record()
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        std::vector<std::pair<Key, const ConnPoolStat*>> pools;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (auto it = pools_.begin(); it != pools_.end(); ++ it) {
+                pools.push_back(std::make_pair(it->first, (const ConnPoolStat*)it->second.get()));
+            }
+        }
+        for (size_t i = 0; i < pools.size(); ++ i) {
+            fn(pools[i].first, *pools[i].second);
+        }
+    }
+
+    void report(std::ostream& os) const;
+    // 多个 ConnStat（每个引擎一个）按 host/协议 合并后输出
+    static void report(std::ostream& os, const std::vector<const ConnStat*>& stats);
+    static ConnSummary summarize(const std::vector<const ConnStat*>& stats);
+
+private:
+    ConnPoolStat* pool(const Key& key);
+
+    mutable std::mutex mutex_;
+    std::map<Key, std::unique_ptr<ConnPoolStat>> pools_;
+    std::map<int64_t, ConnSecond> seconds_;   // 请求按结束所在的秒，新建连接按 connect_start 所在的秒
+    std::atomic<uint64_t> finished_[kReasonCount];
+    std::atomic<uint64_t> errors_[kErrorCodeCount];
+};
+
+#endif // CRONET_CONN_STAT_CONN_STAT_H
@@ -2,24 +2,359 @@
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <condition_variable>
+#include <future>
 #include <map>
-#include <queue>
 #include <mutex>
-#include <condition_variable>
-#include <atomic>
-#include <functional>
+#include <string>
+#include <vector>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include "admission.h"
+#include "closed_loop.h"
+#include "concurrency_limit.h"
+#include "conn_stat.h"
+#include "endpoint_registry.h"
+#include "bidi_bench.h"
+#include "engine_config.h"
+#include "executor_thread.h"
+#include "goodput_stat.h"
+#include "hedging.h"
+#include "http_cache.h"
+#include "metrics_exporter.h"
+#include "open_loop.h"
+#include "record_log.h"
+#include "retry.h"
+#include "single_flight.h"
+#include "slow_requests.h"
+#include "traffic_capture.h"
+#include "workload.h"
 
 #define ENABLE_EXECUTOR_THREAD
-// #define REQUEST_BATCH
 
-std::map<Cronet_UrlResponseInfoPtr, Cronet_UrlRequestPtr> rr_map; 
+// 一个请求的回调与 finished listener 都在其引擎的执行器线程上，多引擎时按线程各存一份
+thread_local std::map<Cronet_UrlResponseInfoPtr, Cronet_UrlRequestPtr> rr_map; 
+
+// 逐个回调打印，压测时关闭
+static bool g_verbose = true;
+
+// 已结束的请求数：terminal 回调与 finished listener 各计一次，main 据此等待全部完成
+struct RunProgress {
+    std::atomic<uint64_t> completed{0};
+    std::atomic<uint64_t> listened{0};
+    std::mutex mutex;
+    std::condition_variable cond;
+
+    std::atomic<uint64_t> target{UINT64_C(0xffffffffffffffff)};
+    // 对冲副本与重试额外发起的请求数。completed 按逻辑请求计，这些请求的 listener 也要等到
+    std::atomic<uint64_t> extra{0};
+
+    // 只有达到等待目标时才加锁唤醒，平时回调路径上只有一次原子加
+    void notify(std::atomic<uint64_t>& counter) {
+        if (counter.fetch_add(1) + 1 >= target.load()) {
+            std::lock_guard<std::mutex> lock(mutex);
+            cond.notify_all();
+        }
+    }
+    // 每轮负载开始前清零
+    void reset() {
+        completed = 0;
+        listened = 0;
+        extra = 0;
+        target = UINT64_C(0xffffffffffffffff);
+    }
+    bool waitFor(uint64_t total, std::chrono::seconds timeout) {
+        target = total;
+        std::unique_lock<std::mutex> lock(mutex);
+        return cond.wait_for(lock, timeout, [this, total]() {
+            return completed.load() >= total && listened.load() >= total + extra.load();
+        });
+    }
+};
+static RunProgress g_progress;
+
+// request finished listener 的 client context，为空的项不记录
+struct FinishedSinks {
+    ConnStat* conn_stat = nullptr;
+    GoodputStat* goodput = nullptr;
+    RecordLog* record_log = nullptr;
+    SlowRequestReservoir* slow_requests = nullptr;
+    TrafficRecorder* capture = nullptr;
+    ConnStat* prewarm = nullptr;        // 预热请求只记在这里
+    CacheStat* cache = nullptr;
+};
+
+struct LoadSlot;
+static void slot_request_done(LoadSlot* slot, bool succeeded);
+struct HedgeGroup;
+struct RetryChain;
+
+// 请求的 client context，只在该请求自己的回调里访问
+struct RequestContext {
+    std::atomic<bool> done{false};  // 已收到 terminal 回调，超时取消时在 main 线程读
+    uint64_t body_bytes = 0;
+    RequestTrace* trace = nullptr;  // 开启 --slow-k 时才有
+    std::chrono::steady_clock::time_point intended;     // 预定发起时间（开环模式），否则同 started
+    std::chrono::steady_clock::time_point started;      // 实际调用 Cronet_UrlRequest_Start 的时间
+    LoadSlot* slot = nullptr;       // 闭环模式下所属的槽位
+    uint32_t endpoint = 0;          // 在 Workload::endpoints 中的下标
+    uint64_t latency_us = 0;        // Start -> terminal 回调，listener 录制流量时用
+    bool prewarm = false;           // 预热请求，不计入负载的统计
+    int traffic_class = -1;         // 端点所属负载类的下标
+    AdmissionScheduler* admission = nullptr;    // 经本地准入放行的请求，结束时归还窗口
+    ConcurrencyLimiter* limiter = nullptr;      // 自适应限流时由 listener 喂给它延迟样本
+    HedgeGroup* hedge = nullptr;    // 可对冲的请求，原请求与副本共用
+    int hedge_role = 0;             // 0 原请求，1 副本
+    RetryChain* retry = nullptr;    // 可重试的请求，各次尝试共用
+    int attempt = 0;                // 第几次尝试，0 为首次
+    Flight* flight = nullptr;       // 合并的 leader（首次尝试）才有，等待者挂在上面
+};
+
+// 对冲：同一逻辑请求的原请求与副本。两者序号相同，总在同一个引擎上，回调、listener 与发副本的任务
+// 都在该引擎的执行器线程上执行。先收到响应头（或先成功结束）的一方胜出，另一方被取消；
+// 两者的 terminal 回调都到达后这个逻辑请求才算结束
+struct HedgeGroup {
+    HedgeController* controller = nullptr;
+    Cronet_UrlRequestPtr request[2] = {nullptr, nullptr};
+    RequestContext* ctx[2] = {nullptr, nullptr};
+    std::atomic<int> winner{-1};    // 定时线程读它来跳过已有结果的请求
+    int pending = 1;                // 未结束的请求数
+};
+
+// 重试：同一逻辑请求的各次尝试。序号相同，总在同一个引擎上，terminal 回调与发起重试的任务
+// 都在该引擎的执行器线程上执行。上一次尝试失败时决定是否重试，最后一次尝试结束才算这个请求结束
+struct RetryChain {
+    RetryController* controller = nullptr;
+    const std::function<bool(size_t, uint64_t)>* schedule = nullptr;  // (序号, 退避微秒) 安排下一次尝试
+    size_t index = 0;
+    RequestContext* origin = nullptr;   // 首次尝试
+    int attempts = 1;                   // 已发起（或已安排）的尝试次数
+    bool scheduled = false;             // 下一次尝试已安排、还没发起，定时线程停止时要由 main 收尾
+    std::vector<std::unique_ptr<RequestContext>> ctx;   // 重试的上下文与请求对象
+    std::vector<Cronet_UrlRequestPtr> request;
+};
+
+// 失败的一次尝试：错误可重试、还有次数且预算允许时按退避时间安排下一次，返回 true
+static bool retry_next(RetryChain* chain, Cronet_ErrorPtr error) {
+    int code = (int)Cronet_Error_error_code_get(error);
+    if (!retriable_error(error)) {
+        chain->controller->onNotRetriable(code);
+        return false;
+    }
+    int64_t backoff = chain->controller->acquire(chain->attempts - 1, code);
+    if (backoff < 0) {
+        return false;
+    }
+    ++ chain->attempts;
+    g_progress.extra.fetch_add(1);
+    chain->scheduled = true;
+    if (!(*chain->schedule)(chain->index, (uint64_t)backoff)) {
+        // 定时线程已停止（超时收尾中），这次失败就是最后一次
+        chain->scheduled = false;
+        -- chain->attempts;
+        g_progress.extra.fetch_sub(1);
+        return false;
+    }
+    return true;
+}
+
+// 对冲副本与重试尝试都归到首次发起的请求上
+static RequestContext* origin_of(RequestContext* ctx) {
+    if (ctx->hedge) {
+        return ctx->hedge->ctx[0];
+    }
+    if (ctx->retry) {
+        return ctx->retry->origin;
+    }
+    return ctx;
+}
+
+// role 一方胜出，取消仍在进行的另一方
+static void hedge_claim(HedgeGroup* g, int role) {
+    if (g->winner.load() >= 0) {
+        return;
+    }
+    g->winner.store(role);
+    if (role == 1) {
+        g->controller->onHedgeWin();
+    }
+    RequestContext* other = g->ctx[1 - role];
+    if (other && !other->done) {
+        Cronet_UrlRequest_Cancel(g->request[1 - role]);
+    }
+}
+
+// 请求端到端耗时（微秒），在 terminal 回调中记录
+struct LoadLatency {
+    LatencyHistogram from_intended;     // 含发压端排队，开环模式下反映协调遗漏
+    LatencyHistogram from_start;
+    // 按 finished listener 报告的 socket_reused 拆分 from_start：冷启动要付 DNS/连接/TLS 的开销
+    LatencyHistogram cold;
+    LatencyHistogram warm;
+    // 按负载类拆分：from_intended（含本地准入排队）与预定时间到 Start 的排队时间
+    struct ClassLatency {
+        LatencyHistogram latency;
+        LatencyHistogram queue_wait;
+    };
+    std::vector<std::unique_ptr<ClassLatency>> by_class;
+
+    void setClasses(size_t count) {
+        by_class.clear();
+        for (size_t c = 0; c < count; ++ c) {
+            by_class.push_back(std::unique_ptr<ClassLatency>(new ClassLatency));
+        }
+    }
+    void reset() {
+        from_intended.reset();
+        from_start.reset();
+        cold.reset();
+        warm.reset();
+        for (size_t c = 0; c < by_class.size(); ++ c) {
+            by_class[c]->latency.reset();
+            by_class[c]->queue_wait.reset();
+        }
+    }
+};
+static LoadLatency g_latency;
+
+static void trace_event(Cronet_UrlRequest* request, TraceEventType type, uint64_t bytes = 0) {
+    RequestContext* ctx = (RequestContext*)Cronet_UrlRequest_GetClientContext(request);
+    if (ctx && ctx->trace) {
+        ctx->trace->add(type, bytes);
+    }
+}
+
+// 记录一个逻辑请求的端到端延迟，返回从预定时间算起的微秒数
+static uint64_t record_latency(const RequestContext& origin, std::chrono::steady_clock::time_point now) {
+    uint64_t from_intended = std::chrono::duration_cast<std::chrono::microseconds>(now - origin.intended).count();
+    g_latency.from_intended.record(from_intended);
+    g_latency.from_start.record(std::chrono::duration_cast<std::chrono::microseconds>(now - origin.started).count());
+    if (origin.traffic_class >= 0 && (size_t)origin.traffic_class < g_latency.by_class.size()) {
+        LoadLatency::ClassLatency& cl = *g_latency.by_class[origin.traffic_class];
+        cl.latency.record(from_intended);
+        cl.queue_wait.record(std::chrono::duration_cast<std::chrono::microseconds>(origin.started - origin.intended).count());
+    }
+    return from_intended;
+}
+
+// 逻辑请求结束：挂在它上面的合并等待者随之结束，再归还准入窗口。之后由调用方给 completed 计数
+static void finish_logical(const RequestContext& origin, std::chrono::steady_clock::time_point now) {
+    if (origin.flight) {
+        // 挂在这个请求上的等待者随之结束
+        std::vector<void*> waiters = origin.flight->owner->finish(origin.flight);
+        for (size_t w = 0; w < waiters.size(); ++ w) {
+            RequestContext* waiter = (RequestContext*)waiters[w];
+            record_latency(*waiter, now);
+            waiter->latency_us = std::chrono::duration_cast<std::chrono::microseconds>(now - waiter->started).count();
+            waiter->done = true;
+            if (waiter->admission) {
+                waiter->admission->complete();
+            }
+            g_progress.notify(g_progress.completed);
+            // 等待者没有发请求，也就没有 listener 回调
+            g_progress.notify(g_progress.listened);
+        }
+    }
+    // 先放行排队的请求再计数，main 被唤醒后准入调度器随 run_load 返回而销毁
+    if (origin.admission) {
+        origin.admission->complete();
+    }
+}
+
+// terminal 回调（succeeded/failed/canceled）共用，error 只在 on_failed 时有
+static void request_done(Cronet_UrlRequest* request, bool succeeded, Cronet_ErrorPtr error = nullptr) {
+    RequestContext* ctx = (RequestContext*)Cronet_UrlRequest_GetClientContext(request);
+    if (ctx) {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        ctx->latency_us = std::chrono::duration_cast<std::chrono::microseconds>(now - ctx->started).count();
+        RetryChain* chain = ctx->retry;
+        // 合并的 leader 已把部分 body 交给等待者时不重试，新的尝试会从头再交一遍
+        bool fanned_out = chain && chain->origin->flight && chain->origin->flight->delivered;
+        if (chain && error && !fanned_out && retry_next(chain, error)) {
+            // 这次尝试失败，等下一次尝试的 terminal 回调
+            ctx->done = true;
+            return;
+        }
+        HedgeGroup* g = ctx->hedge;
+        if (g && succeeded) {
+            hedge_claim(g, ctx->hedge_role);
+        }
+        else if (g && g->winner.load() < 0) {
+            // 失败的一方不胜出，另一方还在进行时等它的结果；两方都失败（或副本没发出）才算这个请求失败，
+            // 由最后结束的一方记录，之后也不再发副本
+            RequestContext* other = g->ctx[1 - ctx->hedge_role];
+            if (!other || other->done) {
+                g->winner.store(ctx->hedge_role);
+            }
+        }
+        // 对冲或重试时从首次发起的请求算起，对冲只有胜出的一方计入延迟
+        const RequestContext& origin = g ? *g->ctx[0] : (chain ? *chain->origin : *ctx);
+        if (chain && chain->attempts > 1) {
+            if (succeeded) {
+                chain->controller->onRecovered();
+            }
+            else {
+                chain->controller->onGaveUp();
+            }
+        }
+        if (!ctx->prewarm && (!g || g->winner.load() == ctx->hedge_role)) {
+            record_latency(origin, now);
+            if (g) {
+                g->controller->recordLatency(std::chrono::duration_cast<std::chrono::microseconds>(
+                    now - origin.started).count(), g->request[1] != nullptr);
+            }
+        }
+        if (g && ctx->hedge_role == 1 && ctx->admission) {
+            // 副本占的准入窗口
+            ctx->admission->complete();
+        }
+        ctx->done = true;
+        if (g && -- g->pending > 0) {
+            // 等另一方的 terminal 回调
+            return;
+        }
+        finish_logical(origin, now);
+    }
+    g_progress.notify(g_progress.completed);
+    if (ctx && ctx->slot) {
+        slot_request_done(ctx->slot, succeeded);
+    }
+}
+
+// 重试链的下一次尝试已安排但定时线程停止了、不会再发起：按放弃处理，以上一次失败结束这个逻辑请求。
+// 在定时线程停止、执行器排空后由 main 调用
+static void retry_abandon(RetryChain* chain) {
+    chain->scheduled = false;
+    chain->controller->onGaveUp();
+    // 计过的这次尝试没有发出，也就没有 listener
+    g_progress.extra.fetch_sub(1);
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    record_latency(*chain->origin, now);
+    finish_logical(*chain->origin, now);
+    g_progress.notify(g_progress.completed);
+}
+
+// 合并的等待者收到 leader 的一块 body，与 leader 自己在 on_read_completed 中的处理相同
+static void on_coalesced_read(void* waiter, const char* data, uint64_t bytes) {
+    RequestContext* ctx = (RequestContext*)waiter;
+    ctx->body_bytes += bytes;
+    if (g_verbose) {
+        std::cout << "Read " << bytes << " bytes (coalesced)" << std::endl;
+        std::cout.write(data, (std::streamsize)bytes);
+        std::cout << std::endl;
+    }
+}
 
 // 回调函数签名修正
 void on_redirect_received(Cronet_UrlRequestCallback* callback,
                          Cronet_UrlRequest* request,
                          Cronet_UrlResponseInfo* info,
                          const char* new_location) {
-    std::cout << "Redirect to: " << new_location << std::endl;
+    trace_event(request, TRACE_REDIRECT);
+    if (g_verbose) {
+        std::cout << "Redirect to: " << new_location << std::endl;
+    }
     rr_map[info] = request; 
 
     Cronet_UrlRequest_FollowRedirect(request);
@@ -28,8 +363,29 @@ void on_redirect_received(Cronet_UrlRequestCallback* callback,
 void on_response_started(Cronet_UrlRequestCallback* callback,
                         Cronet_UrlRequest* request,
                         Cronet_UrlResponseInfo* info) {
-    std::cout << "Response started" << std::endl;
+    trace_event(request, TRACE_RESPONSE_STARTED);
+    if (g_verbose) {
+        std::cout << "Response started" << std::endl;
+    }
     rr_map[info] = request; 
+    RequestContext* ctx = (RequestContext*)Cronet_UrlRequest_GetClientContext(request);
+    if (ctx && ctx->hedge) {
+        HedgeGroup* g = ctx->hedge;
+        int winner = g->winner.load();
+        if (winner >= 0 && winner != ctx->hedge_role) {
+            // 另一方已胜出，取消消息可能还没到
+            Cronet_UrlRequest_Cancel(request);
+            return;
+        }
+        g->controller->recordResponseStart(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - ctx->started).count());
+        hedge_claim(g, ctx->hedge_role);
+    }
+    RequestContext* origin = ctx ? origin_of(ctx) : nullptr;
+    if (origin && origin->flight) {
+        // 响应已经开始，之后的同 key 请求拿不到完整的 body，另起一个 flight
+        origin->flight->owner->close(origin->flight);
+    }
     Cronet_Buffer* buffer = Cronet_Buffer_Create();
     Cronet_Buffer_InitWithAlloc(buffer, 4096); // 4KB缓冲区
     Cronet_UrlRequest_Read(request, buffer);
@@ -40,11 +396,23 @@ void on_read_completed(Cronet_UrlRequestCallback* callback,
                       Cronet_UrlResponseInfo* info,
                       Cronet_Buffer* buffer,
                       uint64_t bytes_read) {
+    trace_event(request, TRACE_READ_COMPLETED, bytes_read);
+    RequestContext* ctx = (RequestContext*)Cronet_UrlRequest_GetClientContext(request);
+    if (ctx) {
+        ctx->body_bytes += bytes_read;
+        Flight* flight = origin_of(ctx)->flight;
+        if (flight && !flight->waiters.empty() && bytes_read > 0) {
+            // 等待者直接读 leader 的这块缓冲，不拷贝；Destroy 之前交付完
+            flight->owner->fanout(flight, static_cast<const char*>(Cronet_Buffer_GetData(buffer)), bytes_read);
+        }
+    }
     // 处理数据
-    if (bytes_read > 0) {
+    if (bytes_read > 0 && g_verbose) {
         const char* data = static_cast<const char*>(Cronet_Buffer_GetData(buffer));
         std::cout << "Read " << bytes_read << " bytes" << std::endl;
-        std::cout << data << std::endl; 
+        // buffer 不以 0 结尾
+        std::cout.write(data, (std::streamsize)bytes_read);
+        std::cout << std::endl; 
     }
 
     rr_map[info] = request; 
@@ -56,7 +424,8 @@ void on_read_completed(Cronet_UrlRequestCallback* callback,
         Cronet_Buffer* new_buffer = Cronet_Buffer_Create();
         Cronet_Buffer_InitWithAlloc(new_buffer, 4096);
         Cronet_UrlRequest_Read(request, new_buffer);
-    } else {
+    }
+    else if (g_verbose) {
         std::cout << "Read completed" << std::endl;
     }
 }
@@ -64,28 +433,42 @@ void on_read_completed(Cronet_UrlRequestCallback* callback,
 void on_succeeded(Cronet_UrlRequestCallback* callback,
                  Cronet_UrlRequest* request,
                  Cronet_UrlResponseInfo* info) {
-    std::cout << "Request succeeded" << std::endl;
+    trace_event(request, TRACE_SUCCEEDED);
+    if (g_verbose) {
+        std::cout << "Request succeeded" << std::endl;
+    }
     rr_map[info] = request; 
+    request_done(request, true);
 }
 
 void on_failed(Cronet_UrlRequestCallback* callback,
               Cronet_UrlRequest* request,
               Cronet_UrlResponseInfo* info,
               Cronet_Error* error) {
-    std::cout << "Request failed" << std::endl;
+    trace_event(request, TRACE_FAILED);
+    if (g_verbose) {
+        std::cout << "Request failed" << std::endl;
+    }
     rr_map[info] = request; 
+    request_done(request, false, error);
 }
 
 void on_canceled(Cronet_UrlRequestCallback* callback,
                 Cronet_UrlRequest* request,
                 Cronet_UrlResponseInfo* info) {
-    std::cout << "Request cancelled" << std::endl;
+    trace_event(request, TRACE_CANCELED);
+    if (g_verbose) {
+        std::cout << "Request cancelled" << std::endl;
+    }
     rr_map[info] = request; 
+    request_done(request, false);
 }
 
 void on_request_finished(Cronet_ClientContext obj, int64_t connect) 
 {
-    std::cout << "request finish, connect elapse " << connect << " ms" << std::endl; 
+    if (g_verbose) {
+        std::cout << "request finish, connect elapse " << connect << " ms" << std::endl; 
+    }
 }
 
 void on_request_finished_listener(
@@ -94,130 +477,1179 @@ void on_request_finished_listener(
     Cronet_UrlResponseInfoPtr response_info,
     Cronet_ErrorPtr error)
 {
-    std::cout << "request finished listen" << std::endl; 
-    int64_t connect = 0;
-    Cronet_MetricsPtr metrics = Cronet_RequestFinishedInfo_metrics_get(request_info);
-    if (metrics) {
-        Cronet_DateTimePtr start = Cronet_Metrics_connect_start_get(metrics);
-        Cronet_DateTimePtr end = Cronet_Metrics_connect_end_get(metrics);
-        if (start && end) {
-            int64_t start_ms = Cronet_DateTime_value_get(start);
-            int64_t end_ms = Cronet_DateTime_value_get(end);
-            connect = (start_ms > 0 && end_ms > 0) ? (end_ms - start_ms) : 0;
-            // std::cout << "has metrics, connect = " << connect << std::endl; 
-        }
+    if (g_verbose) {
+        std::cout << "request finished listen" << std::endl; 
     }
-    else {
+    RequestMetrics m;
+    extract_request_metrics(request_info, response_info, error, &m);
+    if (!m.has_metrics && g_verbose) {
         std::cout << "no metrics" << std::endl; 
     }
 
+    int64_t connect = phase_ms(m.connect_start_ms, m.connect_end_ms);
+    if (connect < 0) {
+        connect = 0;
+    }
+    // std::cout << "has metrics, connect = " << connect << std::endl; 
+
+    FinishedSinks* sinks = (FinishedSinks*)Cronet_RequestFinishedInfoListener_GetClientContext(self);
+    RequestContext* ctx = nullptr;
     auto it = rr_map.find(response_info);
     if (it != rr_map.end()) {
         Cronet_UrlRequestPtr req = it->second;
         Cronet_ClientContext obj = Cronet_UrlRequest_GetClientContext(req);
         on_request_finished(obj, connect);
+        ctx = (RequestContext*)obj;
+        // 请求对象会被销毁或复用，response info 的地址随之可能被重用
+        rr_map.erase(it);
     }
-    else { 
+    else if (g_verbose) { 
         std::cout << "not find " << response_info << std::endl; 
     }
+    if (ctx) {
+        m.body_bytes = (int64_t)ctx->body_bytes;
+        m.attempt = ctx->attempt;
+        m.duration_us = (int64_t)ctx->latency_us;
+    }
+    if (ctx && ctx->prewarm) {
+        if (sinks && sinks->prewarm) {
+            sinks->prewarm->record(m);
+        }
+        g_progress.notify(g_progress.listened);
+        return;
+    }
+    // terminal 回调在同一执行器上先于 listener 执行，latency_us 已填好；对冲中被取消的一方不计入冷热拆分
+    bool hedge_loser = ctx && ctx->hedge && ctx->hedge->winner.load() != ctx->hedge_role;
+    if (ctx && m.has_metrics && !m.was_cached && !hedge_loser) {
+        (m.socket_reused ? g_latency.warm : g_latency.cold).record(ctx->latency_us);
+    }
+    if (ctx && sinks && sinks->cache) {
+        sinks->cache->record(m.was_cached, ctx->latency_us);
+    }
+
+    if (sinks && sinks->conn_stat) {
+        sinks->conn_stat->record(m);
+    }
+    if (sinks && sinks->goodput) {
+        sinks->goodput->record(m);
+    }
+    if (sinks && sinks->record_log) {
+        sinks->record_log->append(m);
+    }
+    if (ctx && ctx->trace && sinks && sinks->slow_requests) {
+        ctx->trace->add(TRACE_FINISHED_LISTENER);
+        sinks->slow_requests->offer(m, *ctx->trace);
+    }
+    if (ctx && sinks && sinks->capture) {
+        sinks->capture->record(ctx->endpoint, ctx->started, ctx->latency_us, m);
+    }
+    if (ctx && ctx->limiter) {
+        // listener 里的时间戳只到毫秒，延迟用 terminal 回调记下的微秒值
+        ctx->limiter->onSample(ctx->latency_us, ctx->admission->inFlight(),
+                               m.finished_reason != Cronet_RequestFinishedInfo_FINISHED_REASON_SUCCEEDED);
+    }
+    g_progress.notify(g_progress.listened);
 }
 
 #ifdef ENABLE_EXECUTOR_THREAD
 
-// 任务队列和线程管理
-class ExecutorThread {
-private:
-    std::queue<std::function<void()>> task_queue_;
-    std::mutex queue_mutex_;
-    std::condition_variable condition_;
-    std::thread worker_thread_;
-    std::atomic<bool> stop_{false};
-
-public:
-    ExecutorThread() {
-        worker_thread_ = std::thread([this]() {
-            this->run();
+void executor_func(Cronet_Executor *executor, Cronet_Runnable *cronet_task) {
+    ExecutorThread* et = (ExecutorThread*)Cronet_Executor_GetClientContext(executor); 
+    if (!et) {
+        std::cerr << "Executor not initialized!" << std::endl;
+        return;
+    }
+
+    // 将Cronet的任务包装成std::function
+    if (cronet_task) {
+        et->postTask([cronet_task]() {
+            // 执行Cronet任务，runnable 由执行器负责释放
+            Cronet_Runnable_Run(cronet_task);
+            Cronet_Runnable_Destroy(cronet_task);
         });
     }
+}
+
+#else
+
+// Executor
+void executor_func(Cronet_Executor *executor, Cronet_Runnable *runnable) {
+    Cronet_Runnable_Run(runnable);
+    Cronet_Runnable_Destroy(runnable);
+}
 
-    ~ExecutorThread() {
-        stop_ = true;
-        condition_.notify_all();
-        if (worker_thread_.joinable()) {
-            worker_thread_.join();
+#endif // ENABLE_EXECUTOR_THREAD
+
+// Create + Init + Start 的开销
+static StartCost g_start_cost;
+
+// 一个引擎及其独占的执行器、finished listener 和连接统计。
+// 单个引擎只有一个网络线程，多引擎用来观察吞吐是否随引擎数增长
+struct EngineShard {
+    Cronet_EnginePtr engine = nullptr;
+    ExecutorThread* executor_thread = nullptr;
+    Cronet_ExecutorPtr executor = nullptr;
+    Cronet_RequestFinishedInfoListenerPtr listener = nullptr;
+    ConnStat conn_stat;
+    FinishedSinks sinks;
+    std::atomic<uint64_t> started{0};
+};
+
+// 请求分配到引擎的方式
+enum ShardMode {
+    SHARD_ROUND_ROBIN,  // 按请求序号轮流
+    SHARD_HOST,         // 同一 host 固定在一个引擎，连接池不被拆散
+};
+
+// 发压计划：请求序列、回调以及请求到引擎的分配
+struct LoadPlan {
+    const Workload* workload = nullptr;
+    const std::vector<uint32_t>* order = nullptr;
+    Cronet_UrlRequestCallbackPtr callback = nullptr;
+    std::vector<EngineShard*> engines;
+    ShardMode shard = SHARD_ROUND_ROBIN;
+    std::vector<uint32_t> endpoint_engine;  // SHARD_HOST 时每个端点对应的引擎
+    const EndpointRegistry* registry = nullptr; // 为空时每个请求现场构建参数
+    bool trace = false;
+
+    // 不同 host 按首次出现的顺序轮流分给各引擎
+    void assignHosts() {
+        std::map<std::string, uint32_t> hosts;
+        endpoint_engine.resize(workload->endpoints.size());
+        for (size_t i = 0; i < workload->endpoints.size(); ++ i) {
+            std::string host = url_host(workload->endpoints[i].url);
+            auto it = hosts.find(host);
+            if (it == hosts.end()) {
+                uint32_t e = (uint32_t)(hosts.size() % engines.size());
+                it = hosts.insert(std::make_pair(host, e)).first;
+            }
+            endpoint_engine[i] = it->second;
         }
     }
+    // 同一序号总是分到同一个引擎
+    EngineShard* shardFor(uint64_t seq, uint32_t endpoint) const {
+        return engines[shard == SHARD_HOST ? endpoint_engine[endpoint] : (size_t)(seq % engines.size())];
+    }
+    EngineShard* engineFor(uint64_t seq, uint32_t endpoint) const {
+        EngineShard* es = shardFor(seq, endpoint);
+        es->started.fetch_add(1, std::memory_order_relaxed);
+        return es;
+    }
+};
 
-    void postTask(std::function<void()> task) {
-        {
-            std::lock_guard<std::mutex> lock(queue_mutex_);
-            task_queue_.push(std::move(task));
+// 用端点的参数模板初始化并启动第 seq 个请求，request 与 ctx 由调用方准备好。
+// 记录本线程从取参数到 Start 返回消耗的 CPU 与墙钟时间
+static void start_request(const LoadPlan& plan, Cronet_UrlRequestPtr request, uint64_t seq, uint32_t endpoint,
+                          RequestContext* ctx, std::chrono::steady_clock::time_point intended) {
+    uint64_t cpu_begin = thread_cpu_ns();
+    std::chrono::steady_clock::time_point wall_begin = std::chrono::steady_clock::now();
+    const Endpoint& ep = plan.workload->endpoints[endpoint];
+    EngineShard* es = plan.engineFor(seq, endpoint);
+    Cronet_UrlRequestParamsPtr req_params = plan.registry ? plan.registry->params(endpoint)
+                                                          : build_request_params(*plan.workload, ep);
+    Cronet_UrlRequest_SetClientContext(request, ctx);
+    Cronet_UrlRequest_InitWithParams(request, es->engine, ep.url.c_str(), req_params, plan.callback, es->executor);
+    if (!plan.registry) {
+        Cronet_UrlRequestParams_Destroy(req_params);
+    }
+    if (ctx->trace) {
+        ctx->trace->start();
+    }
+    ctx->endpoint = endpoint;
+    ctx->traffic_class = ep.class_index;
+    ctx->intended = intended;
+    ctx->started = std::chrono::steady_clock::now();
+    Cronet_UrlRequest_Start(request);
+    g_start_cost.cpu.record(thread_cpu_ns() - cpu_begin);
+    g_start_cost.wall.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - wall_begin).count());
+}
+
+// 闭环模式的一个槽位：同一时刻只有一个请求在飞，前一个结束时在其 terminal 回调里发起下一个。
+// 槽位只被自己的请求回调访问，不需要锁。请求对象与上下文按代交替使用两份：
+// finished listener 可能晚于 terminal 回调到达，第 k 个请求的上下文要保留到第 k+2 个发起时才复用
+struct LoadSlot {
+    ClosedLoop* loop = nullptr;
+    const LoadPlan* plan = nullptr;
+    RequestContext ctx[2];
+    Cronet_UrlRequestPtr request[2] = {nullptr, nullptr};
+    RequestTrace trace[2];
+    std::atomic<uint64_t> generation{0};   // 已发起的请求数，超时取消时 main 线程会读
+
+    ~LoadSlot() {
+        for (int g = 0; g < 2; ++ g) {
+            if (request[g]) {
+                Cronet_UrlRequest_Destroy(request[g]);
+            }
         }
-        condition_.notify_one();
     }
+    // 最近发起的请求
+    Cronet_UrlRequestPtr current() const {
+        uint64_t gen = generation.load();
+        return gen ? request[(gen - 1) & 1] : nullptr;
+    }
+};
 
-private:
-    void run() {
-        while (!stop_) {
-            std::function<void()> task;
-            {
-                std::unique_lock<std::mutex> lock(queue_mutex_);
-                condition_.wait(lock, [this]() {
-                    return stop_ || !task_queue_.empty();
-                });
+static void slot_start_next(LoadSlot* slot) {
+    uint64_t seq;
+    if (!slot->loop->acquire(&seq)) {
+        return;
+    }
+    const LoadPlan& t = *slot->plan;
+    uint32_t e = (*t.order)[seq % t.order->size()];
+    uint64_t gen = slot->generation.load();
+    int g = (int)(gen & 1);
+    if (slot->request[g]) {
+        // 第 k-2 个请求，回调与 listener 都早已结束
+        Cronet_UrlRequest_Destroy(slot->request[g]);
+    }
+    RequestContext& ctx = slot->ctx[g];
+    ctx.done = false;
+    ctx.body_bytes = 0;
+    ctx.slot = slot;
+    ctx.trace = t.trace ? &slot->trace[g] : nullptr;
+    Cronet_UrlRequestPtr request = Cronet_UrlRequest_Create();
+    slot->request[g] = request;
+    slot->generation.store(gen + 1);
+    start_request(t, request, seq, e, &ctx, std::chrono::steady_clock::now());
+}
 
-                if (stop_ && task_queue_.empty()) {
-                    return;
+static void slot_request_done(LoadSlot* slot, bool succeeded) {
+    slot->loop->complete(succeeded);
+    slot_start_next(slot);
+}
+
+// 创建 count 个引擎，每个引擎有自己的执行器和监听器；sinks 中除 conn_stat 外由各引擎共用。
+// 引擎启动失败时返回 false，已创建的引擎仍在 shards 中由调用方销毁
+static bool create_shards(std::vector<std::unique_ptr<EngineShard>>* shards, int count, Cronet_EngineParamsPtr params,
+                          const FinishedSinks& sinks) {
+    for (int e = 0; e < count; ++ e) {
+        shards->push_back(std::unique_ptr<EngineShard>(new EngineShard));
+        EngineShard& es = *shards->back();
+        es.engine = Cronet_Engine_Create();
+        Cronet_RESULT result = Cronet_Engine_StartWithParams(es.engine, params);
+        if (result != Cronet_RESULT_SUCCESS) {
+            std::cerr << "engine start failed: " << result << std::endl;
+            es.executor = Cronet_Executor_CreateWith(executor_func);
+            return false;
+        }
+#ifdef ENABLE_EXECUTOR_THREAD
+        es.executor_thread = new ExecutorThread(count > 1 ? "executor-" + std::to_string(e) : "executor"); 
+        es.executor = Cronet_Executor_CreateWith(executor_func);
+        Cronet_Executor_SetClientContext(es.executor, es.executor_thread); 
+#else
+        // will crash on first callback arrived if no callback
+        // Cronet_ExecutorPtr executor = Cronet_Executor_CreateWith(NULL);
+        es.executor = Cronet_Executor_CreateWith(executor_func);
+#endif
+        es.sinks = sinks;
+        es.sinks.conn_stat = &es.conn_stat; 
+        es.listener = Cronet_RequestFinishedInfoListener_CreateWith(on_request_finished_listener);
+        if (es.listener) {
+            Cronet_RequestFinishedInfoListener_SetClientContext(es.listener, &es.sinks); 
+            Cronet_Engine_AddRequestFinishedListener(es.engine, es.listener, es.executor);
+        }
+        else {
+            std::cout << "setup request finished listener failed, no connection statistic provided" << std::endl;
+        }
+    }
+    return true;
+}
+
+// 多个引擎或多组参数时每个引擎各写一个 NetLog：a.json -> a.<参数组>.<引擎序号>.json
+static std::string netlog_path(const std::string& base, const std::string& config, size_t engine, bool per_config,
+                               bool per_engine) {
+    std::string suffix;
+    if (per_config) {
+        suffix += "." + config;
+    }
+    if (per_engine) {
+        suffix += "." + std::to_string(engine);
+    }
+    size_t dot = base.rfind('.');
+    size_t slash = base.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return base + suffix;
+    }
+    return base.substr(0, dot) + suffix + base.substr(dot);
+}
+
+static void destroy_shards(std::vector<std::unique_ptr<EngineShard>>* shards) {
+    for (size_t e = 0; e < shards->size(); ++ e) {
+        EngineShard& es = *(*shards)[e];
+        if (es.listener) {
+            Cronet_Engine_RemoveRequestFinishedListener(es.engine, es.listener);
+            Cronet_RequestFinishedInfoListener_Destroy(es.listener);
+        }
+        delete es.executor_thread; 
+        Cronet_Executor_Destroy(es.executor);
+        Cronet_Engine_Destroy(es.engine);
+    }
+    shards->clear();
+}
+
+// 等各引擎执行器上已投递的任务执行完
+static void drain_executors(const LoadPlan& plan) {
+    for (size_t e = 0; e < plan.engines.size(); ++ e) {
+        ExecutorThread* et = plan.engines[e]->executor_thread;
+        if (!et) {
+            continue;
+        }
+        std::promise<void> done;
+        et->postTask([&done]() { done.set_value(); });
+        done.get_future().wait();
+    }
+}
+
+// 销毁一轮请求前调用：rr_map 在各执行器线程上各有一份，清掉其中还没等到 listener 的条目（超时取消的请求、
+// 重定向留下的 response info），之后迟到的 listener 找不到请求，不会访问已销毁的对象
+static void forget_requests(const LoadPlan& plan) {
+    for (size_t e = 0; e < plan.engines.size(); ++ e) {
+        ExecutorThread* et = plan.engines[e]->executor_thread;
+        if (!et) {
+            continue;
+        }
+        std::promise<void> done;
+        et->postTask([&done]() {
+            rr_map.clear();
+            done.set_value();
+        });
+        done.get_future().wait();
+    }
+}
+
+// 一轮结束（或超时取消）后等 issued 个请求的 terminal 回调与 listener 追上；
+// 等不到的 listener 会被 forget_requests 丢弃
+static void wait_listeners(uint64_t issued) {
+    if (!g_progress.waitFor(issued, std::chrono::seconds(5))) {
+        uint64_t expected = issued + g_progress.extra.load();
+        uint64_t listened = g_progress.listened.load();
+        std::cerr << "warning: " << (expected > listened ? expected - listened : 0)
+                  << " finished listener callback(s) still outstanding, dropped" << std::endl;
+    }
+}
+
+// 依次以各个并发数跑闭环，每轮结束后等 finished listener 全部到达再进入下一轮
+static std::vector<ConcurrencyResult> run_closed_loop(const LoadPlan& plan, const std::vector<size_t>& levels,
+                                                      uint64_t max_requests, double duration_s, int timeout_s) {
+    std::vector<ConcurrencyResult> results;
+    for (size_t l = 0; l < levels.size(); ++ l) {
+        g_latency.from_start.reset();
+        g_latency.cold.reset();
+        g_latency.warm.reset();
+        ClosedLoop loop(levels[l], max_requests, duration_s);
+        std::vector<std::unique_ptr<LoadSlot>> slots;
+        for (size_t i = 0; i < loop.concurrency(); ++ i) {
+            slots.push_back(std::unique_ptr<LoadSlot>(new LoadSlot));
+            slots.back()->loop = &loop;
+            slots.back()->plan = &plan;
+        }
+        for (size_t i = 0; i < slots.size(); ++ i) {
+            slot_start_next(slots[i].get());
+        }
+        if (!loop.waitIdle(std::chrono::seconds((int)duration_s + timeout_s))) {
+            loop.stop();
+            for (size_t i = 0; i < slots.size(); ++ i) {
+                Cronet_UrlRequestPtr request = slots[i]->current();
+                if (request) {
+                    Cronet_UrlRequest_Cancel(request);
                 }
+            }
+            loop.waitIdle(std::chrono::seconds(5));
+        }
+        wait_listeners(g_progress.completed.load());
+        forget_requests(plan);
+
+        ConcurrencyResult r;
+        r.concurrency = loop.concurrency();
+        r.completed = loop.completed();
+        r.failed = loop.failed();
+        r.seconds = loop.elapsed();
+        r.latency = g_latency.from_start.snapshot();
+        results.push_back(r);
+        std::cout << "concurrency " << r.concurrency << ": " << r.completed << " requests in " << r.seconds
+                  << " s, " << (r.seconds > 0 ? r.completed / r.seconds : 0) << " req/s" << std::endl;
+    }
+    return results;
+}
 
-                task = std::move(task_queue_.front());
-                task_queue_.pop();
+// 预热：每个 origin 在会用到它的每个引擎上并发发 per_origin 个 HEAD（HTTP/1.1 下即预建这么多连接），
+// 通过 finished listener 等全部结束后返回，之后的负载从热的连接池开始。stat 为预热请求的连接统计
+static void prewarm_origins(const LoadPlan& plan, size_t per_origin, int timeout_s, const ConnStat& stat) {
+    // origin -> 第一个属于它的端点，HEAD 发到这个端点的 URL
+    std::map<std::string, uint32_t> origins;
+    for (size_t i = 0; i < plan.workload->endpoints.size(); ++ i) {
+        const std::string& url = plan.workload->endpoints[i].url;
+        size_t scheme = url.find("://");
+        std::string origin = (scheme == std::string::npos ? "" : url.substr(0, scheme + 3)) + url_host(url);
+        origins.insert(std::make_pair(origin, (uint32_t)i));
+    }
+    std::vector<std::pair<uint32_t, EngineShard*>> targets;
+    for (auto it = origins.begin(); it != origins.end(); ++ it) {
+        for (size_t e = 0; e < plan.engines.size(); ++ e) {
+            if (plan.shard == SHARD_HOST && plan.endpoint_engine[it->second] != e) {
+                continue;
+            }
+            for (size_t n = 0; n < per_origin; ++ n) {
+                targets.push_back(std::make_pair(it->second, plan.engines[e]));
             }
+        }
+    }
 
-            // 执行任务
-            if (task) {
-                try {
-                    task();
-                } catch (const std::exception& e) {
-                    std::cerr << "Executor task error: " << e.what() << std::endl;
-                }
+    g_progress.reset();
+    std::vector<Cronet_UrlRequestPtr> request(targets.size(), nullptr);
+    std::vector<RequestContext> ctx(targets.size());
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < targets.size(); ++ i) {
+        Endpoint head = plan.workload->endpoints[targets[i].first];
+        head.method = "HEAD";
+        head.disable_cache = true;
+        Cronet_UrlRequestParamsPtr req_params = build_request_params(*plan.workload, head);
+        EngineShard* es = targets[i].second;
+        request[i] = Cronet_UrlRequest_Create();
+        ctx[i].prewarm = true;
+        ctx[i].endpoint = targets[i].first;
+        Cronet_UrlRequest_SetClientContext(request[i], &ctx[i]);
+        Cronet_UrlRequest_InitWithParams(request[i], es->engine, head.url.c_str(), req_params, plan.callback,
+                                         es->executor);
+        Cronet_UrlRequestParams_Destroy(req_params);
+        ctx[i].intended = ctx[i].started = std::chrono::steady_clock::now();
+        Cronet_UrlRequest_Start(request[i]);
+    }
+    bool finished = g_progress.waitFor(targets.size(), std::chrono::seconds(timeout_s));
+    if (!finished) {
+        for (size_t i = 0; i < targets.size(); ++ i) {
+            if (!ctx[i].done) {
+                Cronet_UrlRequest_Cancel(request[i]);
             }
         }
+        wait_listeners(targets.size());
+    }
+    double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << "prewarm: " << targets.size() << " HEAD request(s) to " << origins.size() << " origin(s) in "
+              << elapsed_ms << " ms, succeeded=" << stat.finished(Cronet_RequestFinishedInfo_FINISHED_REASON_SUCCEEDED)
+              << (finished ? "" : " (timeout)") << std::endl;
+    ConnSummary warm = ConnStat::summarize(std::vector<const ConnStat*>(1, &stat));
+    print_percentiles(std::cout, "prewarm dns", warm.dns);
+    print_percentiles(std::cout, "prewarm connect", warm.connect);
+    print_percentiles(std::cout, "prewarm ssl", warm.ssl);
+    forget_requests(plan);
+    for (size_t i = 0; i < targets.size(); ++ i) {
+        Cronet_UrlRequest_Destroy(request[i]);
     }
+    g_progress.reset();
+}
+
+// 非闭环模式的发压参数
+struct RunOptions {
+    double rate = 0;                                    // > 0 时开环
+    OpenLoopScheduler::Arrival arrival = OpenLoopScheduler::ARRIVAL_FIXED;
+    uint32_t seed = 1;
+    const std::vector<double>* replay_offsets = nullptr;    // 回放时各请求相对首个请求的发起时间
+    int timeout_s = 600;
+    size_t max_in_flight = 0;                           // > 0 时经本地准入调度，最多这么多请求在飞
+    AdmissionScheduler::Order admission_order = AdmissionScheduler::ORDER_PRIORITY;
+    LimitPolicy limit;                                  // 开启时按延迟调整 max_in_flight
+    HedgePolicy hedge;
+    RetryPolicy retry;
+    bool coalesce = false;                              // 合并在途的相同 GET
 };
 
-void executor_func(Cronet_Executor *executor, Cronet_Runnable *cronet_task) {
-    ExecutorThread* et = (ExecutorThread*)Cronet_Executor_GetClientContext(executor); 
-    if (!et) {
-        std::cerr << "Executor not initialized!" << std::endl;
-        return;
+// 各负载类的延迟（从预定时间算起，含本地排队）与排队时间
+static void print_class_latency(std::ostream& os, const Workload& workload) {
+    for (size_t c = 0; c < workload.classes.size() && c < g_latency.by_class.size(); ++ c) {
+        const TrafficClass& tc = workload.classes[c];
+        const LoadLatency::ClassLatency& cl = *g_latency.by_class[c];
+        os << "class " << tc.name << " (priority=" << priority_name(tc.priority) << "):" << std::endl;
+        print_percentiles(os, "  latency", cl.latency.snapshot());
+        print_percentiles(os, "  queue wait", cl.queue_wait.snapshot());
     }
+}
 
-    // 将Cronet的任务包装成std::function
-    if (cronet_task) {
-        et->postTask([cronet_task]() {
-            // 执行Cronet任务
-            Cronet_Runnable_Run(cronet_task);
+// 发起 plan 中的全部请求并等待结束（含 finished listener）。默认一次全部交给引擎排队；
+// 开环模式下由定时线程按预定时间发起。指定 max_in_flight 时先经本地准入调度，
+// 窗口满后按优先级（或先到先出）排队，在前面的请求结束时由回调线程发起。
+// 开启对冲时，可对冲的请求超过阈值仍没收到响应头就在其执行器线程上再发一个副本。返回前销毁请求
+static void run_load(const LoadPlan& plan, const RunOptions& opts) {
+    const size_t total = plan.order->size();
+    std::vector<Cronet_UrlRequestPtr> request(total, nullptr); 
+    std::vector<RequestContext> ctx(total); 
+    std::vector<RequestTrace> trace(plan.trace ? total : 0); 
+    std::unique_ptr<HedgeController> hedging(opts.hedge.enabled() ? new HedgeController(opts.hedge) : nullptr);
+    std::vector<HedgeGroup> groups(hedging ? total : 0);
+    std::vector<RequestContext> hedge_ctx(hedging ? total : 0);
+    std::vector<Cronet_UrlRequestPtr> hedge_request(hedging ? total : 0, nullptr);
+    AdmissionScheduler* window = nullptr;      // 有准入窗口时副本也要占一个位置
+    auto issue_hedge = [&](size_t i) {
+        HedgeGroup& g = groups[i];
+        if (g.winner.load() >= 0) {
+            return;
+        }
+        // 副本是投机的，窗口满时不排队，直接放弃
+        if (window && !window->tryAcquire()) {
+            hedging->onWindowFull();
+            return;
+        }
+        if (!hedging->acquire()) {
+            if (window) {
+                window->complete();
+            }
+            return;
+        }
+        hedge_request[i] = Cronet_UrlRequest_Create();
+        hedge_ctx[i].admission = window;
+        hedge_ctx[i].hedge = &g;
+        hedge_ctx[i].hedge_role = 1;
+        g.request[1] = hedge_request[i];
+        g.ctx[1] = &hedge_ctx[i];
+        ++ g.pending;
+        g_progress.extra.fetch_add(1);
+        start_request(plan, hedge_request[i], i, (*plan.order)[i], &hedge_ctx[i], ctx[i].intended);
+    };
+    std::unique_ptr<RetryController> retrying(opts.retry.enabled() ? new RetryController(opts.retry) : nullptr);
+    std::vector<RetryChain> chains(retrying ? total : 0);
+    auto issue_retry = [&](size_t i) {
+        RetryChain& c = chains[i];
+        c.ctx.push_back(std::unique_ptr<RequestContext>(new RequestContext));
+        RequestContext* rctx = c.ctx.back().get();
+        rctx->retry = &c;
+        rctx->attempt = (int)c.ctx.size();
+        c.request.push_back(Cronet_UrlRequest_Create());
+        c.scheduled = false;
+        start_request(plan, c.request.back(), i, (*plan.order)[i], rctx, ctx[i].intended);
+    };
+    // 退避到期时转到原请求的执行器线程上发起下一次尝试
+    std::function<bool(size_t, uint64_t)> schedule_retry = [&](size_t i, uint64_t backoff_us) {
+        ExecutorThread* et = plan.shardFor(i, (*plan.order)[i])->executor_thread;
+        return retrying->timer().schedule(std::chrono::steady_clock::now() + std::chrono::microseconds(backoff_us),
+                                   [&issue_retry, et, i]() {
+            if (et) {
+                et->postTask([&issue_retry, i]() { issue_retry(i); });
+            }
+            else {
+                issue_retry(i);
+            }
         });
+    };
+    std::unique_ptr<SingleFlight> coalescing(opts.coalesce
+        ? new SingleFlight(*plan.workload, on_coalesced_read) : nullptr);
+    auto launch = [&](size_t i) {
+        const uint32_t endpoint = (*plan.order)[i];
+        const Endpoint& ep = plan.workload->endpoints[endpoint];
+        int key = coalescing ? coalescing->key(endpoint) : -1;
+        if (key >= 0) {
+            // 加入后 leader 随时可能在回调线程上结束它，先填好延迟统计要用的字段
+            ctx[i].endpoint = endpoint;
+            ctx[i].traffic_class = ep.class_index;
+            ctx[i].started = std::chrono::steady_clock::now();
+            bool leader = false;
+            Flight* flight = coalescing->join(key, &ctx[i], &leader);
+            if (!leader) {
+                return;
+            }
+            ctx[i].flight = flight;
+        }
+        request[i] = Cronet_UrlRequest_Create();
+        if (plan.trace) {
+            ctx[i].trace = &trace[i];
+        }
+        HedgeGroup* g = nullptr;
+        if (hedging && hedge_eligible(ep)) {
+            g = &groups[i];
+            g->controller = hedging.get();
+            g->request[0] = request[i];
+            g->ctx[0] = &ctx[i];
+            ctx[i].hedge = g;
+        }
+        else if (retrying && retry_eligible(ep)) {
+            // 对冲的请求已有副本兜底，不再重试
+            RetryChain& c = chains[i];
+            c.controller = retrying.get();
+            c.schedule = &schedule_retry;
+            c.index = i;
+            c.origin = &ctx[i];
+            ctx[i].retry = &c;
+            retrying->onRequest();
+        }
+        start_request(plan, request[i], i, endpoint, &ctx[i], ctx[i].intended);
+        if (!g) {
+            return;
+        }
+        hedging->onPrimary();
+        uint64_t threshold = hedging->threshold();
+        ExecutorThread* et = plan.shardFor(i, endpoint)->executor_thread;
+        if (threshold > 0 && et) {
+            // 到期时转到原请求的执行器线程上决定是否发副本
+            hedging->timer().schedule(ctx[i].started + std::chrono::microseconds(threshold), [&issue_hedge, g, et, i]() {
+                if (g->winner.load() < 0) {
+                    et->postTask([&issue_hedge, i]() { issue_hedge(i); });
+                }
+            });
+        }
+    };
+    AdmissionScheduler admission(opts.max_in_flight, opts.admission_order, launch);
+    if (opts.max_in_flight > 0) {
+        window = &admission;
+    }
+    std::unique_ptr<ConcurrencyLimiter> limiter(opts.limit.enabled()
+        ? new ConcurrencyLimiter(opts.limit, [&admission](size_t limit) { admission.setWindow(limit); }) : nullptr);
+    auto start_one = [&](size_t i, std::chrono::steady_clock::time_point intended) {
+        ctx[i].intended = intended;
+        if (opts.max_in_flight > 0) {
+            ctx[i].admission = &admission;
+            ctx[i].limiter = limiter.get();
+            admission.submit(i, plan.workload->endpoints[(*plan.order)[i]].effectivePriority());
+        }
+        else {
+            launch(i);
+        }
+    };
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    OpenLoopScheduler scheduler(opts.rate, opts.arrival, opts.seed);
+    const bool open_loop = opts.rate > 0 || opts.replay_offsets;
+    if (opts.replay_offsets) {
+        scheduler.replay(*opts.replay_offsets, start_one);
+        scheduler.join();
+    }
+    else if (opts.rate > 0) {
+        scheduler.start(total, start_one);
+        scheduler.join();
+    }
+    else {
+        for (size_t i = 0; i < total; ++ i) {
+            start_one(i, std::chrono::steady_clock::now());
+        }
     }
-}
 
-#else
+    bool finished = g_progress.waitFor(total, std::chrono::seconds(opts.timeout_s));
+    if (hedging || retrying) {
+        // 不再发副本与重试，等已投到执行器上的任务执行完，之后 hedge_request 与 chains 不再变化
+        if (hedging) {
+            hedging->timer().stop();
+        }
+        if (retrying) {
+            retrying->timer().stop();
+        }
+        drain_executors(plan);
+        // 定时线程丢掉的重试不会再发起，这些逻辑请求以上一次失败结束
+        for (size_t i = 0; retrying && i < total; ++ i) {
+            if (chains[i].scheduled) {
+                retry_abandon(&chains[i]);
+            }
+        }
+    }
+    if (!finished) {
+        // 还在本地排队的请求不再发起；超时的请求先取消，等它们的 terminal 回调后再销毁
+        size_t dropped = opts.max_in_flight > 0 ? admission.stop() : 0;
+        for (size_t i = 0; i < total; ++ i) {
+            if (request[i] && !ctx[i].done) {
+                Cronet_UrlRequest_Cancel(request[i]);
+            }
+            if (hedging && hedge_request[i] && !hedge_ctx[i].done) {
+                Cronet_UrlRequest_Cancel(hedge_request[i]);
+            }
+            for (size_t a = 0; retrying && a < chains[i].request.size(); ++ a) {
+                if (!chains[i].ctx[a]->done) {
+                    Cronet_UrlRequest_Cancel(chains[i].request[a]);
+                }
+            }
+        }
+        wait_listeners(total - dropped);
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << (finished ? "all requests finished" : "timeout") << ": completed=" << g_progress.completed.load()
+              << "/" << total << " in " << elapsed << " s, " << (elapsed > 0 ? g_progress.completed.load() / elapsed : 0)
+              << " req/s" << std::endl;
+    if (open_loop) {
+        scheduler.report(std::cout);
+    }
+    print_percentiles(std::cout, open_loop ? "latency (from intended)" : "latency", g_latency.from_intended.snapshot());
+    if (open_loop) {
+        print_percentiles(std::cout, "latency (from Start)", g_latency.from_start.snapshot());
+    }
+    if (opts.max_in_flight > 0) {
+        admission.report(std::cout);
+    }
+    if (limiter) {
+        limiter->report(std::cout);
+    }
+    print_class_latency(std::cout, *plan.workload);
+    if (hedging) {
+        hedging->report(std::cout);
+    }
+    if (retrying) {
+        retrying->report(std::cout);
+    }
+    if (coalescing) {
+        coalescing->report(std::cout);
+    }
+    forget_requests(plan);
+    for (size_t i = 0; i < total; ++ i) { 
+        if (request[i]) {
+            Cronet_UrlRequest_Destroy(request[i]);
+        }
+        if (hedging && hedge_request[i]) {
+            Cronet_UrlRequest_Destroy(hedge_request[i]);
+        }
+        for (size_t a = 0; retrying && a < chains[i].request.size(); ++ a) {
+            Cronet_UrlRequest_Destroy(chains[i].request[a]);
+        }
+    }
+}
 
-// Executor
-void executor_func(Cronet_Executor *executor, Cronet_Runnable *runnable) {
-    Cronet_Runnable_Run(runnable);
+// 双向流压测不走 UrlRequest 与 finished listener，每组引擎参数各建一个引擎跑一遍
+static int run_bidi_mode(std::vector<EngineConfig> configs, const BidiBenchOptions& options) {
+    if (configs.empty()) {
+        configs.push_back(EngineConfig());
+        configs.back().name = "default";
+    }
+    std::cout << "bidi: " << options.streams << " streams x " << options.message_bytes << " B, window "
+              << options.window << ", " << options.url << std::endl;
+    if (options.batching()) {
+        std::cout << "bidi write batching: " << options.batch_bytes << " B / " << options.batch_us << " us" << std::endl;
+    }
+    bool ok = true;
+    for (size_t c = 0; c < configs.size(); ++ c) {
+        if (configs.size() > 1) {
+            std::cout << "==== engine config " << configs[c].name << " (" << configs[c].describe() << ") ===="
+                      << std::endl;
+        }
+        Cronet_EngineParamsPtr params = Cronet_EngineParams_Create();
+        apply_engine_config(configs[c], params);
+        Cronet_EnginePtr engine = Cronet_Engine_Create();
+        Cronet_RESULT started = Cronet_Engine_StartWithParams(engine, params);
+        Cronet_EngineParams_Destroy(params);
+        if (started != Cronet_RESULT_SUCCESS) {
+            std::cerr << "engine start failed: " << started << std::endl;
+            Cronet_Engine_Destroy(engine);
+            return 1;
+        }
+        BidiBenchResult result;
+        if (!run_bidi_bench(engine, options, &result)) {
+            std::cerr << "bidi: timed out after " << options.timeout_s << " s, remaining streams canceled" << std::endl;
+            ok = false;
+        }
+        print_bidi_result(std::cout, result);
+        ok = ok && result.streams_ok > 0;
+        Cronet_Engine_Shutdown(engine);
+        Cronet_Engine_Destroy(engine);
+    }
+    return ok ? 0 : 1;
 }
 
-#endif // ENABLE_EXECUTOR_THREAD
+int main(int argc, char* argv[]) {
+    // --metrics-port N: 在 127.0.0.1:N 上提供 OpenMetrics 抓取（0 为随机端口）
+    int metrics_port = -1;
+    std::string metrics_addr = "127.0.0.1";
+    // --record-log DIR: 每个请求的指标按列追加写入 DIR/*.col，用 cronet_record_reader 分析
+    std::string record_dir;
+    // --slow-k K: 每个周期（--slow-interval-ms，默认 10000）保留最慢的 K 个请求的回调时间线
+    size_t slow_k = 0;
+    uint64_t slow_interval_ms = 10000;
+    // --workload FILE 见 workload.h；也可以用 --url/--method/--header/--requests 直接指定
+    std::string workload_file;
+    std::vector<std::string> urls;
+    std::string method = "GET";
+    std::vector<std::string> headers;
+    uint64_t requests = 0;
+    uint32_t seed = 1;
+    int timeout_s = -1;
+    int verbose = -1;
+    // --rate R: 开环模式，按 R req/s 发起（--arrival fixed|poisson），--duration-s 时请求数为 R * D
+    double rate = 0;
+    OpenLoopScheduler::Arrival arrival = OpenLoopScheduler::ARRIVAL_FIXED;
+    double duration_s = 0;
+    // --concurrency N[,N...]: 闭环模式，保持 N 个请求在飞，每个 N 跑 --duration-s 或 --requests 个请求
+    std::vector<size_t> concurrency;
+    // --engines K: K 个引擎，各自的执行器与 listener；--shard rr|host 决定请求分到哪个引擎
+    int engine_count = 1;
+    ShardMode shard = SHARD_ROUND_ROBIN;
+    // --no-param-cache: 每个请求现场构建参数，用于和端点参数模板对比发起开销
+    bool param_cache = true;
+    // --capture FILE: 录制每个请求的 URL、发起时间、大小与各阶段耗时；
+    // --replay FILE: 按录制的间隔重新发起（--replay-speed X 倍速），并与录制的延迟分布对比
+    std::string capture_file;
+    std::string replay_file;
+    double replay_speed = 1.0;
+    // --engine-config NAME:quic=on,h2=off,brotli=on,quic-hint=HOST:PORT,options=JSON，可重复；
+    // 同一负载在每组引擎参数下各用新引擎跑一遍，最后并排对比各连接阶段
+    std::vector<EngineConfig> engine_configs;
+    // --prewarm N: 正式发压前对每个 origin 发 N 个 HEAD 预建连接
+    size_t prewarm = 0;
+    // --cache memory|disk|disk-no-http: 开启 HTTP 缓存（--cache-size 字节，--cache-dir 为磁盘缓存目录，
+    // 默认新建临时目录），--rounds N 在同一引擎上把负载重复跑 N 轮，报告各轮命中率与预热时间，
+    // 延迟与连接复用统计只取最后一轮
+    HttpCacheOptions cache;
+    int rounds = 1;
+    // --netlog FILE: 每个引擎把 NetLog 写到 FILE（--netlog-all 同时记录字节级事件），
+    // 用 cronet_netlog_parser 离线解析并与 --record-log 的逐请求记录对齐
+    std::string netlog_file;
+    bool netlog_all = false;
+    // --bidi M: 双向流压测，M 个流同时写消息读回显（--bidi-message-bytes，--bidi-window 为每流在途消息数，
+    // --bidi-messages 为每流消息数，或用 --duration-s 限时），URL 取第一个 --url；
+    // --bidi-batch-bytes N / --bidi-batch-us T 开启批量写，攒够 N 字节或等满 T 微秒再 flush
+    BidiBenchOptions bidi;
+    bidi.streams = 0;
+    // --max-in-flight N: 本地准入窗口，超出的请求在本地排队，--admission priority|fifo 决定放行顺序；
+    // 负载文件里用 class 把端点分成 interactive、bulk 等类，按类报告延迟
+    size_t max_in_flight = 0;
+    AdmissionScheduler::Order admission_order = AdmissionScheduler::ORDER_PRIORITY;
+    // --adaptive-limit aimd|gradient: 准入窗口不再固定，按请求延迟自动调整，--max-in-flight 为初始值，
+    // --limit-max N 为上限，--limit-tolerance X 为延迟超过基线多少倍算排队；报告每秒的窗口大小
+    LimitPolicy limit;
+    // --hedge Q: 幂等的 GET 超过 Start 到响应头耗时的 Q 分位数仍没收到响应头时发一个副本，先到的胜出；
+    // --hedge-budget F 限制副本不超过请求数的 F，--hedge-min-ms 为阈值下限；有 --max-in-flight 时副本也占窗口，满了不发
+    HedgePolicy hedge;
+    // --retries N: 可重试的错误（连接重置、超时等）最多重试 N 次，退避在 [0, B * 2^(n-1)] 中均匀抽取
+    // （--retry-backoff-ms B，上限 --retry-max-backoff-ms），--retry-budget F 限制重试不超过请求数的 F；
+    // 没有声明幂等性的幂等方法（GET/HEAD/OPTIONS/PUT/DELETE）会被标记为幂等，只重试幂等的请求
+    RetryPolicy retry;
+    // --coalesce: 相同的 GET 已在途时不再发请求，挂到在途请求上共用它的响应
+    bool coalesce = false;
+    for (int i = 1; i < argc; ++ i) {
+        if (strcmp(argv[i], "--metrics-port") == 0 && i + 1 < argc) {
+            metrics_port = atoi(argv[++ i]);
+        }
+        else if (strcmp(argv[i], "--metrics-addr") == 0 && i + 1 < argc) {
+            metrics_addr = argv[++ i];
+        }
+        else if (strcmp(argv[i], "--record-log") == 0 && i + 1 < argc) {
+            record_dir = argv[++ i];
+        }
+        else if (strcmp(argv[i], "--slow-k") == 0 && i + 1 < argc) {
+            slow_k = (size_t)atoi(argv[++ i]);
+        }
+        else if (strcmp(argv[i], "--slow-interval-ms") == 0 && i + 1 < argc) {
+            slow_interval_ms = (uint64_t)atoll(argv[++ i]);
+        }
+        else if (strcmp(argv[i], "--workload") == 0 && i + 1 < argc) {
+            workload_file = argv[++ i];
+        }
+        else if (strcmp(argv[i], "--url") == 0 && i + 1 < argc) {
+            urls.push_back(argv[++ i]);
+        }
+        else if (strcmp(argv[i], "--method") == 0 && i + 1 < argc) {
+            method = argv[++ i];
+        }
+        else if (strcmp(argv[i], "--header") == 0 && i + 1 < argc) {
+            headers.push_back(argv[++ i]);
+        }
+        else if (strcmp(argv[i], "--requests") == 0 && i + 1 < argc) {
+            requests = strtoull(argv[++ i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (uint32_t)strtoul(argv[++ i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--timeout-s") == 0 && i + 1 < argc) {
+            timeout_s = atoi(argv[++ i]);
+        }
+        else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            rate = atof(argv[++ i]);
+        }
+        else if (strcmp(argv[i], "--arrival") == 0 && i + 1 < argc) {
+            if (!OpenLoopScheduler::parseArrival(argv[++ i], &arrival)) {
+                std::cerr << "unknown arrival " << argv[i] << ", expect fixed or poisson" << std::endl;
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--duration-s") == 0 && i + 1 < argc) {
+            duration_s = atof(argv[++ i]);
+        }
+        else if (strcmp(argv[i], "--concurrency") == 0 && i + 1 < argc) {
+            const char* p = argv[++ i];
+            while (*p) {
+                char* end = nullptr;
+                unsigned long n = strtoul(p, &end, 10);
+                if (end == p) {
+                    break;
+                }
+                if (n > 0) {
+                    concurrency.push_back((size_t)n);
+                }
+                p = *end == ',' ? end + 1 : end;
+            }
+        }
+        else if (strcmp(argv[i], "--engines") == 0 && i + 1 < argc) {
+            engine_count = atoi(argv[++ i]);
+            if (engine_count < 1) {
+                engine_count = 1;
+            }
+        }
+        else if (strcmp(argv[i], "--shard") == 0 && i + 1 < argc) {
+            const char* mode = argv[++ i];
+            if (strcmp(mode, "rr") == 0) {
+                shard = SHARD_ROUND_ROBIN;
+            }
+            else if (strcmp(mode, "host") == 0) {
+                shard = SHARD_HOST;
+            }
+            else {
+                std::cerr << "unknown shard mode " << mode << ", expect rr or host" << std::endl;
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            capture_file = argv[++ i];
+        }
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_file = argv[++ i];
+        }
+        else if (strcmp(argv[i], "--replay-speed") == 0 && i + 1 < argc) {
+            replay_speed = atof(argv[++ i]);
+            if (replay_speed <= 0) {
+                std::cerr << "--replay-speed must be positive" << std::endl;
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--engine-config") == 0 && i + 1 < argc) {
+            EngineConfig config;
+            std::string error;
+            if (!parse_engine_config(argv[++ i], &config, &error)) {
+                std::cerr << "engine config: " << error << std::endl;
+                return 1;
+            }
+            engine_configs.push_back(config);
+        }
+        else if (strcmp(argv[i], "--prewarm") == 0 && i + 1 < argc) {
+            prewarm = (size_t)atoi(argv[++ i]);
+        }
+        else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            if (!parse_http_cache_mode(argv[++ i], &cache.mode)) {
+                std::cerr << "unknown cache mode " << argv[i] << ", expect memory, disk, disk-no-http or off" << std::endl;
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--cache-size") == 0 && i + 1 < argc) {
+            cache.max_size = atoll(argv[++ i]);
+        }
+        else if (strcmp(argv[i], "--cache-dir") == 0 && i + 1 < argc) {
+            cache.dir = argv[++ i];
+        }
+        else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+            rounds = atoi(argv[++ i]);
+            if (rounds < 1) {
+                rounds = 1;
+            }
+        }
+        else if (strcmp(argv[i], "--netlog") == 0 && i + 1 < argc) {
+            netlog_file = argv[++ i];
+        }
+        else if (strcmp(argv[i], "--netlog-all") == 0) {
+            netlog_all = true;
+        }
+        else if (strcmp(argv[i], "--bidi") == 0 && i + 1 < argc) {
+            bidi.streams = (size_t)atoi(argv[++ i]);
+        }
+        else if (strcmp(argv[i], "--bidi-message-bytes") == 0 && i + 1 < argc) {
+            bidi.message_bytes = (size_t)atoi(argv[++ i]);
+        }
+        else if (strcmp(argv[i], "--bidi-window") == 0 && i + 1 < argc) {
+            bidi.window = (size_t)atoi(argv[++ i]);
+        }
+        else if (strcmp(argv[i], "--bidi-messages") == 0 && i + 1 < argc) {
+            bidi.messages = (uint64_t)atoll(argv[++ i]);
+        }
+        else if (strcmp(argv[i], "--bidi-batch-bytes") == 0 && i + 1 < argc) {
+            bidi.batch_bytes = (size_t)atoll(argv[++ i]);
+        }
+        else if (strcmp(argv[i], "--bidi-batch-us") == 0 && i + 1 < argc) {
+            bidi.batch_us = (uint64_t)atoll(argv[++ i]);
+        }
+        else if (strcmp(argv[i], "--max-in-flight") == 0 && i + 1 < argc) {
+            max_in_flight = (size_t)atoi(argv[++ i]);
+        }
+        else if (strcmp(argv[i], "--admission") == 0 && i + 1 < argc) {
+            if (!AdmissionScheduler::parseOrder(argv[++ i], &admission_order)) {
+                std::cerr << "unknown admission order " << argv[i] << ", expect priority or fifo" << std::endl;
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--adaptive-limit") == 0 && i + 1 < argc) {
+            if (!LimitPolicy::parseAlgorithm(argv[++ i], &limit.algorithm)) {
+                std::cerr << "unknown limit algorithm " << argv[i] << ", expect aimd or gradient" << std::endl;
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--limit-max") == 0 && i + 1 < argc) {
+            limit.max_limit = (size_t)atoi(argv[++ i]);
+        }
+        else if (strcmp(argv[i], "--limit-tolerance") == 0 && i + 1 < argc) {
+            limit.tolerance = atof(argv[++ i]);
+            if (limit.tolerance <= 1) {
+                std::cerr << "--limit-tolerance must be greater than 1" << std::endl;
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--hedge") == 0 && i + 1 < argc) {
+            hedge.quantile = atof(argv[++ i]);
+            if (hedge.quantile <= 0 || hedge.quantile >= 1) {
+                std::cerr << "--hedge expects a quantile in (0, 1), e.g. 0.95" << std::endl;
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--hedge-budget") == 0 && i + 1 < argc) {
+            hedge.budget = atof(argv[++ i]);
+        }
+        else if (strcmp(argv[i], "--hedge-min-ms") == 0 && i + 1 < argc) {
+            hedge.min_delay_us = (uint64_t)(atof(argv[++ i]) * 1000);
+        }
+        else if (strcmp(argv[i], "--retries") == 0 && i + 1 < argc) {
+            retry.max_retries = atoi(argv[++ i]);
+        }
+        else if (strcmp(argv[i], "--retry-backoff-ms") == 0 && i + 1 < argc) {
+            retry.base_backoff_us = (uint64_t)(atof(argv[++ i]) * 1000);
+        }
+        else if (strcmp(argv[i], "--retry-max-backoff-ms") == 0 && i + 1 < argc) {
+            retry.max_backoff_us = (uint64_t)(atof(argv[++ i]) * 1000);
+        }
+        else if (strcmp(argv[i], "--retry-budget") == 0 && i + 1 < argc) {
+            retry.budget = atof(argv[++ i]);
+        }
+        else if (strcmp(argv[i], "--coalesce") == 0) {
+            coalesce = true;
+        }
+        else if (strcmp(argv[i], "--no-param-cache") == 0) {
+            param_cache = false;
+        }
+        else if (strcmp(argv[i], "--verbose") == 0 || strcmp(argv[i], "-v") == 0) {
+            verbose = 1;
+        }
+        else if (strcmp(argv[i], "--quiet") == 0 || strcmp(argv[i], "-q") == 0) {
+            verbose = 0;
+        }
+    }
 
-int main() {
-    // 1. 创建引擎
-    Cronet_EnginePtr engine = Cronet_Engine_Create();
-    Cronet_EngineParamsPtr params = Cronet_EngineParams_Create();
-    Cronet_Engine_StartWithParams(engine, params);
-    
-    // 2. 创建回调
+    if (cache.disk() && engine_count > 1) {
+        // 同一时刻一个 storage_path 只能给一个引擎用
+        std::cerr << "--cache " << http_cache_mode_name(cache.mode) << " needs a single engine" << std::endl;
+        return 1;
+    }
+    if (limit.enabled()) {
+        if (max_in_flight > 0) {
+            limit.initial = max_in_flight;
+        }
+        if (limit.max_limit < limit.initial) {
+            limit.max_limit = limit.initial;
+        }
+        max_in_flight = limit.initial;
+    }
+    if (max_in_flight > 0 && !concurrency.empty()) {
+        // 闭环模式的并发数本身就是在飞窗口
+        std::cerr << "--max-in-flight and --adaptive-limit cannot be combined with --concurrency" << std::endl;
+        return 1;
+    }
+    if ((hedge.enabled() || retry.enabled() || coalesce) && !concurrency.empty()) {
+        std::cerr << "--hedge, --retries and --coalesce cannot be combined with --concurrency" << std::endl;
+        return 1;
+    }
+    if (bidi.streams > 0) {
+        if (urls.empty()) {
+            std::cerr << "--bidi needs --url of an echo endpoint" << std::endl;
+            return 1;
+        }
+        bidi.url = urls[0];
+        bidi.method = method == "GET" ? "POST" : method;
+        for (size_t i = 0; i < headers.size(); ++ i) {
+            std::pair<std::string, std::string> h;
+            if (!parse_header(headers[i], &h)) {
+                std::cerr << "bad header: " << headers[i] << std::endl;
+                return 1;
+            }
+            bidi.headers.push_back(h);
+        }
+        bidi.duration_s = duration_s;
+        if (bidi.messages == 0 && duration_s <= 0) {
+            bidi.messages = requests > 0 ? requests : 100;
+        }
+        if (timeout_s > 0) {
+            bidi.timeout_s = timeout_s;
+        }
+        return run_bidi_mode(engine_configs, bidi);
+    }
+
+    Workload workload;
+    TrafficRecording recording;
+    const bool replay = !replay_file.empty();
+    if (replay) {
+        if (!workload_file.empty() || !urls.empty() || rate > 0 || !concurrency.empty()) {
+            std::cerr << "--replay cannot be combined with --workload, --url, --rate or --concurrency" << std::endl;
+            return 1;
+        }
+        std::string error;
+        if (!load_traffic(replay_file, &recording, &error)) {
+            std::cerr << "replay: " << error << std::endl;
+            return 1;
+        }
+        if (recording.requests.empty()) {
+            std::cerr << "replay: " << replay_file << " has no request" << std::endl;
+            return 1;
+        }
+        workload.endpoints = recording.endpoints;
+    }
+    if (!workload_file.empty()) {
+        std::string error;
+        if (!load_workload(workload_file, &workload, &error)) {
+            std::cerr << "workload: " << error << std::endl;
+            return 1;
+        }
+    }
+    for (size_t i = 0; i < urls.size(); ++ i) {
+        Endpoint ep;
+        ep.method = method;
+        ep.url = urls[i];
+        workload.endpoints.push_back(ep);
+    }
+    for (size_t i = 0; i < headers.size(); ++ i) {
+        std::pair<std::string, std::string> h;
+        if (!parse_header(headers[i], &h)) {
+            std::cerr << "bad header: " << headers[i] << std::endl;
+            return 1;
+        }
+        workload.headers.push_back(h);
+    }
+    bool probe = workload.endpoints.empty();
+    if (probe) {
+        Endpoint ep;
+        ep.url = "http://httpbin.org/get";
+        workload.endpoints.push_back(ep);
+    }
+    if (requests > 0) {
+        workload.requests = requests;
+    }
+    else if (rate > 0 && duration_s > 0) {
+        workload.requests = (uint64_t)(rate * duration_s);
+    }
+    else if (!concurrency.empty() && duration_s > 0) {
+        // 限时的闭环模式按序号循环使用请求序列，序列不必覆盖全部请求
+        workload.requests = 10000;
+    }
+    else if (workload.requests == 0) {
+        workload.requests = 1;
+    }
+    if (retry.enabled()) {
+        size_t marked = mark_idempotent(&workload);
+        if (marked > 0) {
+            std::cout << "retry: " << marked << " endpoint(s) marked idempotent" << std::endl;
+        }
+    }
+    bool has_user_agent = false;
+    for (size_t i = 0; i < workload.headers.size(); ++ i) {
+        std::string name = workload.headers[i].first;
+        for (size_t c = 0; c < name.size(); ++ c) {
+            name[c] = (char)tolower((unsigned char)name[c]);
+        }
+        has_user_agent = has_user_agent || name == "user-agent";
+    }
+    if (!has_user_agent) {
+        workload.headers.push_back(std::make_pair(std::string("User-Agent"), std::string("Cronet-C-Client")));
+    }
+    if (timeout_s < 0) {
+        timeout_s = probe ? 15 : 600;
+    }
+    // 默认只有单个探测请求时打印每个回调
+    g_verbose = verbose >= 0 ? verbose == 1 : (probe && workload.total() <= 1);
+
+    // 1. 创建回调
     Cronet_UrlRequestCallbackPtr callback = Cronet_UrlRequestCallback_CreateWith(
         on_redirect_received,
         on_response_started,
@@ -227,84 +1659,250 @@ int main() {
         on_canceled
     );
     
-    // 3. 配置请求
-    Cronet_UrlRequestParamsPtr req_params = Cronet_UrlRequestParams_Create();
-    Cronet_UrlRequestParams_http_method_set(req_params, "GET");
-    
-    // 添加请求头
-    Cronet_HttpHeaderPtr header = Cronet_HttpHeader_Create();
-    Cronet_HttpHeader_name_set(header, "User-Agent");
-    Cronet_HttpHeader_value_set(header, "Cronet-C-Client");
-    Cronet_UrlRequestParams_request_headers_add(req_params, header);
-    
-    // 4. 创建执行器
-#ifdef ENABLE_EXECUTOR_THREAD
-    auto executor_thread = new ExecutorThread; 
-    Cronet_ExecutorPtr executor = Cronet_Executor_CreateWith(executor_func);
-    Cronet_Executor_SetClientContext(executor, executor_thread); 
-#else
-    // will crash on first callback arrived if no callback
-    // Cronet_ExecutorPtr executor = Cronet_Executor_CreateWith(NULL);
-    Cronet_ExecutorPtr executor = Cronet_Executor_CreateWith(executor_func);
-#endif
-    
-    // 5. 创建监听器
-    Cronet_RequestFinishedInfoListenerPtr listener = Cronet_RequestFinishedInfoListener_CreateWith(on_request_finished_listener);
-    if (listener) {
-        Cronet_Engine_AddRequestFinishedListener(engine, listener, executor);
-        std::cout << "request finished listener registered" << std::endl;
+    // 2. 展开请求序列，回放时按录制的发起顺序
+    std::vector<uint32_t> order;
+    std::vector<double> replay_offsets;
+    if (replay) {
+        for (size_t i = 0; i < recording.requests.size(); ++ i) {
+            const CapturedRequest& r = recording.requests[i];
+            order.push_back(r.endpoint);
+            replay_offsets.push_back((r.offset_us - recording.requests[0].offset_us) / 1e6 / replay_speed);
+        }
     }
     else {
-        std::cout << "setup request finished listener failed, no connection statistic provided" << std::endl;
+        order = workload.schedule(seed);
+    }
+    std::cout << "workload: " << workload.endpoints.size() << " endpoints, " << order.size() << " requests" << std::endl;
+    g_latency.setClasses(workload.classes.size());
+    
+    // 3. 各组引擎参数共用的统计，内部自行同步
+    RecordLog record_log; 
+    bool record_log_open = !record_dir.empty() && record_log.open(record_dir);
+    SlowRequestReservoir slow_requests(slow_k, slow_interval_ms); 
+    TrafficRecorder capture;
+    bool capture_open = !capture_file.empty() && capture.open(capture_file, workload);
+    if (!capture_file.empty() && !capture_open) {
+        std::cerr << "capture: cannot open " << capture_file << std::endl;
     }
+    FinishedSinks shared_sinks;
+    shared_sinks.record_log = record_log_open ? &record_log : nullptr; 
+    shared_sinks.slow_requests = slow_k > 0 ? &slow_requests : nullptr; 
+    shared_sinks.capture = capture_open ? &capture : nullptr;
 
-    // 6. 创建并启动请求
-#ifdef REQUEST_BATCH
-    const int REQ_CNT = 2; 
-    Cronet_UrlRequestPtr request[REQ_CNT]; 
-    for (int i=0; i<REQ_CNT; ++ i) {
-        request[i] = Cronet_UrlRequest_Create();
-        Cronet_UrlRequest_InitWithParams(request[i], engine, 
-                "http://httpbin.org/json",  
-                req_params, callback, executor);
-        Cronet_UrlRequest_Start(request[i]);
+    // 抓取时读当前这组引擎的统计，切换引擎时加锁替换
+    std::mutex scrape_mutex;
+    std::vector<const ConnStat*> conn_stats;
+    std::vector<const ExecutorThread*> executors;
+    MetricsExporter exporter;
+    if (metrics_port >= 0) {
+        bool ok = exporter.start(metrics_addr, metrics_port, [&](std::ostream& os) {
+            std::lock_guard<std::mutex> lock(scrape_mutex);
+            write_openmetrics(os, conn_stats, executors);
+        });
+        if (ok) {
+            std::cout << "metrics exporter listening on http://" << metrics_addr << ":" << exporter.port() << "/metrics" << std::endl;
+        }
     }
-#else 
-    Cronet_UrlRequestPtr request = Cronet_UrlRequest_Create();
-    Cronet_UrlRequest_InitWithParams(request, engine, 
-                                     "http://httpbin.org/get", 
-                                     req_params, callback, executor);
-    Cronet_UrlRequest_Start(request);
-#endif
-    // std::cout << "start request" << std::endl;
-    
-    
-    // 7. 等待请求完成（简化演示，实际应用需事件循环）
-    std::this_thread::sleep_for(std::chrono::seconds(15));
-    
-    // std::cout << "request done" << std::endl;
-    // 8. 清理资源
-#ifdef REQUEST_BATCH
-    for (int i=0; i<REQ_CNT; ++ i) { 
-        Cronet_UrlRequest_Destroy(request[i]);
+
+    EndpointRegistry registry(workload);
+    // 没有指定 --engine-config 时只跑一遍 Cronet 默认参数
+    const bool compare = !engine_configs.empty();
+    if (!compare) {
+        engine_configs.push_back(EngineConfig());
+        engine_configs.back().name = "default";
     }
-#else
-    Cronet_UrlRequest_Destroy(request);
-#endif
-    Cronet_HttpHeader_Destroy(header);
-    Cronet_UrlRequestParams_Destroy(req_params);
-    Cronet_UrlRequestCallback_Destroy(callback);
-    if (listener) {
-        Cronet_Engine_RemoveRequestFinishedListener(engine, listener);
-        Cronet_RequestFinishedInfoListener_Destroy(listener);
+    std::vector<EngineConfigResult> config_results;
+    for (size_t c = 0; c < engine_configs.size(); ++ c) {
+        const EngineConfig& config = engine_configs[c];
+        if (compare) {
+            std::cout << "==== engine config " << config.name << " (" << config.describe() << ") ====" << std::endl;
+        }
+        g_progress.reset();
+        g_latency.reset();
+        g_start_cost.cpu.reset();
+        g_start_cost.wall.reset();
+
+        // 4. 每组参数新建引擎，连接池、DNS 缓存与 QUIC 会话都不带到下一组
+        Cronet_EngineParamsPtr params = Cronet_EngineParams_Create();
+        apply_engine_config(config, params);
+        std::string storage_path;
+        std::string temp_cache_dir;     // 没给 --cache-dir 时新建的临时目录，这组参数跑完删除
+        if (cache.disk()) {
+            // 每组参数一个子目录，互不带入对方的缓存
+            std::string error;
+            if (!prepare_cache_dir(cache.dir, compare ? config.name : "", &storage_path, &temp_cache_dir, &error)) {
+                std::cerr << "cache: " << error << std::endl;
+                return 1;
+            }
+        }
+        apply_http_cache(cache, storage_path, params);
+        if (cache.enabled()) {
+            std::cout << "http cache: mode=" << http_cache_mode_name(cache.mode) << " max_size=" << cache.max_size
+                      << (storage_path.empty() ? "" : " storage=" + storage_path) << std::endl;
+        }
+        CacheStat cache_stat;
+        shared_sinks.cache = cache.enabled() ? &cache_stat : nullptr;
+        GoodputStat goodput; 
+        shared_sinks.goodput = &goodput;
+        ConnStat prewarm_stat;
+        shared_sinks.prewarm = &prewarm_stat;
+        std::vector<std::unique_ptr<EngineShard>> shards;
+        if (!create_shards(&shards, engine_count, params, shared_sinks)) {
+            destroy_shards(&shards);
+            remove_cache_dir(temp_cache_dir);
+            Cronet_EngineParams_Destroy(params);
+            return 1;
+        }
+        std::cout << engine_count << " engine(s), request finished listener registered" << std::endl;
+        if (!netlog_file.empty()) {
+            for (size_t e = 0; e < shards.size(); ++ e) {
+                std::string path = netlog_path(netlog_file, config.name, e, compare, shards.size() > 1);
+                if (Cronet_Engine_StartNetLogToFile(shards[e]->engine, path.c_str(), netlog_all)) {
+                    std::cout << "netlog: " << path << std::endl;
+                }
+                else {
+                    std::cerr << "netlog: cannot write " << path << std::endl;
+                }
+            }
+        }
+        std::vector<const ConnStat*> config_stats;
+        {
+            std::lock_guard<std::mutex> lock(scrape_mutex);
+            for (size_t e = 0; e < shards.size(); ++ e) {
+                conn_stats.push_back(&shards[e]->conn_stat);
+                if (shards[e]->executor_thread) {
+                    executors.push_back(shards[e]->executor_thread);
+                }
+            }
+            config_stats = conn_stats;
+        }
+
+        LoadPlan plan;
+        plan.workload = &workload;
+        plan.order = &order;
+        plan.callback = callback;
+        for (size_t e = 0; e < shards.size(); ++ e) {
+            plan.engines.push_back(shards[e].get());
+        }
+        plan.shard = shard;
+        plan.assignHosts();
+        plan.registry = param_cache ? &registry : nullptr;
+        plan.trace = slow_k > 0;
+        if (prewarm > 0) {
+            prewarm_origins(plan, prewarm, timeout_s, prewarm_stat);
+        }
+
+        // 5. 闭环模式下每个槽位在请求结束时发起下一个，否则见 run_load。
+        //    多轮时各轮共用引擎（连接池与缓存都是热的），延迟、连接复用统计与对比表都取最后一轮
+        std::chrono::steady_clock::time_point begin;
+        for (int round = 0; round < rounds; ++ round) {
+            if (rounds > 1) {
+                std::cout << "---- round " << (round + 1) << "/" << rounds << " ----" << std::endl;
+            }
+            g_progress.reset();
+            g_latency.reset();
+            if (round > 0) {
+                // 上一轮的请求都已经过了 finished listener，这里清零不会丢本轮的记录
+                for (size_t e = 0; e < shards.size(); ++ e) {
+                    shards[e]->conn_stat.reset();
+                }
+                goodput.reset();
+            }
+            cache_stat.beginRound();
+            begin = std::chrono::steady_clock::now();
+            if (!concurrency.empty()) {
+                // 指定了时长且没有给请求数时只按时长结束
+                uint64_t max_requests = (duration_s > 0 && requests == 0) ? 0 : order.size();
+                print_concurrency_table(std::cout, run_closed_loop(plan, concurrency, max_requests, duration_s, timeout_s));
+            }
+            else {
+                RunOptions opts;
+                opts.rate = rate;
+                opts.arrival = arrival;
+                opts.seed = seed;
+                opts.replay_offsets = replay ? &replay_offsets : nullptr;
+                opts.timeout_s = timeout_s;
+                opts.max_in_flight = max_in_flight;
+                opts.admission_order = admission_order;
+                opts.limit = limit;
+                opts.hedge = hedge;
+                opts.retry = retry;
+                opts.coalesce = coalesce;
+                run_load(plan, opts);
+                if (replay) {
+                    // 录制的延迟也是从 Start 算起
+                    print_replay_diff(std::cout, recording.latency(), g_latency.from_start.snapshot());
+                }
+            }
+        }
+        EngineConfigResult result;
+        result.name = config.name;
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        result.cold = g_latency.cold.snapshot();
+        result.warm = g_latency.warm.snapshot();
+        print_percentiles(std::cout, "latency (cold, new socket)", result.cold);
+        print_percentiles(std::cout, "latency (warm, reused)", result.warm);
+        
+        // std::cout << "request done" << std::endl;
+        if (shards.size() > 1) {
+            for (size_t e = 0; e < shards.size(); ++ e) {
+                const EngineShard& es = *shards[e];
+                std::cout << "engine " << e << ": started=" << es.started.load()
+                          << " succeeded=" << es.conn_stat.finished(Cronet_RequestFinishedInfo_FINISHED_REASON_SUCCEEDED)
+                          << " failed=" << es.conn_stat.finished(Cronet_RequestFinishedInfo_FINISHED_REASON_FAILED)
+                          << std::endl;
+                if (es.executor_thread) {
+                    print_percentiles(std::cout, "executor queue wait", es.executor_thread->stats().queue_wait.snapshot());
+                }
+            }
+        }
+        ConnStat::report(std::cout, config_stats);
+        goodput.report(std::cout);
+        if (cache.enabled()) {
+            cache_stat.report(std::cout);
+        }
+        g_start_cost.report(std::cout);
+        result.conn = ConnStat::summarize(config_stats);
+        result.latency = g_latency.from_start.snapshot();
+        config_results.push_back(result);
+
+        {
+            std::lock_guard<std::mutex> lock(scrape_mutex);
+            conn_stats.clear();
+            executors.clear();
+        }
+        if (!netlog_file.empty()) {
+            for (size_t e = 0; e < shards.size(); ++ e) {
+                Cronet_Engine_StopNetLog(shards[e]->engine);
+            }
+        }
+        destroy_shards(&shards);
+        remove_cache_dir(temp_cache_dir);
+        shared_sinks.goodput = nullptr;
+        shared_sinks.prewarm = nullptr;
+        shared_sinks.cache = nullptr;
+        Cronet_EngineParams_Destroy(params);
+    }
+    if (config_results.size() > 1) {
+        print_config_comparison(std::cout, config_results);
     }
 
-#ifdef ENABLE_EXECUTOR_THREAD
-    delete executor_thread; 
-#endif
-    Cronet_Executor_Destroy(executor);
-    Cronet_EngineParams_Destroy(params);
-    Cronet_Engine_Destroy(engine);
+    if (slow_k > 0) {
+        slow_requests.report(std::cout);
+    }
+    exporter.stop();
+    if (record_log_open) {
+        record_log.close();
+        std::cout << "record log: " << record_log.written() << " records written to " << record_dir
+                  << ", " << record_log.dropped() << " dropped" << std::endl;
+    }
+    if (capture_open) {
+        capture.close();
+        std::cout << "capture: " << capture.recorded() << " requests written to " << capture_file << std::endl;
+    }
+
+    // 6. 清理资源
+    Cronet_UrlRequestCallback_Destroy(callback);
     
     return 0;
 }
@@ -0,0 +1,79 @@
+#include "endpoint_registry.h"
+#include <iomanip>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+Cronet_UrlRequestParamsPtr build_request_params(const Workload& workload, const Endpoint& ep) {
+    Cronet_UrlRequestParamsPtr req_params = Cronet_UrlRequestParams_Create();
+    Cronet_UrlRequestParams_http_method_set(req_params, ep.method.c_str());
+    for (int pass = 0; pass < 2; ++ pass) {
+        const std::vector<std::pair<std::string, std::string>>& headers = pass == 0 ? workload.headers : ep.headers;
+        for (size_t i = 0; i < headers.size(); ++ i) {
+            Cronet_HttpHeaderPtr header = Cronet_HttpHeader_Create();
+            Cronet_HttpHeader_name_set(header, headers[i].first.c_str());
+            Cronet_HttpHeader_value_set(header, headers[i].second.c_str());
+            // params 保存的是拷贝
+            Cronet_UrlRequestParams_request_headers_add(req_params, header);
+            Cronet_HttpHeader_Destroy(header);
+        }
+    }
+    if (ep.priority >= 0) {
+        Cronet_UrlRequestParams_priority_set(req_params, (Cronet_UrlRequestParams_REQUEST_PRIORITY)ep.priority);
+    }
+    Cronet_UrlRequestParams_disable_cache_set(req_params, ep.disable_cache);
+    Cronet_UrlRequestParams_idempotency_set(req_params, (Cronet_UrlRequestParams_IDEMPOTENCY)ep.idempotency);
+    return req_params;
+}
+
+EndpointRegistry::EndpointRegistry(const Workload& workload) {
+    params_.reserve(workload.endpoints.size());
+    for (size_t i = 0; i < workload.endpoints.size(); ++ i) {
+        params_.push_back(build_request_params(workload, workload.endpoints[i]));
+    }
+}
+
+EndpointRegistry::~EndpointRegistry() {
+    for (size_t i = 0; i < params_.size(); ++ i) {
+        Cronet_UrlRequestParams_Destroy(params_[i]);
+    }
+}
+
+uint64_t thread_cpu_ns() {
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &created, &exited, &kernel, &user)) {
+        return 0;
+    }
+    // FILETIME 单位为 100ns
+    uint64_t k = ((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime;
+    uint64_t u = ((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime;
+    return (k + u) * 100;
+#else
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+        return 0;
+    }
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+void StartCost::report(std::ostream& os) const {
+    HistogramSnapshot cpu_snap = cpu.snapshot();
+    HistogramSnapshot wall_snap = wall.snapshot();
+    if (!cpu_snap.count) {
+        return;
+    }
+    std::ios::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << std::fixed << std::setprecision(2);
+    os << "request start cost (us): cpu mean=" << cpu_snap.mean() / 1000
+       << " p50=" << cpu_snap.percentile(0.50) / 1000.0 << " p99=" << cpu_snap.percentile(0.99) / 1000.0
+       << "  wall mean=" << wall_snap.mean() / 1000
+       << " p50=" << wall_snap.percentile(0.50) / 1000.0 << " p99=" << wall_snap.percentile(0.99) / 1000.0
+       << " (n=" << cpu_snap.count << ")" << std::endl;
+    os.flags(flags);
+    os.precision(precision);
+}
@@ -0,0 +1,41 @@
+#ifndef CRONET_CONN_STAT_ENDPOINT_REGISTRY_H
+#define CRONET_CONN_STAT_ENDPOINT_REGISTRY_H
+
+#include "histogram.h"
+#include "workload.h"
+#include <cronet/cronet_c.h>
+#include <stdint.h>
+#include <vector>
+
+// 按端点生成一份请求参数：方法、公共请求头 + 端点请求头、优先级、缓存与幂等性
+Cronet_UrlRequestParamsPtr build_request_params(const Workload& workload, const Endpoint& ep);
+
+// 每个端点的请求参数模板在启动时构建一次，之后只读。
+// Cronet_UrlRequest_InitWithParams 会拷贝参数，所以同一模板可以被多个执行器线程同时使用
+class EndpointRegistry {
+public:
+    explicit EndpointRegistry(const Workload& workload);
+    ~EndpointRegistry();
+
+    Cronet_UrlRequestParamsPtr params(uint32_t endpoint) const { return params_[endpoint]; }
+    size_t size() const { return params_.size(); }
+
+private:
+    EndpointRegistry(const EndpointRegistry&);
+    EndpointRegistry& operator=(const EndpointRegistry&);
+
+    std::vector<Cronet_UrlRequestParamsPtr> params_;
+};
+
+// 当前线程已消耗的 CPU 时间（纳秒）
+uint64_t thread_cpu_ns();
+
+// 发起一个请求（Create + Init + Start，含参数准备）的开销，单位纳秒
+struct StartCost {
+    LatencyHistogram cpu;
+    LatencyHistogram wall;
+
+    void report(std::ostream& os) const;
+};
+
+#endif // CRONET_CONN_STAT_ENDPOINT_REGISTRY_H
@@ -0,0 +1,228 @@
+#include "engine_config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+static bool parse_switch(const std::string& value, int* out) {
+    if (value == "on" || value == "true" || value == "1") {
+        *out = 1;
+        return true;
+    }
+    if (value == "off" || value == "false" || value == "0") {
+        *out = 0;
+        return true;
+    }
+    return false;
+}
+
+// host:port[:alternate_port]，端口必须是数字
+static bool parse_quic_hint(const std::string& text, std::string* host, int* port, int* alternate_port) {
+    size_t colon = text.find(':');
+    if (colon == 0 || colon == std::string::npos) {
+        return false;
+    }
+    *host = text.substr(0, colon);
+    char* end = nullptr;
+    long p = strtol(text.c_str() + colon + 1, &end, 10);
+    long alt = p;
+    if (*end == ':') {
+        const char* begin = end + 1;
+        alt = strtol(begin, &end, 10);
+        if (end == begin) {
+            return false;
+        }
+    }
+    if (*end != '\0' || p <= 0 || p > 65535 || alt <= 0 || alt > 65535) {
+        return false;
+    }
+    *port = (int)p;
+    *alternate_port = (int)alt;
+    return true;
+}
+
+std::string EngineConfig::describe() const {
+    static const char* kSwitch[] = {"default", "off", "on"};
+    std::ostringstream os;
+    os << "quic=" << kSwitch[quic + 1] << " h2=" << kSwitch[http2 + 1] << " brotli=" << kSwitch[brotli + 1];
+    for (size_t i = 0; i < quic_hints.size(); ++ i) {
+        os << " quic-hint=" << quic_hints[i];
+    }
+    if (!experimental_options.empty()) {
+        os << " options=" << experimental_options;
+    }
+    return os.str();
+}
+
+bool parse_engine_config(const std::string& text, EngineConfig* out, std::string* error) {
+    size_t colon = text.find(':');
+    out->name = text.substr(0, colon);
+    if (out->name.empty()) {
+        *error = "missing config name in \"" + text + "\"";
+        return false;
+    }
+    if (colon == std::string::npos) {
+        return true;
+    }
+    size_t pos = colon + 1;
+    while (pos < text.size()) {
+        if (text.compare(pos, 8, "options=") == 0) {
+            out->experimental_options = text.substr(pos + 8);
+            break;
+        }
+        size_t comma = text.find(',', pos);
+        std::string item = text.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        pos = comma == std::string::npos ? text.size() : comma + 1;
+        if (item.empty()) {
+            continue;
+        }
+        size_t eq = item.find('=');
+        std::string key = item.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : item.substr(eq + 1);
+        bool ok = false;
+        if (key == "quic") {
+            ok = parse_switch(value, &out->quic);
+        }
+        else if (key == "h2" || key == "http2") {
+            ok = parse_switch(value, &out->http2);
+        }
+        else if (key == "brotli") {
+            ok = parse_switch(value, &out->brotli);
+        }
+        else if (key == "quic-hint") {
+            std::string host;
+            int port = 0, alternate_port = 0;
+            ok = parse_quic_hint(value, &host, &port, &alternate_port);
+            if (ok) {
+                out->quic_hints.push_back(value);
+            }
+        }
+        else {
+            *error = "unknown engine option \"" + key + "\"";
+            return false;
+        }
+        if (!ok) {
+            *error = "bad value for " + key + ": \"" + value + "\"";
+            return false;
+        }
+    }
+    return true;
+}
+
+void apply_engine_config(const EngineConfig& config, Cronet_EngineParamsPtr params) {
+    if (config.quic >= 0) {
+        Cronet_EngineParams_enable_quic_set(params, config.quic == 1);
+    }
+    if (config.http2 >= 0) {
+        Cronet_EngineParams_enable_http2_set(params, config.http2 == 1);
+    }
+    if (config.brotli >= 0) {
+        Cronet_EngineParams_enable_brotli_set(params, config.brotli == 1);
+    }
+    for (size_t i = 0; i < config.quic_hints.size(); ++ i) {
+        std::string host;
+        int port = 0, alternate_port = 0;
+        if (!parse_quic_hint(config.quic_hints[i], &host, &port, &alternate_port)) {
+            continue;
+        }
+        // quic_hints_add 拷贝一份，hint 用完即可释放
+        Cronet_QuicHintPtr hint = Cronet_QuicHint_Create();
+        Cronet_QuicHint_host_set(hint, host.c_str());
+        Cronet_QuicHint_port_set(hint, port);
+        Cronet_QuicHint_alternate_port_set(hint, alternate_port);
+        Cronet_EngineParams_quic_hints_add(params, hint);
+        Cronet_QuicHint_Destroy(hint);
+    }
+    if (!config.experimental_options.empty()) {
+        Cronet_EngineParams_experimental_options_set(params, config.experimental_options.c_str());
+    }
+}
+
+// "p50/p90/p99"，没有样本时为 "-"
+static std::string percentile_cell(const HistogramSnapshot& snap) {
+    if (snap.count == 0) {
+        return "-";
+    }
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(1) << snap.percentile(0.50) / 1000.0 << "/"
+       << snap.percentile(0.90) / 1000.0 << "/" << snap.percentile(0.99) / 1000.0;
+    return os.str();
+}
+
+void print_config_comparison(std::ostream& os, const std::vector<EngineConfigResult>& results) {
+    static const size_t kLabelWidth = 16;
+    size_t width = 20;
+    for (size_t i = 0; i < results.size(); ++ i) {
+        width = std::max(width, results[i].name.size() + 2);
+    }
+    // 逐行生成各列的单元格
+    std::vector<std::pair<std::string, std::vector<std::string>>> rows;
+    std::vector<std::string> requests, reused, protocols, wire, rate, latency;
+    for (size_t i = 0; i < results.size(); ++ i) {
+        const EngineConfigResult& r = results[i];
+        requests.push_back(std::to_string(r.conn.requests));
+        std::ostringstream ss;
+        ss << std::fixed << std::setprecision(1) << (r.conn.requests ? 100.0 * r.conn.reused / r.conn.requests : 0.0)
+           << "%";
+        reused.push_back(ss.str());
+        std::string mix;
+        for (auto it = r.conn.protocols.begin(); it != r.conn.protocols.end(); ++ it) {
+            mix += (mix.empty() ? "" : " ") + it->first + ":" + std::to_string(it->second);
+        }
+        protocols.push_back(mix.empty() ? "-" : mix);
+        wire.push_back(r.conn.requests ? std::to_string(r.conn.wire_bytes / r.conn.requests) : "-");
+        ss.str("");
+        ss << (r.seconds > 0 ? r.latency.count / r.seconds : 0.0);
+        rate.push_back(ss.str());
+        latency.push_back(percentile_cell(r.latency));
+    }
+    rows.push_back(std::make_pair("requests", requests));
+    rows.push_back(std::make_pair("reused", reused));
+    rows.push_back(std::make_pair("protocols", protocols));
+    rows.push_back(std::make_pair("wire B/req", wire));
+    rows.push_back(std::make_pair("req/s", rate));
+    struct Phase {
+        const char* label;
+        HistogramSnapshot ConnSummary::* snap;
+    };
+    static const Phase kPhases[] = {
+        {"dns", &ConnSummary::dns},
+        {"connect", &ConnSummary::connect},
+        {"ssl", &ConnSummary::ssl},
+        {"ttfb (new)", &ConnSummary::ttfb_new},
+        {"ttfb (reused)", &ConnSummary::ttfb_reused},
+        {"total (new)", &ConnSummary::total_new},
+        {"total (reused)", &ConnSummary::total_reused},
+    };
+    for (size_t p = 0; p < sizeof(kPhases) / sizeof(kPhases[0]); ++ p) {
+        std::vector<std::string> cells;
+        for (size_t i = 0; i < results.size(); ++ i) {
+            cells.push_back(percentile_cell(results[i].conn.*kPhases[p].snap));
+        }
+        rows.push_back(std::make_pair(std::string(kPhases[p].label), cells));
+    }
+    rows.push_back(std::make_pair("client latency", latency));
+    std::vector<std::string> cold, warm;
+    for (size_t i = 0; i < results.size(); ++ i) {
+        cold.push_back(percentile_cell(results[i].cold));
+        warm.push_back(percentile_cell(results[i].warm));
+    }
+    rows.push_back(std::make_pair("  cold", cold));
+    rows.push_back(std::make_pair("  warm", warm));
+
+    os << "==== engine config comparison (ms, p50/p90/p99) ====" << std::endl;
+    os << std::left << std::setw(kLabelWidth) << "";
+    for (size_t i = 0; i < results.size(); ++ i) {
+        os << std::setw(width) << results[i].name;
+    }
+    os << std::endl;
+    for (size_t r = 0; r < rows.size(); ++ r) {
+        os << std::setw(kLabelWidth) << rows[r].first;
+        for (size_t i = 0; i < rows[r].second.size(); ++ i) {
+            os << std::setw(width) << rows[r].second[i];
+        }
+        os << std::endl;
+    }
+    os << std::right;
+}
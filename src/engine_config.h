@@ -0,0 +1,45 @@
+#ifndef CRONET_CONN_STAT_ENGINE_CONFIG_H
+#define CRONET_CONN_STAT_ENGINE_CONFIG_H
+
+#include "conn_stat.h"
+#include "histogram.h"
+#include <cronet/cronet_c.h>
+#include <stdint.h>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// 一组引擎参数，同一负载在各组参数下各跑一遍做 A/B 对比。开关为 -1 时保持 Cronet 默认
+struct EngineConfig {
+    std::string name;
+    int quic = -1;
+    int http2 = -1;
+    int brotli = -1;
+    std::vector<std::string> quic_hints;    // host:port[:alternate_port]
+    std::string experimental_options;       // JSON，原样交给 Cronet
+
+    // 打印用的简短描述
+    std::string describe() const;
+};
+
+// "NAME:quic=on,h2=off,brotli=on,quic-hint=example.com:443,options={...}"。
+// quic-hint 可出现多次；options 必须放在最后，其后全部内容都作为 JSON
+bool parse_engine_config(const std::string& text, EngineConfig* out, std::string* error);
+
+// 在新建的参数对象上应用，未指定的项不动
+void apply_engine_config(const EngineConfig& config, Cronet_EngineParamsPtr params);
+
+// 一组参数跑完后的汇总
+struct EngineConfigResult {
+    std::string name;
+    ConnSummary conn;
+    HistogramSnapshot latency;      // 客户端观测的 Start -> terminal 回调
+    HistogramSnapshot cold;         // 其中新建连接上的请求
+    HistogramSnapshot warm;         // 其中复用连接上的请求
+    double seconds = 0;
+};
+
+// 各连接阶段按参数组并排打印 p50/p90/p99（毫秒）
+void print_config_comparison(std::ostream& os, const std::vector<EngineConfigResult>& results);
+
+#endif // CRONET_CONN_STAT_ENGINE_CONFIG_H
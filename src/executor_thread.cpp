@@ -0,0 +1,71 @@
+#include "executor_thread.h"
+#include <iostream>
+
+static thread_local uint64_t t_queue_wait_us = 0;
+
+uint64_t ExecutorThread::currentQueueWait() {
+    return t_queue_wait_us;
+}
+
+ExecutorThread::ExecutorThread(const std::string& name) : name_(name) {
+    worker_thread_ = std::thread([this]() {
+        this->run();
+    });
+}
+
+ExecutorThread::~ExecutorThread() {
+    stop_ = true;
+    condition_.notify_all();
+    if (worker_thread_.joinable()) {
+        worker_thread_.join();
+    }
+}
+
+void ExecutorThread::postTask(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        Task t;
+        t.fn = std::move(task);
+        t.posted = Clock::now();
+        task_queue_.push(std::move(t));
+        depth_.fetch_add(1, std::memory_order_relaxed);
+    }
+    stats_.posted.fetch_add(1, std::memory_order_relaxed);
+    condition_.notify_one();
+}
+
+void ExecutorThread::run() {
+    while (!stop_) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            condition_.wait(lock, [this]() {
+                return stop_ || !task_queue_.empty();
+            });
+
+            if (stop_ && task_queue_.empty()) {
+                return;
+            }
+
+            task = std::move(task_queue_.front());
+            task_queue_.pop();
+            depth_.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        // 执行任务
+        if (task.fn) {
+            Clock::time_point begin = Clock::now();
+            t_queue_wait_us = std::chrono::duration_cast<std::chrono::microseconds>(begin - task.posted).count();
+            stats_.queue_wait.record(t_queue_wait_us);
+            try {
+                task.fn();
+            } catch (const std::exception& e) {
+                stats_.errors.fetch_add(1, std::memory_order_relaxed);
+                std::cerr << "Executor task error: " << e.what() << std::endl;
+            }
+            t_queue_wait_us = 0;
+            stats_.run_time.record(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - begin).count());
+            stats_.executed.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef CRONET_CONN_STAT_EXECUTOR_THREAD_H
+#define CRONET_CONN_STAT_EXECUTOR_THREAD_H
+
+#include "histogram.h"
+#include <queue>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+
+// 执行器运行统计，等待/执行耗时单位为微秒
+struct ExecutorStats {
+    std::atomic<uint64_t> posted{0};
+    std::atomic<uint64_t> executed{0};
+    std::atomic<uint64_t> errors{0};
+    LatencyHistogram queue_wait;    // postTask -> 开始执行
+    LatencyHistogram run_time;      // 任务本身的执行时间
+};
+
+// 任务队列和线程管理
+class ExecutorThread {
+private:
+    typedef std::chrono::steady_clock Clock;
+    struct Task {
+        std::function<void()> fn;
+        Clock::time_point posted;
+    };
+
+    std::queue<Task> task_queue_;
+    std::mutex queue_mutex_;
+    std::condition_variable condition_;
+    std::thread worker_thread_;
+    std::atomic<bool> stop_{false};
+    std::atomic<size_t> depth_{0};
+    std::string name_;
+    ExecutorStats stats_;
+
+public:
+    explicit ExecutorThread(const std::string& name = "executor");
+    ~ExecutorThread();
+
+    void postTask(std::function<void()> task);
+
+    const std::string& name() const { return name_; }
+    const ExecutorStats& stats() const { return stats_; }
+    size_t queueDepth() const { return depth_.load(std::memory_order_relaxed); }
+
+    // 当前线程正在执行的任务在队列中等待的时间（微秒），不在执行器线程上时为 0
+    static uint64_t currentQueueWait();
+
+private:
+    void run();
+};
+
+#endif // CRONET_CONN_STAT_EXECUTOR_THREAD_H
@@ -0,0 +1,113 @@
+#include "goodput_stat.h"
+#include <iomanip>
+
+std::string GoodputStat::proxyName(const std::string& proxy) {
+    if (proxy.empty() || proxy == ":0" || proxy == "direct://") {
+        return "direct";
+    }
+    return proxy;
+}
+
+GoodputEntry* GoodputStat::entry(EntryMap& map, const std::string& key) {
+    auto it = map.find(key);
+    if (it == map.end()) {
+        it = map.insert(std::make_pair(key, std::unique_ptr<GoodputEntry>(new GoodputEntry))).first;
+    }
+    return it->second.get();
+}
+
+// 只清零不释放，record 在锁外更新拿到的 GoodputEntry
+static void reset_entries(const std::map<std::string, std::unique_ptr<GoodputEntry>>& map) {
+    for (auto it = map.begin(); it != map.end(); ++ it) {
+        GoodputEntry& e = *it->second;
+        e.requests.store(0);
+        e.body_bytes.store(0);
+        e.wire_bytes.store(0);
+        e.timed_body_bytes.store(0);
+        e.transfer_us.store(0);
+        e.goodput.reset();
+    }
+}
+
+void GoodputStat::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    reset_entries(protocols_);
+    reset_entries(proxies_);
+}
+
+void GoodputStat::record(const RequestMetrics& m) {
+    if (!m.has_metrics || m.was_cached || m.body_bytes < 0 ||
+        m.finished_reason != Cronet_RequestFinishedInfo_FINISHED_REASON_SUCCEEDED) {
+        return;
+    }
+    GoodputEntry* entries[2];
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries[0] = entry(protocols_, m.protocol);
+        entries[1] = entry(proxies_, proxyName(m.proxy));
+    }
+
+    // 部分版本只在 Metrics 中给出 received_byte_count
+    int64_t wire = m.wire_received_bytes > 0 ? m.wire_received_bytes : m.received_bytes;
+    // 回环与 shim 下请求常常不到 1 ms，毫秒时间戳算出 0，优先用调用方测的微秒耗时
+    int64_t total_ms = phase_ms(m.request_start_ms, m.request_end_ms);
+    uint64_t total_us = m.duration_us > 0 ? (uint64_t)m.duration_us : (total_ms > 0 ? (uint64_t)total_ms * 1000 : 0);
+    for (int i = 0; i < 2; ++ i) {
+        GoodputEntry* e = entries[i];
+        e->requests.fetch_add(1, std::memory_order_relaxed);
+        e->body_bytes.fetch_add((uint64_t)m.body_bytes, std::memory_order_relaxed);
+        if (wire > 0) {
+            e->wire_bytes.fetch_add((uint64_t)wire, std::memory_order_relaxed);
+        }
+        // 没有耗时的请求只计总字节，不进 goodput 的分子，否则速率会被无限抬高
+        if (total_us > 0) {
+            e->timed_body_bytes.fetch_add((uint64_t)m.body_bytes, std::memory_order_relaxed);
+            e->transfer_us.fetch_add(total_us, std::memory_order_relaxed);
+            if (m.body_bytes > 0) {
+                e->goodput.record((uint64_t)m.body_bytes * 1000000 / total_us);
+            }
+        }
+    }
+}
+
+void GoodputStat::reportGroup(std::ostream& os, const char* title, const EntryMap& map) {
+    for (auto it = map.begin(); it != map.end(); ++ it) {
+        const GoodputEntry& e = *it->second;
+        if (e.requests.load() == 0) {
+            // reset 之后本轮没用到
+            continue;
+        }
+        uint64_t body = e.body_bytes.load();
+        uint64_t wire = e.wire_bytes.load();
+        uint64_t timed = e.timed_body_bytes.load();
+        uint64_t us = e.transfer_us.load();
+        HistogramSnapshot snap = e.goodput.snapshot();
+        os << title << " " << it->first << ": requests=" << e.requests.load()
+           << " body=" << body << " wire=" << wire;
+        if (body > 0) {
+            os << " wire/body=" << (double)wire / body;
+        }
+        // 以请求耗时之和为分母，相当于按字节加权的单请求速率
+        os << " goodput=" << (us ? timed / 1024.0 * 1000000 / us : 0.0) << " KB/s";
+        if (snap.count) {
+            // 慢的一端更有意义，p10 即 90% 的请求都不低于该速率
+            os << " per-request p10=" << snap.percentile(0.10) / 1024.0
+               << " p50=" << snap.percentile(0.50) / 1024.0 << " KB/s";
+        }
+        os << std::endl;
+    }
+}
+
+void GoodputStat::report(std::ostream& os) const {
+    std::ios::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << std::fixed << std::setprecision(2);
+    os << "==== goodput ====" << std::endl;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        reportGroup(os, "protocol", protocols_);
+        reportGroup(os, "proxy", proxies_);
+    }
+    os.flags(flags);
+    os.precision(precision);
+}
@@ -0,0 +1,45 @@
+#ifndef CRONET_CONN_STAT_GOODPUT_STAT_H
+#define CRONET_CONN_STAT_GOODPUT_STAT_H
+
+#include "histogram.h"
+#include "request_metrics.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+// 某个协议或代理下的传输量：wire 为线上收到的字节（含头部、压缩后），body 为应用读到的字节
+struct GoodputEntry {
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> body_bytes{0};
+    std::atomic<uint64_t> wire_bytes{0};
+    std::atomic<uint64_t> timed_body_bytes{0};  // 测到了耗时的请求的 body，与 transfer_us 对应
+    std::atomic<uint64_t> transfer_us{0};   // 请求耗时之和，优先用 duration_us，否则 request_start -> request_end
+    LatencyHistogram goodput;               // 单个请求 body 字节/秒
+};
+
+// 按协商协议（h2、h3、http/1.1 ...）和代理分别统计 goodput
+class GoodputStat {
+public:
+    // 需要 m.body_bytes 已填写，最好也填上 duration_us；未读 body 的请求（失败、取消）与缓存命中不计入
+    void record(const RequestMetrics& m);
+    void report(std::ostream& os) const;
+    // 清零，用于多轮之间
+    void reset();
+
+    // 代理名归一化：直连在各版本 Cronet 中可能是空、":0" 或 "direct://"
+    static std::string proxyName(const std::string& proxy);
+
+private:
+    typedef std::map<std::string, std::unique_ptr<GoodputEntry>> EntryMap;
+
+    GoodputEntry* entry(EntryMap& map, const std::string& key);
+    static void reportGroup(std::ostream& os, const char* title, const EntryMap& map);
+
+    mutable std::mutex mutex_;
+    EntryMap protocols_;
+    EntryMap proxies_;
+};
+
+#endif // CRONET_CONN_STAT_GOODPUT_STAT_H
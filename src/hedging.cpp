@@ -0,0 +1,76 @@
+#include "hedging.h"
+#include <iomanip>
+
+bool hedge_eligible(const Endpoint& ep) {
+    // idempotency 2 为 Cronet_UrlRequestParams_IDEMPOTENCY_NOT_IDEMPOTENT
+    return (ep.method == "GET" || ep.method == "HEAD") && ep.idempotency != 2;
+}
+
+HedgeController::HedgeController(const HedgePolicy& policy) : policy_(policy) {
+}
+
+void HedgeController::recordResponseStart(uint64_t us) {
+    response_start_.record(us);
+    uint64_t n = samples_.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (n < policy_.min_samples || n % kRecomputeEvery != 0) {
+        return;
+    }
+    // 取快照要扫全部分桶，只每隔一批样本重算一次
+    uint64_t t = response_start_.snapshot().percentile(policy_.quantile);
+    threshold_.store(t > policy_.min_delay_us ? t : policy_.min_delay_us, std::memory_order_relaxed);
+}
+
+bool HedgeController::acquire() {
+    // 允许 1 个副本的突发，预算很小时开头的慢请求也能被对冲
+    uint64_t allowed = (uint64_t)(primaries_.load(std::memory_order_relaxed) * policy_.budget) + 1;
+    uint64_t hedges = hedges_.load(std::memory_order_relaxed);
+    while (hedges < allowed) {
+        if (hedges_.compare_exchange_weak(hedges, hedges + 1, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+    suppressed_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void HedgeController::recordLatency(uint64_t us, bool hedged) {
+    eligible_latency_.record(us);
+    (hedged ? hedged_latency_ : unhedged_latency_).record(us);
+}
+
+// 对冲改善的是尾部，单独列出 p99 与 p99.9
+static void print_tail(std::ostream& os, const char* name, const HistogramSnapshot& snap) {
+    std::ios::fmtflags flags = os.flags();
+    std::streamsize prec = os.precision();
+    os << std::fixed << std::setprecision(2)
+       << "  " << std::left << std::setw(28) << name << std::right
+       << " n=" << std::setw(7) << snap.count;
+    if (snap.count) {
+        os << " p99=" << snap.percentile(0.99) / 1000.0
+           << " p99.9=" << snap.percentile(0.999) / 1000.0
+           << " max=" << snap.max / 1000.0 << " ms";
+    }
+    os << std::endl;
+    os.flags(flags);
+    os.precision(prec);
+}
+
+void HedgeController::report(std::ostream& os) const {
+    uint64_t primaries = primaries_.load();
+    uint64_t hedges = hedges_.load();
+    uint64_t wins = wins_.load();
+    os << "hedging: p" << policy_.quantile * 100 << " threshold=" << threshold() / 1000.0 << " ms, budget="
+       << policy_.budget * 100 << "%, eligible=" << primaries << " hedged=" << hedges << " ("
+       << (primaries ? 100.0 * hedges / primaries : 0) << "%) won=" << wins << " ("
+       << (hedges ? 100.0 * wins / hedges : 0) << "% of hedges) over_budget=" << suppressed_.load()
+       << " window_full=" << window_full_.load() << std::endl;
+    // 从原请求的 Start 算起，不含本地准入与开环排队
+    HistogramSnapshot eligible = eligible_latency_.snapshot();
+    HistogramSnapshot hedged = hedged_latency_.snapshot();
+    HistogramSnapshot unhedged = unhedged_latency_.snapshot();
+    print_percentiles(os, "latency (hedge-eligible)", eligible);
+    print_percentiles(os, "latency (hedged requests)", hedged);
+    print_percentiles(os, "latency (not hedged)", unhedged);
+    print_tail(os, "tail (hedge-eligible)", eligible);
+    print_tail(os, "tail (not hedged)", unhedged);
+}
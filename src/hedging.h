@@ -0,0 +1,72 @@
+#ifndef CRONET_CONN_STAT_HEDGING_H
+#define CRONET_CONN_STAT_HEDGING_H
+
+#include "histogram.h"
+#include "timer_thread.h"
+#include "workload.h"
+#include <stdint.h>
+#include <atomic>
+#include <ostream>
+
+// 对冲请求的策略：原请求发起后超过阈值仍没收到响应头，就再发一个副本，先到的胜出
+struct HedgePolicy {
+    double quantile = 0;            // 阈值取 Start 到响应头耗时的这个分位数，0 为关闭
+    double budget = 0.05;           // 副本数不超过已发起原请求数的这个比例
+    uint64_t min_delay_us = 1000;   // 阈值下限，避免对快请求也发副本
+    uint64_t min_samples = 100;     // 响应头样本不够时不对冲
+
+    bool enabled() const { return quantile > 0; }
+};
+
+// 只对冲幂等的 GET/HEAD，端点显式标记 idempotent=no 的除外
+bool hedge_eligible(const Endpoint& ep);
+
+// 对冲的阈值、预算与统计。阈值由累计的响应头耗时直方图每隔一批样本重算一次；
+// 预算按已发起的原请求数计算。各方法可在任意线程上调用
+class HedgeController {
+public:
+    explicit HedgeController(const HedgePolicy& policy);
+
+    const HedgePolicy& policy() const { return policy_; }
+    TimerThread& timer() { return timer_; }
+
+    // 请求（原请求或副本）收到响应头，us 为从它自己的 Start 算起
+    void recordResponseStart(uint64_t us);
+    // 当前阈值（微秒），样本不够时为 0，表示不对冲
+    uint64_t threshold() const { return threshold_.load(std::memory_order_relaxed); }
+
+    // 发起了一个可对冲的原请求
+    void onPrimary() { primaries_.fetch_add(1, std::memory_order_relaxed); }
+    // 阈值到期时原请求仍未收到响应头：预算允许时计数并返回 true
+    bool acquire();
+    // 副本先收到响应头（或先结束）
+    void onHedgeWin() { wins_.fetch_add(1, std::memory_order_relaxed); }
+    // 可对冲的逻辑请求结束，us 为从原请求的 Start 算起（不含本地排队），hedged 为发过副本
+    void recordLatency(uint64_t us, bool hedged);
+    // 准入窗口已满，没有发副本
+    void onWindowFull() { window_full_.fetch_add(1, std::memory_order_relaxed); }
+
+    void report(std::ostream& os) const;
+
+private:
+    HedgeController(const HedgeController&);
+    HedgeController& operator=(const HedgeController&);
+
+    static const uint64_t kRecomputeEvery = 64;
+
+    const HedgePolicy policy_;
+    TimerThread timer_;
+    LatencyHistogram response_start_;
+    std::atomic<uint64_t> samples_{0};
+    std::atomic<uint64_t> threshold_{0};
+    std::atomic<uint64_t> primaries_{0};
+    std::atomic<uint64_t> hedges_{0};
+    std::atomic<uint64_t> suppressed_{0};   // 到期但超出预算
+    std::atomic<uint64_t> wins_{0};
+    std::atomic<uint64_t> window_full_{0};
+    LatencyHistogram eligible_latency_;     // 全部可对冲的请求，用来看尾延迟
+    LatencyHistogram hedged_latency_;
+    LatencyHistogram unhedged_latency_;
+};
+
+#endif // CRONET_CONN_STAT_HEDGING_H
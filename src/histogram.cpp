@@ -0,0 +1,154 @@
+#include "histogram.h"
+#include <iomanip>
+#include <algorithm>
+#include <limits>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static int highest_bit(uint64_t v) {
+#if defined(_MSC_VER) && defined(_WIN64)
+    unsigned long idx = 0;
+    _BitScanReverse64(&idx, v);
+    return (int)idx;
+#elif defined(__GNUC__)
+    return 63 - __builtin_clzll(v);
+#else
+    int idx = 0;
+    while (v >>= 1) {
+        ++ idx;
+    }
+    return idx;
+#endif
+}
+
+uint64_t HistogramSnapshot::percentile(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    if (q <= 0) {
+        return min;
+    }
+    uint64_t rank = (uint64_t)(q * count + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+    if (rank >= count) {
+        return max;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++ i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            // 取桶的中点，误差减半
+            uint64_t upper = LatencyHistogram::bucketUpperBound((int)i);
+            uint64_t lower = i ? LatencyHistogram::bucketUpperBound((int)i - 1) + 1 : 0;
+            uint64_t mid = lower + (upper - lower) / 2;
+            return std::max(min, std::min(mid, max));
+        }
+    }
+    return max;
+}
+
+void HistogramSnapshot::merge(const HistogramSnapshot& other) {
+    if (other.count == 0) {
+        return;
+    }
+    if (counts.size() < other.counts.size()) {
+        counts.resize(other.counts.size(), 0);
+    }
+    for (size_t i = 0; i < other.counts.size(); ++ i) {
+        counts[i] += other.counts[i];
+    }
+    min = count ? std::min(min, other.min) : other.min;
+    max = std::max(max, other.max);
+    count += other.count;
+    sum += other.sum;
+}
+
+void HistogramSnapshot::reset() {
+    std::fill(counts.begin(), counts.end(), 0);
+    count = sum = min = max = 0;
+}
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+int LatencyHistogram::bucketIndex(uint64_t value) {
+    if (value < (uint64_t)kSubBuckets) {
+        return (int)value;
+    }
+    int p = highest_bit(value);
+    int sub = (int)(value >> (p - kSubBucketBits)) - kSubBuckets;
+    return (p - kSubBucketBits + 1) * kSubBuckets + sub;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(int index) {
+    if (index < kSubBuckets) {
+        return (uint64_t)index;
+    }
+    int p = index / kSubBuckets + kSubBucketBits - 1;
+    uint64_t sub = (uint64_t)(index % kSubBuckets);
+    int shift = p - kSubBucketBits;
+    uint64_t lower = ((uint64_t)kSubBuckets + sub) << shift;
+    return lower + ((uint64_t)1 << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t value) {
+    counts_[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t cur = max_.load(std::memory_order_relaxed);
+    while (value > cur && !max_.compare_exchange_weak(cur, value, std::memory_order_relaxed)) {
+    }
+    cur = min_.load(std::memory_order_relaxed);
+    while (value < cur && !min_.compare_exchange_weak(cur, value, std::memory_order_relaxed)) {
+    }
+}
+
+HistogramSnapshot LatencyHistogram::snapshot() const {
+    HistogramSnapshot snap;
+    snap.counts.resize(kBucketCount);
+    uint64_t total = 0;
+    for (int i = 0; i < kBucketCount; ++ i) {
+        snap.counts[i] = counts_[i].load(std::memory_order_relaxed);
+        total += snap.counts[i];
+    }
+    // 以桶计数之和为准，避免与 count_ 之间的瞬时不一致
+    snap.count = total;
+    snap.sum = sum_.load(std::memory_order_relaxed);
+    snap.max = max_.load(std::memory_order_relaxed);
+    uint64_t mn = min_.load(std::memory_order_relaxed);
+    snap.min = total ? mn : 0;
+    return snap;
+}
+
+void LatencyHistogram::reset() {
+    for (int i = 0; i < kBucketCount; ++ i) {
+        counts_[i].store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    min_.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+void print_percentiles(std::ostream& os, const std::string& name, const HistogramSnapshot& snap) {
+    std::ios::fmtflags flags = os.flags();
+    std::streamsize prec = os.precision();
+    os << std::fixed << std::setprecision(2)
+       << "  " << std::left << std::setw(28) << name << std::right
+       << " n=" << std::setw(7) << snap.count;
+    if (snap.count) {
+        os << " mean=" << snap.mean() / 1000.0
+           << " p50=" << snap.percentile(0.50) / 1000.0
+           << " p90=" << snap.percentile(0.90) / 1000.0
+           << " p99=" << snap.percentile(0.99) / 1000.0
+           << " max=" << snap.max / 1000.0 << " ms";
+    }
+    os << std::endl;
+    os.flags(flags);
+    os.precision(prec);
+}
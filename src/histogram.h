@@ -0,0 +1,56 @@
+#ifndef CRONET_CONN_STAT_HISTOGRAM_H
+#define CRONET_CONN_STAT_HISTOGRAM_H
+
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <ostream>
+
+// 对数-线性分桶：每个 2 的幂区间再分 16 个子桶，相对误差约 6%
+// 记录路径只有几次 relaxed 原子操作，可在任意回调线程上并发调用
+struct HistogramSnapshot {
+    std::vector<uint64_t> counts;
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t min = 0;
+    uint64_t max = 0;
+
+    double mean() const { return count ? (double)sum / count : 0.0; }
+    // q in [0, 1]
+    uint64_t percentile(double q) const;
+    void merge(const HistogramSnapshot& other);
+    // 清空计数但保留桶数组
+    void reset();
+};
+
+class LatencyHistogram {
+public:
+    static const int kSubBucketBits = 4;
+    static const int kSubBuckets = 1 << kSubBucketBits;
+    static const int kBucketCount = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+    LatencyHistogram();
+
+    void record(uint64_t value);
+    HistogramSnapshot snapshot() const;
+    void reset();
+
+    static int bucketIndex(uint64_t value);
+    static uint64_t bucketUpperBound(int index);
+
+private:
+    LatencyHistogram(const LatencyHistogram&);
+    LatencyHistogram& operator=(const LatencyHistogram&);
+
+    std::atomic<uint64_t> counts_[kBucketCount];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> min_;
+    std::atomic<uint64_t> max_;
+};
+
+// 以毫秒打印 p50/p90/p99/max，数值单位为微秒
+void print_percentiles(std::ostream& os, const std::string& name, const HistogramSnapshot& snap);
+
+#endif // CRONET_CONN_STAT_HISTOGRAM_H
@@ -0,0 +1,244 @@
+#include "http_cache.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <iomanip>
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#include <process.h>
+#include <time.h>
+#else
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+bool parse_http_cache_mode(const std::string& name, Cronet_EngineParams_HTTP_CACHE_MODE* out) {
+    if (name == "memory") {
+        *out = Cronet_EngineParams_HTTP_CACHE_MODE_IN_MEMORY;
+    }
+    else if (name == "disk") {
+        *out = Cronet_EngineParams_HTTP_CACHE_MODE_DISK;
+    }
+    else if (name == "disk-no-http") {
+        *out = Cronet_EngineParams_HTTP_CACHE_MODE_DISK_NO_HTTP;
+    }
+    else if (name == "off") {
+        *out = Cronet_EngineParams_HTTP_CACHE_MODE_DISABLED;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+const char* http_cache_mode_name(Cronet_EngineParams_HTTP_CACHE_MODE mode) {
+    switch (mode) {
+    case Cronet_EngineParams_HTTP_CACHE_MODE_IN_MEMORY:
+        return "memory";
+    case Cronet_EngineParams_HTTP_CACHE_MODE_DISK:
+        return "disk";
+    case Cronet_EngineParams_HTTP_CACHE_MODE_DISK_NO_HTTP:
+        return "disk-no-http";
+    default:
+        return "off";
+    }
+}
+
+static bool make_dir(const std::string& path) {
+#ifdef _WIN32
+    int rc = _mkdir(path.c_str());
+#else
+    int rc = mkdir(path.c_str(), 0700);
+#endif
+    return rc == 0 || errno == EEXIST;
+}
+
+bool prepare_cache_dir(const std::string& dir, const std::string& sub, std::string* path, std::string* temp,
+                       std::string* error) {
+    std::string base = dir;
+    temp->clear();
+    if (base.empty()) {
+#ifdef _WIN32
+        const char* tmp = getenv("TEMP");
+        base = std::string(tmp ? tmp : ".") + "\\cronet_cache_" + std::to_string(_getpid()) + "_" +
+               std::to_string((long long)time(nullptr));
+        if (!make_dir(base)) {
+            *error = "cannot create " + base + ": " + strerror(errno);
+            return false;
+        }
+#else
+        const char* tmp = getenv("TMPDIR");
+        std::string pattern = std::string(tmp && *tmp ? tmp : "/tmp") + "/cronet_cache_XXXXXX";
+        std::vector<char> name(pattern.begin(), pattern.end());
+        name.push_back('\0');
+        if (!mkdtemp(name.data())) {
+            *error = "cannot create " + pattern + ": " + strerror(errno);
+            return false;
+        }
+        base = name.data();
+#endif
+        *temp = base;
+    }
+    else if (!make_dir(base)) {
+        *error = "cannot create " + base + ": " + strerror(errno);
+        return false;
+    }
+    *path = base;
+    if (!sub.empty()) {
+        *path = base + "/" + sub;
+        if (!make_dir(*path)) {
+            *error = "cannot create " + *path + ": " + strerror(errno);
+            return false;
+        }
+    }
+    return true;
+}
+
+void remove_cache_dir(const std::string& path) {
+    if (path.empty()) {
+        return;
+    }
+#ifdef _WIN32
+    struct _finddata_t entry;
+    intptr_t handle = _findfirst((path + "\\*").c_str(), &entry);
+    if (handle != -1) {
+        do {
+            std::string name = entry.name;
+            if (name == "." || name == "..") {
+                continue;
+            }
+            std::string child = path + "\\" + name;
+            if (entry.attrib & _A_SUBDIR) {
+                remove_cache_dir(child);
+            }
+            else {
+                remove(child.c_str());
+            }
+        } while (_findnext(handle, &entry) == 0);
+        _findclose(handle);
+    }
+    _rmdir(path.c_str());
+#else
+    DIR* d = opendir(path.c_str());
+    if (d) {
+        while (struct dirent* entry = readdir(d)) {
+            std::string name = entry->d_name;
+            if (name == "." || name == "..") {
+                continue;
+            }
+            std::string child = path + "/" + name;
+            struct stat st;
+            if (lstat(child.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+                remove_cache_dir(child);
+            }
+            else {
+                unlink(child.c_str());
+            }
+        }
+        closedir(d);
+    }
+    rmdir(path.c_str());
+#endif
+}
+
+void apply_http_cache(const HttpCacheOptions& options, const std::string& storage_path, Cronet_EngineParamsPtr params) {
+    Cronet_EngineParams_http_cache_mode_set(params, options.mode);
+    if (!options.enabled()) {
+        return;
+    }
+    Cronet_EngineParams_http_cache_max_size_set(params, options.max_size);
+    if (!storage_path.empty()) {
+        Cronet_EngineParams_storage_path_set(params, storage_path.c_str());
+    }
+}
+
+CacheStat::CacheStat() {
+}
+
+void CacheStat::beginRound() {
+    rounds_.push_back(std::unique_ptr<Round>(new Round));
+    rounds_.back()->begin = std::chrono::steady_clock::now();
+}
+
+void CacheStat::record(bool cached, uint64_t latency_us) {
+    if (rounds_.empty()) {
+        return;
+    }
+    Round& r = *rounds_.back();
+    r.requests.fetch_add(1, std::memory_order_relaxed);
+    if (cached) {
+        r.hits.fetch_add(1, std::memory_order_relaxed);
+        r.cached.record(latency_us);
+    }
+    else {
+        r.network.record(latency_us);
+    }
+    Sample sample;
+    sample.hit = cached;
+    sample.ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - r.begin).count();
+    std::lock_guard<std::mutex> lock(mutex_);
+    r.samples.push_back(sample);
+}
+
+size_t CacheStat::warmupIndex(const std::vector<Sample>& samples, size_t window, double target) {
+    size_t hits = 0;
+    for (size_t i = 0; i < samples.size(); ++ i) {
+        hits += samples[i].hit ? 1 : 0;
+        if (i >= window) {
+            hits -= samples[i - window].hit ? 1 : 0;
+        }
+        if (i + 1 >= window && (double)hits / window >= target) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+void CacheStat::report(std::ostream& os) const {
+    if (rounds_.empty()) {
+        return;
+    }
+    std::ios::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << "==== http cache ====" << std::endl;
+    os << std::fixed << std::setprecision(1);
+    double steady = 0;
+    for (size_t i = 0; i < rounds_.size(); ++ i) {
+        const Round& r = *rounds_[i];
+        uint64_t requests = r.requests.load();
+        uint64_t hits = r.hits.load();
+        steady = requests ? (double)hits / requests : 0;
+        os << "round " << (i + 1) << ": requests=" << requests << " hits=" << hits << " hit_ratio=" << steady * 100
+           << "%" << std::endl;
+        print_percentiles(os, "cached", r.cached.snapshot());
+        print_percentiles(os, "network", r.network.snapshot());
+    }
+
+    // 预热：每轮内按结束顺序，最近 kWindow 个请求的命中率第一次达到最后一轮命中率的 90%。
+    // 按请求序号而不是时间算，与发送速率无关；已经热的轮次在第一个窗口就达到
+    if (steady <= 0) {
+        os << "cache warm-up: no cache hit" << std::endl;
+        os.flags(flags);
+        os.precision(precision);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < rounds_.size(); ++ i) {
+        const std::vector<Sample>& samples = rounds_[i]->samples;
+        size_t window = std::max<size_t>(1, std::min(kWindow, samples.size()));
+        size_t index = warmupIndex(samples, window, steady * 0.9);
+        os << "cache warm-up round " << (i + 1) << ": ";
+        if (index == 0) {
+            os << "rolling hit ratio (" << window << " requests) never reached 90% of " << steady * 100 << "%"
+               << std::endl;
+            continue;
+        }
+        os << "after " << index << " requests, " << samples[index - 1].ms << " ms, rolling hit ratio ("
+           << window << " requests) reached 90% of " << steady * 100 << "%" << std::endl;
+    }
+    os.flags(flags);
+    os.precision(precision);
+}
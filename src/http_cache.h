@@ -0,0 +1,76 @@
+#ifndef CRONET_CONN_STAT_HTTP_CACHE_H
+#define CRONET_CONN_STAT_HTTP_CACHE_H
+
+#include "histogram.h"
+#include <cronet/cronet_c.h>
+#include <stdint.h>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// HTTP 缓存实验的引擎参数。磁盘模式下 dir 为空时在临时目录下新建一个
+struct HttpCacheOptions {
+    Cronet_EngineParams_HTTP_CACHE_MODE mode = Cronet_EngineParams_HTTP_CACHE_MODE_DISABLED;
+    int64_t max_size = 32 * 1024 * 1024;
+    std::string dir;
+
+    bool enabled() const { return mode != Cronet_EngineParams_HTTP_CACHE_MODE_DISABLED; }
+    bool disk() const {
+        return mode == Cronet_EngineParams_HTTP_CACHE_MODE_DISK ||
+               mode == Cronet_EngineParams_HTTP_CACHE_MODE_DISK_NO_HTTP;
+    }
+};
+
+// memory | disk | disk-no-http | off
+bool parse_http_cache_mode(const std::string& name, Cronet_EngineParams_HTTP_CACHE_MODE* out);
+const char* http_cache_mode_name(Cronet_EngineParams_HTTP_CACHE_MODE mode);
+
+// 准备 storage_path：dir 为空时新建临时目录（通过 temp 返回，用完后交给 remove_cache_dir），
+// sub 非空时再建一层子目录（每组引擎参数各用一个）。Cronet 要求目录已存在
+bool prepare_cache_dir(const std::string& dir, const std::string& sub, std::string* path, std::string* temp,
+                       std::string* error);
+// 递归删除 prepare_cache_dir 新建的临时目录，引擎销毁后调用
+void remove_cache_dir(const std::string& path);
+
+// 在引擎参数上设置缓存模式、容量与 storage_path
+void apply_http_cache(const HttpCacheOptions& options, const std::string& storage_path, Cronet_EngineParamsPtr params);
+
+// 按轮统计缓存命中（UrlResponseInfo.was_cached）以及命中与走网络的延迟；
+// 另按结束顺序记下每轮每个请求是否命中，用滑动窗口的命中率估计每轮的缓存预热时间
+class CacheStat {
+public:
+    CacheStat();
+
+    // 开始新一轮，同时作为本轮预热计时起点。在 main 线程、没有请求在飞时调用
+    void beginRound();
+    // finished listener 中调用，latency_us 为客户端观测的 Start -> terminal 回调
+    void record(bool cached, uint64_t latency_us);
+    void report(std::ostream& os) const;
+
+private:
+    struct Sample {
+        bool hit;
+        int64_t ms;     // 相对本轮开始
+    };
+    struct Round {
+        std::atomic<uint64_t> requests{0};
+        std::atomic<uint64_t> hits{0};
+        LatencyHistogram cached;
+        LatencyHistogram network;
+        std::chrono::steady_clock::time_point begin;
+        std::vector<Sample> samples;    // 按结束顺序，受 mutex_ 保护
+    };
+    static const size_t kWindow = 20;   // 滑动窗口的请求数
+
+    // 最近 window 个请求的命中率第一次达到 target 时已结束的请求数，没达到返回 0
+    static size_t warmupIndex(const std::vector<Sample>& samples, size_t window, double target);
+
+    std::vector<std::unique_ptr<Round>> rounds_;
+    mutable std::mutex mutex_;
+};
+
+#endif // CRONET_CONN_STAT_HTTP_CACHE_H
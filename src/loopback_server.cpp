@@ -0,0 +1,728 @@
+// 本地回环 HTTP/1.1 压测目标，模仿 httpbin 的几个路由，让压测不依赖外网：
+//   /get              回显请求头的 JSON
+//   /json             固定 JSON，大小由 --json-bytes 决定
+//   /bytes/N          N 字节伪随机内容（上限 --max-bytes）
+//   /delay/N          N 秒（可为小数，上限 10）后返回 /get 的内容
+//   /redirect/N       302 到 /redirect/N-1，/redirect/1 到 /get
+//   /status/N         返回状态码 N
+//   /cache/N          /get 的内容加 Cache-Control: public, max-age=N
+// 支持 HEAD、keep-alive 与流水线请求。Linux 下每个工作线程一个 epoll，其它平台退回单线程 select。
+//
+// usage: cronet_loopback_server [--addr 127.0.0.1] [--port 8080] [--threads N] [--latency-ms MS]
+//                               [--jitter-ms MS] [--json-bytes N] [--max-bytes N] [--keep-alive 0|1]
+//                               [--max-requests-per-conn N] [--idle-timeout-ms MS]
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET socket_t;
+#define close_socket closesocket
+static bool would_block() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+static void set_nonblocking(socket_t fd) { u_long on = 1; ioctlsocket(fd, FIONBIO, &on); }
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int socket_t;
+#define close_socket close
+static bool would_block() { return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR; }
+static void set_nonblocking(socket_t fd) { fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK); }
+#endif
+#ifdef __linux__
+#include <sys/epoll.h>
+#ifndef EPOLLEXCLUSIVE
+#define EPOLLEXCLUSIVE (1u << 28)
+#endif
+#endif
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options {
+    std::string addr = "127.0.0.1";
+    int port = 8080;
+    int threads = 1;
+    int latency_ms = 0;             // 每个响应额外延迟
+    int jitter_ms = 0;              // 再加 [0, jitter_ms] 的均匀随机延迟
+    size_t json_bytes = 429;        // 与 httpbin 的 /json 大小相近
+    size_t max_bytes = 100 * 1024 * 1024;
+    bool keep_alive = true;
+    uint64_t max_requests_per_conn = 0;     // 0 为不限
+    int idle_timeout_ms = 30000;
+};
+
+struct Counters {
+    std::atomic<uint64_t> accepted{0};
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> bytes_sent{0};
+};
+
+std::atomic<bool> g_stop{false};
+Counters g_counters;
+
+void on_signal(int) {
+    g_stop = true;
+}
+
+// /bytes/N 的内容从这段固定的伪随机数据里循环取，不必每次生成
+const std::string& filler() {
+    static std::string data;
+    if (data.empty()) {
+        std::mt19937 rng(42);
+        data.resize(64 * 1024);
+        for (size_t i = 0; i < data.size(); ++ i) {
+            data[i] = (char)(rng() & 0xff);
+        }
+    }
+    return data;
+}
+
+std::string lower(std::string s) {
+    for (size_t i = 0; i < s.size(); ++ i) {
+        s[i] = (char)tolower((unsigned char)s[i]);
+    }
+    return s;
+}
+
+std::string json_escape(const std::string& v) {
+    std::string out;
+    for (size_t i = 0; i < v.size(); ++ i) {
+        char c = v[i];
+        if (c == '\\' || c == '"') {
+            out += '\\';
+            out += c;
+        }
+        else if ((unsigned char)c >= 0x20) {
+            out += c;
+        }
+    }
+    return out;
+}
+
+struct Request {
+    std::string method;
+    std::string target;
+    std::string version;
+    std::vector<std::pair<std::string, std::string>> headers;
+
+    std::string header(const std::string& lower_name) const {
+        for (size_t i = 0; i < headers.size(); ++ i) {
+            if (lower(headers[i].first) == lower_name) {
+                return headers[i].second;
+            }
+        }
+        return std::string();
+    }
+};
+
+// 解析 c.in 开头的一个请求。返回消耗的字节数，0 为数据不完整，-1 为格式错误
+long parse_request(const std::string& in, Request* req) {
+    size_t end = in.find("\r\n\r\n");
+    if (end == std::string::npos) {
+        return in.size() > 64 * 1024 ? -1 : 0;
+    }
+    std::istringstream is(in.substr(0, end));
+    std::string line;
+    std::getline(is, line);
+    std::istringstream rl(line);
+    if (!(rl >> req->method >> req->target >> req->version)) {
+        return -1;
+    }
+    while (std::getline(is, line)) {
+        if (!line.empty() && line[line.size() - 1] == '\r') {
+            line.erase(line.size() - 1);
+        }
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) {
+            continue;
+        }
+        size_t v = line.find_first_not_of(' ', colon + 1);
+        req->headers.push_back(std::make_pair(line.substr(0, colon),
+                                              v == std::string::npos ? std::string() : line.substr(v)));
+    }
+    // 只支持 Content-Length 形式的请求体，内容丢弃
+    std::string length = req->header("content-length");
+    size_t body = length.empty() ? 0 : (size_t)strtoull(length.c_str(), nullptr, 10);
+    if (in.size() < end + 4 + body) {
+        return 0;
+    }
+    return (long)(end + 4 + body);
+}
+
+struct Response {
+    int status = 200;
+    std::string type = "application/json";
+    std::string location;
+    std::string body;
+    size_t fill = 0;            // body 之后追加的 filler 字节数
+    int delay_ms = 0;
+    int max_age = 0;            // > 0 时带 Cache-Control
+};
+
+const char* status_text(int status) {
+    switch (status) {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 302: return "Found";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 429: return "Too Many Requests";
+    case 500: return "Internal Server Error";
+    case 502: return "Bad Gateway";
+    case 503: return "Service Unavailable";
+    default: return "Unknown";
+    }
+}
+
+std::string get_body(const Request& req, const std::string& path) {
+    std::ostringstream os;
+    os << "{\n  \"args\": {},\n  \"headers\": {";
+    for (size_t i = 0; i < req.headers.size(); ++ i) {
+        os << (i ? "," : "") << "\n    \"" << json_escape(req.headers[i].first) << "\": \""
+           << json_escape(req.headers[i].second) << "\"";
+    }
+    std::string host = req.header("host");
+    os << "\n  },\n  \"origin\": \"127.0.0.1\",\n  \"url\": \"http://" << json_escape(host) << json_escape(path)
+       << "\"\n}\n";
+    return os.str();
+}
+
+std::string json_body(size_t size) {
+    std::string body = "{\n  \"slideshow\": {\n    \"author\": \"Yours Truly\",\n"
+                       "    \"date\": \"date of publication\",\n    \"title\": \"Sample Slide Show\",\n"
+                       "    \"slides\": [\n      {\n        \"title\": \"Wake up to WonderWidgets!\",\n"
+                       "        \"type\": \"all\"\n      }\n    ]\n  },\n  \"padding\": \"";
+    const std::string tail = "\"\n}\n";
+    if (body.size() + tail.size() < size) {
+        body.append(size - body.size() - tail.size(), 'x');
+    }
+    return body + tail;
+}
+
+Response route(const Options& opt, const Request& req) {
+    Response resp;
+    std::string path = req.target.substr(0, req.target.find('?'));
+    if (path == "/get" || path == "/") {
+        resp.body = get_body(req, req.target);
+    }
+    else if (path == "/json") {
+        resp.body = json_body(opt.json_bytes);
+    }
+    else if (path.compare(0, 7, "/bytes/") == 0) {
+        resp.type = "application/octet-stream";
+        resp.fill = std::min((size_t)strtoull(path.c_str() + 7, nullptr, 10), opt.max_bytes);
+    }
+    else if (path.compare(0, 7, "/delay/") == 0) {
+        double s = std::min(std::max(atof(path.c_str() + 7), 0.0), 10.0);
+        resp.delay_ms = (int)(s * 1000);
+        resp.body = get_body(req, req.target);
+    }
+    else if (path.compare(0, 10, "/redirect/") == 0) {
+        int n = atoi(path.c_str() + 10);
+        if (n < 1) {
+            resp.status = 404;
+        }
+        else {
+            resp.status = 302;
+            resp.location = n == 1 ? "/get" : "/redirect/" + std::to_string(n - 1);
+        }
+    }
+    else if (path.compare(0, 7, "/cache/") == 0) {
+        resp.max_age = atoi(path.c_str() + 7);
+        resp.body = get_body(req, req.target);
+    }
+    else if (path.compare(0, 8, "/status/") == 0) {
+        resp.status = atoi(path.c_str() + 8);
+        if (resp.status < 100 || resp.status > 599) {
+            resp.status = 400;
+        }
+    }
+    else {
+        resp.status = 404;
+    }
+    if (resp.status != 200 && resp.body.empty() && !resp.fill) {
+        resp.type = "text/plain";
+    }
+    return resp;
+}
+
+struct Conn {
+    socket_t fd;
+    std::string in;
+    std::string out;
+    size_t sent = 0;
+    size_t fill_left = 0;       // out 发完后还要从 filler 发的字节数
+    size_t fill_offset = 0;
+    std::string staged;         // 延迟中的响应
+    size_t staged_fill = 0;
+    bool pending = false;       // 有响应在等定时器
+    bool close_after = false;
+    uint64_t served = 0;
+    uint64_t serial = 0;        // 定时器与连接对应，连接关闭后旧定时器作废
+    Clock::time_point last_active;
+};
+
+struct Timer {
+    Clock::time_point due;
+    socket_t fd;
+    uint64_t serial;
+    bool operator<(const Timer& o) const { return due > o.due; }
+};
+
+// 就绪事件的来源：Linux 用 epoll（各线程一个，共享监听 socket），其它平台用 select
+class Poller {
+public:
+    struct Event {
+        socket_t fd;
+        bool readable;
+        bool writable;
+    };
+
+#ifdef __linux__
+    Poller() : epfd_(epoll_create1(0)) {}
+    ~Poller() { close(epfd_); }
+    void add(socket_t fd, bool exclusive) {
+        epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | (exclusive ? (uint32_t)EPOLLEXCLUSIVE : 0u);
+        ev.data.fd = fd;
+        epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev);
+    }
+    void want(socket_t fd, bool write) {
+        epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = write ? EPOLLOUT : EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(epfd_, EPOLL_CTL_MOD, fd, &ev);
+    }
+    void remove(socket_t fd) { epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr); }
+    void wait(int timeout_ms, std::vector<Event>* events) {
+        epoll_event evs[256];
+        int n = epoll_wait(epfd_, evs, 256, timeout_ms);
+        events->clear();
+        for (int i = 0; i < n; ++ i) {
+            Event e;
+            e.fd = evs[i].data.fd;
+            e.readable = (evs[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0;
+            e.writable = (evs[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) != 0;
+            events->push_back(e);
+        }
+    }
+
+private:
+    int epfd_;
+#else
+    void add(socket_t fd, bool) { interest_[fd] = false; }
+    void want(socket_t fd, bool write) { interest_[fd] = write; }
+    void remove(socket_t fd) { interest_.erase(fd); }
+    void wait(int timeout_ms, std::vector<Event>* events) {
+        fd_set rfds, wfds;
+        FD_ZERO(&rfds);
+        FD_ZERO(&wfds);
+        socket_t maxfd = 0;
+        for (auto it = interest_.begin(); it != interest_.end(); ++ it) {
+            FD_SET(it->first, it->second ? &wfds : &rfds);
+            maxfd = std::max(maxfd, it->first);
+        }
+        timeval tv;
+        tv.tv_sec = timeout_ms / 1000;
+        tv.tv_usec = (timeout_ms % 1000) * 1000;
+        events->clear();
+        if (select((int)maxfd + 1, &rfds, &wfds, nullptr, &tv) <= 0) {
+            return;
+        }
+        for (auto it = interest_.begin(); it != interest_.end(); ++ it) {
+            Event e;
+            e.fd = it->first;
+            e.readable = FD_ISSET(it->first, &rfds) != 0;
+            e.writable = FD_ISSET(it->first, &wfds) != 0;
+            if (e.readable || e.writable) {
+                events->push_back(e);
+            }
+        }
+    }
+
+private:
+    std::unordered_map<socket_t, bool> interest_;
+#endif
+};
+
+// 一个工作线程：自己的 poller、连接表与延迟响应的定时器
+class Worker {
+public:
+    Worker(const Options& opt, socket_t listen_fd, uint32_t seed)
+        : opt_(opt), listen_fd_(listen_fd), rng_(seed) {}
+
+    void run() {
+        poller_.add(listen_fd_, true);
+        std::vector<Poller::Event> events;
+        Clock::time_point last_sweep = Clock::now();
+        while (!g_stop) {
+            int timeout_ms = 100;
+            if (!timers_.empty()) {
+                int64_t left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    timers_.top().due - Clock::now()).count();
+                timeout_ms = (int)std::max<int64_t>(0, std::min<int64_t>(left, timeout_ms));
+            }
+            poller_.wait(timeout_ms, &events);
+            for (size_t i = 0; i < events.size(); ++ i) {
+                if (events[i].fd == listen_fd_) {
+                    accept_all();
+                    continue;
+                }
+                auto it = conns_.find(events[i].fd);
+                if (it == conns_.end()) {
+                    continue;
+                }
+                Conn& c = *it->second;
+                bool ok = true;
+                if (events[i].writable && (!c.out.empty() || c.fill_left)) {
+                    ok = flush(c);
+                }
+                else if (events[i].readable) {
+                    ok = read(c);
+                }
+                if (!ok) {
+                    drop(c.fd);
+                }
+            }
+            fire_timers();
+            Clock::time_point now = Clock::now();
+            if (now - last_sweep > std::chrono::milliseconds(100)) {
+                sweep_idle(now);
+                last_sweep = now;
+            }
+        }
+        std::vector<socket_t> fds;
+        for (auto it = conns_.begin(); it != conns_.end(); ++ it) {
+            fds.push_back(it->first);
+        }
+        for (size_t i = 0; i < fds.size(); ++ i) {
+            drop(fds[i]);
+        }
+    }
+
+private:
+    void accept_all() {
+        for (;;) {
+            socket_t fd = accept(listen_fd_, nullptr, nullptr);
+            if (fd == (socket_t)-1) {
+                return;
+            }
+            set_nonblocking(fd);
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+            std::unique_ptr<Conn> c(new Conn);
+            c->fd = fd;
+            c->serial = ++ next_serial_;
+            c->last_active = Clock::now();
+            conns_[fd] = std::move(c);
+            poller_.add(fd, false);
+            g_counters.accepted.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    bool read(Conn& c) {
+        char buf[16 * 1024];
+        for (;;) {
+            int r = (int)recv(c.fd, buf, sizeof(buf), 0);
+            if (r > 0) {
+                c.in.append(buf, r);
+                continue;
+            }
+            if (r == 0 || !would_block()) {
+                return false;
+            }
+            break;
+        }
+        c.last_active = Clock::now();
+        return process(c);
+    }
+
+    // 逐个处理缓冲中的请求；同一连接一次只有一个响应在发送或等待，保证流水线请求按序应答
+    bool process(Conn& c) {
+        while (!c.pending && c.out.empty() && !c.fill_left && !c.close_after) {
+            Request req;
+            long used = parse_request(c.in, &req);
+            if (used == 0) {
+                return true;
+            }
+            Response resp;
+            if (used < 0) {
+                resp.status = 400;
+                resp.type = "text/plain";
+                c.close_after = true;
+                c.in.clear();
+            }
+            else {
+                c.in.erase(0, (size_t)used);
+                resp = route(opt_, req);
+                ++ c.served;
+                g_counters.requests.fetch_add(1, std::memory_order_relaxed);
+                std::string connection = lower(req.header("connection"));
+                bool keep = req.version == "HTTP/1.1" ? connection != "close" : connection == "keep-alive";
+                if (!opt_.keep_alive || !keep ||
+                    (opt_.max_requests_per_conn && c.served >= opt_.max_requests_per_conn)) {
+                    c.close_after = true;
+                }
+            }
+            bool head = req.method == "HEAD";
+            std::string out = serialize(resp, head, c.close_after);
+            size_t fill = head ? 0 : resp.fill;
+            int delay_ms = resp.delay_ms + opt_.latency_ms;
+            if (opt_.jitter_ms > 0) {
+                delay_ms += std::uniform_int_distribution<int>(0, opt_.jitter_ms)(rng_);
+            }
+            if (delay_ms > 0) {
+                c.staged.swap(out);
+                c.staged_fill = fill;
+                c.pending = true;
+                Timer t;
+                t.due = Clock::now() + std::chrono::milliseconds(delay_ms);
+                t.fd = c.fd;
+                t.serial = c.serial;
+                timers_.push(t);
+                return true;
+            }
+            c.out.swap(out);
+            c.fill_left = fill;
+            c.fill_offset = 0;
+            if (!flush(c)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::string serialize(const Response& resp, bool head, bool close) {
+        std::ostringstream os;
+        os << "HTTP/1.1 " << resp.status << " " << status_text(resp.status) << "\r\n"
+           << "Server: cronet_loopback_server\r\n"
+           << "Content-Type: " << resp.type << "\r\n"
+           << "Content-Length: " << resp.body.size() + resp.fill << "\r\n";
+        if (!resp.location.empty()) {
+            os << "Location: " << resp.location << "\r\n";
+        }
+        if (resp.max_age > 0) {
+            os << "Cache-Control: public, max-age=" << resp.max_age << "\r\n";
+        }
+        os << "Connection: " << (close ? "close" : "keep-alive") << "\r\n\r\n";
+        if (!head) {
+            os << resp.body;
+        }
+        return os.str();
+    }
+
+    // 尽量发完当前响应。发完后继续处理缓冲中的下一个请求，或按需关闭
+    bool flush(Conn& c) {
+        while (c.sent < c.out.size() || c.fill_left) {
+            const char* data;
+            size_t len;
+            if (c.sent < c.out.size()) {
+                data = c.out.data() + c.sent;
+                len = c.out.size() - c.sent;
+            }
+            else {
+                const std::string& f = filler();
+                data = f.data() + c.fill_offset;
+                len = std::min(c.fill_left, f.size() - c.fill_offset);
+            }
+            int w = (int)send(c.fd, data, (int)std::min(len, (size_t)(1 << 20)), 0);
+            if (w <= 0) {
+                if (w < 0 && would_block()) {
+                    poller_.want(c.fd, true);
+                    return true;
+                }
+                return false;
+            }
+            g_counters.bytes_sent.fetch_add(w, std::memory_order_relaxed);
+            if (c.sent < c.out.size()) {
+                c.sent += w;
+            }
+            else {
+                c.fill_left -= w;
+                c.fill_offset = (c.fill_offset + w) % filler().size();
+            }
+        }
+        c.out.clear();
+        c.sent = 0;
+        c.last_active = Clock::now();
+        if (c.close_after) {
+            return false;
+        }
+        poller_.want(c.fd, false);
+        return process(c);
+    }
+
+    void fire_timers() {
+        Clock::time_point now = Clock::now();
+        while (!timers_.empty() && timers_.top().due <= now) {
+            Timer t = timers_.top();
+            timers_.pop();
+            auto it = conns_.find(t.fd);
+            if (it == conns_.end() || it->second->serial != t.serial) {
+                continue;
+            }
+            Conn& c = *it->second;
+            c.pending = false;
+            c.out.swap(c.staged);
+            c.staged.clear();
+            c.fill_left = c.staged_fill;
+            c.fill_offset = 0;
+            if (!flush(c)) {
+                drop(c.fd);
+            }
+        }
+    }
+
+    void sweep_idle(Clock::time_point now) {
+        std::vector<socket_t> idle;
+        for (auto it = conns_.begin(); it != conns_.end(); ++ it) {
+            const Conn& c = *it->second;
+            if (!c.pending && c.out.empty() && !c.fill_left &&
+                now - c.last_active > std::chrono::milliseconds(opt_.idle_timeout_ms)) {
+                idle.push_back(it->first);
+            }
+        }
+        for (size_t i = 0; i < idle.size(); ++ i) {
+            drop(idle[i]);
+        }
+    }
+
+    void drop(socket_t fd) {
+        poller_.remove(fd);
+        close_socket(fd);
+        conns_.erase(fd);
+    }
+
+    const Options& opt_;
+    socket_t listen_fd_;
+    Poller poller_;
+    std::unordered_map<socket_t, std::unique_ptr<Conn>> conns_;
+    std::priority_queue<Timer> timers_;
+    std::mt19937 rng_;
+    uint64_t next_serial_ = 0;
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    for (int i = 1; i < argc; ++ i) {
+        if (strcmp(argv[i], "--addr") == 0 && i + 1 < argc) {
+            opt.addr = argv[++ i];
+        }
+        else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            opt.port = atoi(argv[++ i]);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            opt.threads = std::max(1, atoi(argv[++ i]));
+        }
+        else if (strcmp(argv[i], "--latency-ms") == 0 && i + 1 < argc) {
+            opt.latency_ms = std::max(0, atoi(argv[++ i]));
+        }
+        else if (strcmp(argv[i], "--jitter-ms") == 0 && i + 1 < argc) {
+            opt.jitter_ms = std::max(0, atoi(argv[++ i]));
+        }
+        else if (strcmp(argv[i], "--json-bytes") == 0 && i + 1 < argc) {
+            opt.json_bytes = (size_t)strtoull(argv[++ i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--max-bytes") == 0 && i + 1 < argc) {
+            opt.max_bytes = (size_t)strtoull(argv[++ i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--keep-alive") == 0 && i + 1 < argc) {
+            opt.keep_alive = atoi(argv[++ i]) != 0;
+        }
+        else if (strcmp(argv[i], "--max-requests-per-conn") == 0 && i + 1 < argc) {
+            opt.max_requests_per_conn = strtoull(argv[++ i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--idle-timeout-ms") == 0 && i + 1 < argc) {
+            opt.idle_timeout_ms = std::max(1, atoi(argv[++ i]));
+        }
+        else {
+            std::cerr << "unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+#ifndef __linux__
+    // select 版本的连接表不是线程安全的
+    opt.threads = 1;
+#endif
+
+#ifdef _WIN32
+    WSADATA wsa;
+    WSAStartup(MAKEWORD(2, 2), &wsa);
+#else
+    signal(SIGPIPE, SIG_IGN);
+#endif
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    socket_t fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == (socket_t)-1) {
+        std::cerr << "socket failed" << std::endl;
+        return 1;
+    }
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)opt.port);
+    if (inet_pton(AF_INET, opt.addr.c_str(), &addr.sin_addr) != 1) {
+        std::cerr << "bad address " << opt.addr << std::endl;
+        close_socket(fd);
+        return 1;
+    }
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 1024) != 0) {
+        std::cerr << "bind " << opt.addr << ":" << opt.port << " failed" << std::endl;
+        close_socket(fd);
+        return 1;
+    }
+    socklen_t len = sizeof(addr);
+    getsockname(fd, (sockaddr*)&addr, &len);
+    set_nonblocking(fd);
+    filler();
+    std::cout << "listening on http://" << opt.addr << ":" << ntohs(addr.sin_port) << " with " << opt.threads
+              << " thread(s), latency=" << opt.latency_ms << "ms jitter=" << opt.jitter_ms
+              << "ms keep-alive=" << (opt.keep_alive ? "on" : "off") << std::endl;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < opt.threads; ++ t) {
+        workers.push_back(std::unique_ptr<Worker>(new Worker(opt, fd, (uint32_t)t + 1)));
+    }
+    for (int t = 1; t < opt.threads; ++ t) {
+        Worker* w = workers[t].get();
+        threads.push_back(std::thread([w]() { w->run(); }));
+    }
+    workers[0]->run();
+    for (size_t t = 0; t < threads.size(); ++ t) {
+        threads[t].join();
+    }
+    close_socket(fd);
+    std::cout << "connections=" << g_counters.accepted.load() << " requests=" << g_counters.requests.load()
+              << " bytes_sent=" << g_counters.bytes_sent.load() << std::endl;
+    return 0;
+}
@@ -0,0 +1,179 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() {
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::openRead(const std::string& path) {
+    close();
+    path_ = path;
+    writable_ = false;
+    file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file_ == INVALID_HANDLE_VALUE) {
+        file_ = nullptr;
+        return false;
+    }
+    LARGE_INTEGER sz;
+    GetFileSizeEx(file_, &sz);
+    return map((uint64_t)sz.QuadPart);
+}
+
+bool MappedFile::openWrite(const std::string& path, uint64_t size) {
+    close();
+    path_ = path;
+    writable_ = true;
+    file_ = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                        OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file_ == INVALID_HANDLE_VALUE) {
+        file_ = nullptr;
+        return false;
+    }
+    LARGE_INTEGER sz;
+    GetFileSizeEx(file_, &sz);
+    return map(size > (uint64_t)sz.QuadPart ? size : (uint64_t)sz.QuadPart);
+}
+
+bool MappedFile::map(uint64_t size) {
+    if (size == 0) {
+        return false;
+    }
+    mapping_ = CreateFileMappingA(file_, NULL, writable_ ? PAGE_READWRITE : PAGE_READONLY,
+                                  (DWORD)(size >> 32), (DWORD)size, NULL);
+    if (!mapping_) {
+        return false;
+    }
+    data_ = (char*)MapViewOfFile(mapping_, writable_ ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, (SIZE_T)size);
+    if (!data_) {
+        CloseHandle(mapping_);
+        mapping_ = nullptr;
+        return false;
+    }
+    size_ = size;
+    return true;
+}
+
+void MappedFile::unmap() {
+    if (data_) {
+        UnmapViewOfFile(data_);
+        data_ = nullptr;
+    }
+    if (mapping_) {
+        CloseHandle(mapping_);
+        mapping_ = nullptr;
+    }
+}
+
+bool MappedFile::resize(uint64_t size) {
+    unmap();
+    return map(size);
+}
+
+void MappedFile::close(uint64_t final_size) {
+    unmap();
+    if (file_) {
+        if (writable_ && final_size) {
+            LARGE_INTEGER pos;
+            pos.QuadPart = (LONGLONG)final_size;
+            SetFilePointerEx(file_, pos, NULL, FILE_BEGIN);
+            SetEndOfFile(file_);
+        }
+        CloseHandle(file_);
+        file_ = nullptr;
+    }
+    size_ = 0;
+}
+
+#else
+
+bool MappedFile::openRead(const std::string& path) {
+    close();
+    path_ = path;
+    writable_ = false;
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+        return false;
+    }
+    return map((uint64_t)st.st_size);
+}
+
+bool MappedFile::openWrite(const std::string& path, uint64_t size) {
+    close();
+    path_ = path;
+    writable_ = true;
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+        return false;
+    }
+    if ((uint64_t)st.st_size < size && ftruncate(fd_, (off_t)size) != 0) {
+        return false;
+    }
+    return map(size > (uint64_t)st.st_size ? size : (uint64_t)st.st_size);
+}
+
+bool MappedFile::map(uint64_t size) {
+    if (size == 0) {
+        return false;
+    }
+    int prot = writable_ ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    void* p = mmap(nullptr, (size_t)size, prot, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED) {
+        return false;
+    }
+    data_ = (char*)p;
+    size_ = size;
+    return true;
+}
+
+void MappedFile::unmap() {
+    if (data_) {
+        munmap(data_, (size_t)size_);
+        data_ = nullptr;
+    }
+}
+
+bool MappedFile::resize(uint64_t size) {
+    unmap();
+    if (ftruncate(fd_, (off_t)size) != 0) {
+        return false;
+    }
+    return map(size);
+}
+
+void MappedFile::close(uint64_t final_size) {
+    unmap();
+    if (fd_ >= 0) {
+        if (writable_ && final_size) {
+            if (ftruncate(fd_, (off_t)final_size) != 0) {
+                // 截断失败时保留预分配的尾部，读取时以头部的 count 为准
+            }
+        }
+        ::close(fd_);
+        fd_ = -1;
+    }
+    size_ = 0;
+}
+
+#endif
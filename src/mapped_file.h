@@ -0,0 +1,45 @@
+#ifndef CRONET_CONN_STAT_MAPPED_FILE_H
+#define CRONET_CONN_STAT_MAPPED_FILE_H
+
+#include <stdint.h>
+#include <string>
+
+// 文件内存映射的简单封装（POSIX mmap / Windows MapViewOfFile）
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    // 只读映射整个文件
+    bool openRead(const std::string& path);
+    // 读写映射，文件不足 size 时扩展
+    bool openWrite(const std::string& path, uint64_t size);
+    // 重新映射为 size 大小（仅写模式），原有内容保留
+    bool resize(uint64_t size);
+    // 解除映射；写模式下把文件截断为 final_size（0 表示保持当前大小）
+    void close(uint64_t final_size = 0);
+
+    char* data() const { return data_; }
+    uint64_t size() const { return size_; }
+    bool isOpen() const { return data_ != nullptr; }
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    bool map(uint64_t size);
+    void unmap();
+
+    std::string path_;
+    char* data_ = nullptr;
+    uint64_t size_ = 0;
+    bool writable_ = false;
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+#endif // CRONET_CONN_STAT_MAPPED_FILE_H
@@ -0,0 +1,374 @@
+#include "metrics_exporter.h"
+#include "conn_stat.h"
+#include "executor_thread.h"
+
+#include <string.h>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET socket_t;
+#define close_socket closesocket
+#define poll WSAPoll
+static bool would_block() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+static void set_nonblocking(socket_t fd) { u_long on = 1; ioctlsocket(fd, FIONBIO, &on); }
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int socket_t;
+#define close_socket close
+static bool would_block() { return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR; }
+static void set_nonblocking(socket_t fd) { fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK); }
+#endif
+
+namespace {
+
+const char* kReasonNames[ConnStat::kReasonCount] = {"succeeded", "failed", "canceled"};
+
+const char* kErrorNames[ConnStat::kErrorCodeCount] = {
+    "callback", "hostname_not_resolved", "internet_disconnected", "network_changed",
+    "timed_out", "connection_closed", "connection_timed_out", "connection_refused",
+    "connection_reset", "address_unreachable", "quic_protocol_failed", "other",
+};
+
+// 导出的桶边界（秒），内部直方图单位为微秒
+const double kBucketBounds[] = {
+    0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30,
+};
+
+std::string escape_label(const std::string& v) {
+    std::string out;
+    out.reserve(v.size());
+    for (size_t i = 0; i < v.size(); ++ i) {
+        char c = v[i];
+        if (c == '\\' || c == '"') {
+            out += '\\';
+            out += c;
+        }
+        else if (c == '\n') {
+            out += "\\n";
+        }
+        else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+void write_histogram(std::ostream& os, const std::string& name, const std::string& labels,
+                     const HistogramSnapshot& snap) {
+    std::string sep = labels.empty() ? "" : ",";
+    uint64_t cumulative = 0;
+    size_t bucket = 0;
+    for (size_t b = 0; b < sizeof(kBucketBounds) / sizeof(kBucketBounds[0]); ++ b) {
+        uint64_t bound_us = (uint64_t)(kBucketBounds[b] * 1e6);
+        while (bucket < snap.counts.size() &&
+               LatencyHistogram::bucketUpperBound((int)bucket) <= bound_us) {
+            cumulative += snap.counts[bucket];
+            ++ bucket;
+        }
+        os << name << "_bucket{" << labels << sep << "le=\"" << kBucketBounds[b] << "\"} "
+           << cumulative << "\n";
+    }
+    os << name << "_bucket{" << labels << sep << "le=\"+Inf\"} " << snap.count << "\n";
+    os << name << "_count{" << labels << "} " << snap.count << "\n";
+    os << name << "_sum{" << labels << "} " << snap.sum / 1e6 << "\n";
+}
+
+} // namespace
+
+void write_openmetrics(std::ostream& os,
+                       const std::vector<const ConnStat*>& stats,
+                       const std::vector<const ExecutorThread*>& executors) {
+    os << "# TYPE cronet_requests counter\n"
+       << "# HELP cronet_requests Finished requests by reason.\n";
+    for (int r = 0; r < ConnStat::kReasonCount; ++ r) {
+        uint64_t n = 0;
+        for (size_t i = 0; i < stats.size(); ++ i) {
+            n += stats[i]->finished(r);
+        }
+        os << "cronet_requests_total{reason=\"" << kReasonNames[r] << "\"} " << n << "\n";
+    }
+
+    os << "# TYPE cronet_request_errors counter\n"
+       << "# HELP cronet_request_errors Failed requests by Cronet_Error code.\n";
+    for (int c = 0; c < ConnStat::kErrorCodeCount; ++ c) {
+        uint64_t n = 0;
+        for (size_t i = 0; i < stats.size(); ++ i) {
+            n += stats[i]->errors(c);
+        }
+        os << "cronet_request_errors_total{code=\"" << kErrorNames[c] << "\"} " << n << "\n";
+    }
+
+    // 多个 ConnStat（多引擎）按 host/协议 合并后再输出
+    struct Merged {
+        uint64_t requests = 0;
+        uint64_t reused = 0;
+        HistogramSnapshot total_new, total_reused, ttfb_new, ttfb_reused, dns, connect, ssl;
+    };
+    std::map<ConnStat::Key, Merged> merged;
+    for (size_t i = 0; i < stats.size(); ++ i) {
+        stats[i]->forEach([&merged](const ConnStat::Key& key, const ConnPoolStat& ps) {
+            Merged& m = merged[key];
+            m.requests += ps.requests.load(std::memory_order_relaxed);
+            m.reused += ps.reused.load(std::memory_order_relaxed);
+            m.total_new.merge(ps.total_new.snapshot());
+            m.total_reused.merge(ps.total_reused.snapshot());
+            m.ttfb_new.merge(ps.ttfb_new.snapshot());
+            m.ttfb_reused.merge(ps.ttfb_reused.snapshot());
+            m.dns.merge(ps.dns.snapshot());
+            m.connect.merge(ps.connect.snapshot());
+            m.ssl.merge(ps.ssl.snapshot());
+        });
+    }
+
+    std::map<ConnStat::Key, std::string> labels;
+    for (auto it = merged.begin(); it != merged.end(); ++ it) {
+        labels[it->first] = "host=\"" + escape_label(it->first.first) +
+                            "\",protocol=\"" + escape_label(it->first.second) + "\"";
+    }
+
+    os << "# TYPE cronet_pool_requests counter\n";
+    for (auto it = merged.begin(); it != merged.end(); ++ it) {
+        os << "cronet_pool_requests_total{" << labels[it->first] << "} " << it->second.requests << "\n";
+    }
+    os << "# TYPE cronet_pool_reused_requests counter\n";
+    for (auto it = merged.begin(); it != merged.end(); ++ it) {
+        os << "cronet_pool_reused_requests_total{" << labels[it->first] << "} " << it->second.reused << "\n";
+    }
+
+    os << "# TYPE cronet_request_duration_seconds histogram\n"
+       << "# UNIT cronet_request_duration_seconds seconds\n";
+    for (auto it = merged.begin(); it != merged.end(); ++ it) {
+        write_histogram(os, "cronet_request_duration_seconds", labels[it->first] + ",socket=\"new\"", it->second.total_new);
+        write_histogram(os, "cronet_request_duration_seconds", labels[it->first] + ",socket=\"reused\"", it->second.total_reused);
+    }
+    os << "# TYPE cronet_ttfb_seconds histogram\n"
+       << "# UNIT cronet_ttfb_seconds seconds\n";
+    for (auto it = merged.begin(); it != merged.end(); ++ it) {
+        write_histogram(os, "cronet_ttfb_seconds", labels[it->first] + ",socket=\"new\"", it->second.ttfb_new);
+        write_histogram(os, "cronet_ttfb_seconds", labels[it->first] + ",socket=\"reused\"", it->second.ttfb_reused);
+    }
+    os << "# TYPE cronet_connect_phase_seconds histogram\n"
+       << "# UNIT cronet_connect_phase_seconds seconds\n";
+    for (auto it = merged.begin(); it != merged.end(); ++ it) {
+        write_histogram(os, "cronet_connect_phase_seconds", labels[it->first] + ",phase=\"dns\"", it->second.dns);
+        write_histogram(os, "cronet_connect_phase_seconds", labels[it->first] + ",phase=\"connect\"", it->second.connect);
+        write_histogram(os, "cronet_connect_phase_seconds", labels[it->first] + ",phase=\"ssl\"", it->second.ssl);
+    }
+
+    if (!executors.empty()) {
+        os << "# TYPE cronet_executor_tasks_posted counter\n";
+        for (size_t i = 0; i < executors.size(); ++ i) {
+            os << "cronet_executor_tasks_posted_total{executor=\"" << escape_label(executors[i]->name()) << "\"} "
+               << executors[i]->stats().posted.load(std::memory_order_relaxed) << "\n";
+        }
+        os << "# TYPE cronet_executor_tasks_executed counter\n";
+        for (size_t i = 0; i < executors.size(); ++ i) {
+            os << "cronet_executor_tasks_executed_total{executor=\"" << escape_label(executors[i]->name()) << "\"} "
+               << executors[i]->stats().executed.load(std::memory_order_relaxed) << "\n";
+        }
+        os << "# TYPE cronet_executor_task_errors counter\n";
+        for (size_t i = 0; i < executors.size(); ++ i) {
+            os << "cronet_executor_task_errors_total{executor=\"" << escape_label(executors[i]->name()) << "\"} "
+               << executors[i]->stats().errors.load(std::memory_order_relaxed) << "\n";
+        }
+        os << "# TYPE cronet_executor_queue_depth gauge\n";
+        for (size_t i = 0; i < executors.size(); ++ i) {
+            os << "cronet_executor_queue_depth{executor=\"" << escape_label(executors[i]->name()) << "\"} "
+               << executors[i]->queueDepth() << "\n";
+        }
+        os << "# TYPE cronet_executor_queue_wait_seconds histogram\n"
+           << "# UNIT cronet_executor_queue_wait_seconds seconds\n";
+        for (size_t i = 0; i < executors.size(); ++ i) {
+            write_histogram(os, "cronet_executor_queue_wait_seconds",
+                            "executor=\"" + escape_label(executors[i]->name()) + "\"",
+                            executors[i]->stats().queue_wait.snapshot());
+        }
+        os << "# TYPE cronet_executor_task_run_seconds histogram\n"
+           << "# UNIT cronet_executor_task_run_seconds seconds\n";
+        for (size_t i = 0; i < executors.size(); ++ i) {
+            write_histogram(os, "cronet_executor_task_run_seconds",
+                            "executor=\"" + escape_label(executors[i]->name()) + "\"",
+                            executors[i]->stats().run_time.snapshot());
+        }
+    }
+    os << "# EOF\n";
+}
+
+MetricsExporter::MetricsExporter() {
+}
+
+MetricsExporter::~MetricsExporter() {
+    stop();
+}
+
+bool MetricsExporter::start(const std::string& address, int port, Collector collector) {
+#ifdef _WIN32
+    WSADATA wsa;
+    WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+    socket_t fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == (socket_t)-1) {
+        std::cerr << "metrics exporter: socket failed" << std::endl;
+        return false;
+    }
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1) {
+        std::cerr << "metrics exporter: bad address " << address << std::endl;
+        close_socket(fd);
+        return false;
+    }
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0) {
+        std::cerr << "metrics exporter: bind " << address << ":" << port << " failed" << std::endl;
+        close_socket(fd);
+        return false;
+    }
+    socklen_t len = sizeof(addr);
+    getsockname(fd, (sockaddr*)&addr, &len);
+    port_ = ntohs(addr.sin_port);
+    set_nonblocking(fd);
+
+    listen_fd_ = (intptr_t)fd;
+    collector_ = collector;
+    stop_ = false;
+    thread_ = std::thread([this]() { run(); });
+    return true;
+}
+
+void MetricsExporter::stop() {
+    stop_ = true;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (listen_fd_ != -1) {
+        close_socket((socket_t)listen_fd_);
+        listen_fd_ = -1;
+    }
+}
+
+std::string MetricsExporter::handle(const std::string& request) {
+    std::string line = request.substr(0, request.find("\r\n"));
+    std::string status = "200 OK";
+    std::string type = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+    std::string body;
+    if (line.compare(0, 13, "GET /metrics ") == 0 || line.compare(0, 13, "GET /metrics?") == 0) {
+        std::ostringstream os;
+        collector_(os);
+        body = os.str();
+        scrapes_.fetch_add(1);
+    }
+    else {
+        status = "404 Not Found";
+        type = "text/plain";
+        body = "not found\n";
+    }
+    std::ostringstream resp;
+    resp << "HTTP/1.1 " << status << "\r\n"
+         << "Content-Type: " << type << "\r\n"
+         << "Content-Length: " << body.size() << "\r\n"
+         << "Connection: close\r\n\r\n"
+         << body;
+    return resp.str();
+}
+
+void MetricsExporter::run() {
+    struct Conn {
+        socket_t fd;
+        std::string in;
+        std::string out;
+        size_t sent;
+    };
+    std::vector<Conn> conns;
+    socket_t lfd = (socket_t)listen_fd_;
+
+    // 与 Cronet、回环压测同进程，fd 常常超过 FD_SETSIZE，不能用 select
+    std::vector<pollfd> pfds;
+    while (!stop_) {
+        pfds.resize(conns.size() + 1);
+        pfds[0].fd = lfd;
+        pfds[0].events = POLLIN;
+        pfds[0].revents = 0;
+        for (size_t i = 0; i < conns.size(); ++ i) {
+            pfds[i + 1].fd = conns[i].fd;
+            pfds[i + 1].events = conns[i].out.empty() ? POLLIN : POLLOUT;
+            pfds[i + 1].revents = 0;
+        }
+        int n = poll(pfds.data(), (unsigned long)pfds.size(), 200);
+        if (n <= 0) {
+            continue;
+        }
+
+        // 下面会增删 conns，先按 conns 的顺序取出各连接的就绪事件
+        std::vector<short> ready(conns.size());
+        for (size_t i = 0; i < conns.size(); ++ i) {
+            ready[i] = pfds[i + 1].revents;
+        }
+        size_t polled = conns.size();
+        if (pfds[0].revents & POLLIN) {
+            while (conns.size() < 64) {
+                socket_t cfd = accept(lfd, nullptr, nullptr);
+                if (cfd == (socket_t)-1) {
+                    break;
+                }
+                set_nonblocking(cfd);
+                Conn c;
+                c.fd = cfd;
+                c.sent = 0;
+                conns.push_back(c);
+            }
+        }
+
+        for (size_t i = polled; i-- > 0;) {
+            Conn& c = conns[i];
+            bool closed = (ready[i] & (POLLERR | POLLNVAL)) != 0;
+            if (!closed && c.out.empty() && (ready[i] & (POLLIN | POLLHUP))) {
+                char buf[4096];
+                int r = (int)recv(c.fd, buf, sizeof(buf), 0);
+                if (r > 0) {
+                    c.in.append(buf, r);
+                    if (c.in.find("\r\n\r\n") != std::string::npos) {
+                        c.out = handle(c.in);
+                    }
+                    else if (c.in.size() > 16 * 1024) {
+                        closed = true;
+                    }
+                }
+                else if (r == 0 || !would_block()) {
+                    closed = true;
+                }
+            }
+            else if (!closed && !c.out.empty() && (ready[i] & POLLOUT)) {
+                int w = (int)send(c.fd, c.out.data() + c.sent, (int)(c.out.size() - c.sent), 0);
+                if (w > 0) {
+                    c.sent += w;
+                    closed = c.sent == c.out.size();
+                }
+                else if (!would_block()) {
+                    closed = true;
+                }
+            }
+            if (closed) {
+                close_socket(c.fd);
+                conns.erase(conns.begin() + i);
+            }
+        }
+    }
+    for (size_t i = 0; i < conns.size(); ++ i) {
+        close_socket(conns[i].fd);
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef CRONET_CONN_STAT_METRICS_EXPORTER_H
+#define CRONET_CONN_STAT_METRICS_EXPORTER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+class ConnStat;
+class ExecutorThread;
+
+// 按 OpenMetrics 文本格式输出，只读原子计数与直方图快照，不触碰记录路径上的锁
+void write_openmetrics(std::ostream& os,
+                       const std::vector<const ConnStat*>& stats,
+                       const std::vector<const ExecutorThread*>& executors);
+
+// 内嵌的 HTTP 监听，GET /metrics 返回 collector 的输出。
+// 单独一个线程 + 非阻塞 socket + poll，抓取慢不会影响 Cronet 回调
+class MetricsExporter {
+public:
+    typedef std::function<void(std::ostream&)> Collector;
+
+    MetricsExporter();
+    ~MetricsExporter();
+
+    // port 为 0 时由系统分配，之后可通过 port() 获取
+    bool start(const std::string& address, int port, Collector collector);
+    void stop();
+    int port() const { return port_; }
+    uint64_t scrapes() const { return scrapes_.load(); }
+
+private:
+    MetricsExporter(const MetricsExporter&);
+    MetricsExporter& operator=(const MetricsExporter&);
+
+    void run();
+    std::string handle(const std::string& request);
+
+    Collector collector_;
+    std::thread thread_;
+    std::atomic<bool> stop_{false};
+    std::atomic<uint64_t> scrapes_{0};
+    intptr_t listen_fd_ = -1;
+    int port_ = 0;
+};
+
+#endif // CRONET_CONN_STAT_METRICS_EXPORTER_H
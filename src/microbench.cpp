@@ -0,0 +1,354 @@
+// 热路径微基准：执行器投递、读缓冲分配、rr_map 与直方图记录。
+// 结果打印为表格，--out 另存为 JSON Lines（每行一个结果），--baseline 与之前的结果比较，
+// ns_per_op 变慢超过 --tolerance 时以非零退出码结束，便于在改动热路径后发现回退。
+//
+// usage: cronet_microbench [--filter SUBSTR] [--scale X] [--max-producers N] [--out FILE]
+//                          [--baseline FILE] [--tolerance 0.2]
+
+#include "executor_thread.h"
+#include "histogram.h"
+#include <cronet/cronet_c.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct BenchResult {
+    std::string name;
+    uint64_t ops = 0;
+    double seconds = 0;
+    // 有延迟分布的基准（执行器排队）才填，单位微秒
+    bool has_latency = false;
+    HistogramSnapshot latency;
+
+    double nsPerOp() const { return ops ? seconds * 1e9 / ops : 0; }
+    double opsPerSec() const { return seconds > 0 ? ops / seconds : 0; }
+};
+
+// 防止被测循环被优化掉
+std::atomic<uint64_t> g_sink{0};
+
+double seconds_since(Clock::time_point begin) {
+    return std::chrono::duration<double>(Clock::now() - begin).count();
+}
+
+// P 个生产者各投递 n 个空任务，从第一次投递计到最后一个任务执行完
+BenchResult bench_executor_post(int producers, uint64_t n) {
+    BenchResult r;
+    r.name = "executor_post/producers=" + std::to_string(producers);
+    std::atomic<uint64_t> done{0};
+    const uint64_t total = n * producers;
+    {
+        ExecutorThread executor("bench");
+        std::vector<std::thread> threads;
+        std::atomic<bool> go{false};
+        for (int p = 0; p < producers; ++ p) {
+            threads.push_back(std::thread([&]() {
+                while (!go.load()) {
+                    std::this_thread::yield();
+                }
+                for (uint64_t i = 0; i < n; ++ i) {
+                    executor.postTask([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+                }
+            }));
+        }
+        Clock::time_point begin = Clock::now();
+        go = true;
+        for (size_t t = 0; t < threads.size(); ++ t) {
+            threads[t].join();
+        }
+        while (done.load() < total) {
+            std::this_thread::yield();
+        }
+        r.seconds = seconds_since(begin);
+        r.has_latency = true;
+        r.latency = executor.stats().queue_wait.snapshot();
+    }
+    r.ops = total;
+    return r;
+}
+
+// 读路径现状：每次 Read 新建一个缓冲，回调里销毁
+BenchResult bench_buffer_alloc(uint64_t size, uint64_t n) {
+    BenchResult r;
+    r.name = "buffer_alloc/size=" + std::to_string(size);
+    Clock::time_point begin = Clock::now();
+    for (uint64_t i = 0; i < n; ++ i) {
+        Cronet_BufferPtr buffer = Cronet_Buffer_Create();
+        Cronet_Buffer_InitWithAlloc(buffer, size);
+        static_cast<char*>(Cronet_Buffer_GetData(buffer))[0] = (char)i;
+        g_sink.fetch_add(Cronet_Buffer_GetSize(buffer), std::memory_order_relaxed);
+        Cronet_Buffer_Destroy(buffer);
+    }
+    r.seconds = seconds_since(begin);
+    r.ops = n;
+    return r;
+}
+
+// 对照：缓冲放回空闲表，下次 Read 直接取用
+BenchResult bench_buffer_recycle(uint64_t size, uint64_t n) {
+    BenchResult r;
+    r.name = "buffer_recycle/size=" + std::to_string(size);
+    std::vector<Cronet_BufferPtr> free_list;
+    Clock::time_point begin = Clock::now();
+    for (uint64_t i = 0; i < n; ++ i) {
+        Cronet_BufferPtr buffer;
+        if (free_list.empty()) {
+            buffer = Cronet_Buffer_Create();
+            Cronet_Buffer_InitWithAlloc(buffer, size);
+        }
+        else {
+            buffer = free_list.back();
+            free_list.pop_back();
+        }
+        static_cast<char*>(Cronet_Buffer_GetData(buffer))[0] = (char)i;
+        g_sink.fetch_add(Cronet_Buffer_GetSize(buffer), std::memory_order_relaxed);
+        free_list.push_back(buffer);
+    }
+    r.seconds = seconds_since(begin);
+    r.ops = n;
+    for (size_t i = 0; i < free_list.size(); ++ i) {
+        Cronet_Buffer_Destroy(free_list[i]);
+    }
+    return r;
+}
+
+// 与 cronet_conn_stat 的 rr_map 相同的结构：保持 live 个在飞请求，每次操作为一次插入 + 一次查找 + 一次删除
+BenchResult bench_rr_map(size_t live, uint64_t n) {
+    BenchResult r;
+    r.name = "rr_map/live=" + std::to_string(live);
+    // 用真实分配的地址做键，分布与 Cronet 分配的 UrlResponseInfo 相近
+    std::vector<std::unique_ptr<char[]>> storage;
+    std::vector<Cronet_UrlResponseInfoPtr> keys;
+    const size_t pool = live * 2 + 1;
+    for (size_t i = 0; i < pool; ++ i) {
+        storage.push_back(std::unique_ptr<char[]>(new char[64]));
+        keys.push_back(reinterpret_cast<Cronet_UrlResponseInfoPtr>(storage.back().get()));
+    }
+    std::mt19937 rng(1);
+    std::shuffle(keys.begin(), keys.end(), rng);
+
+    std::map<Cronet_UrlResponseInfoPtr, Cronet_UrlRequestPtr> rr_map;
+    for (size_t i = 0; i < live; ++ i) {
+        rr_map[keys[i]] = reinterpret_cast<Cronet_UrlRequestPtr>(keys[i]);
+    }
+    Clock::time_point begin = Clock::now();
+    for (uint64_t i = 0; i < n; ++ i) {
+        Cronet_UrlResponseInfoPtr add = keys[(i + live) % pool];
+        Cronet_UrlResponseInfoPtr old = keys[i % pool];
+        rr_map[add] = reinterpret_cast<Cronet_UrlRequestPtr>(add);
+        auto it = rr_map.find(old);
+        if (it != rr_map.end()) {
+            g_sink.fetch_add(reinterpret_cast<uintptr_t>(it->second) & 1, std::memory_order_relaxed);
+            rr_map.erase(it);
+        }
+    }
+    r.seconds = seconds_since(begin);
+    r.ops = n;
+    return r;
+}
+
+// T 个线程同时记录到同一个直方图
+BenchResult bench_histogram_record(int threads, uint64_t n) {
+    BenchResult r;
+    r.name = "histogram_record/threads=" + std::to_string(threads);
+    LatencyHistogram hist;
+    std::vector<std::thread> workers;
+    std::atomic<bool> go{false};
+    for (int t = 0; t < threads; ++ t) {
+        workers.push_back(std::thread([&hist, &go, n, t]() {
+            std::mt19937_64 rng(t + 1);
+            std::vector<uint64_t> values(4096);
+            for (size_t i = 0; i < values.size(); ++ i) {
+                values[i] = rng() % 2000000;
+            }
+            while (!go.load()) {
+                std::this_thread::yield();
+            }
+            for (uint64_t i = 0; i < n; ++ i) {
+                hist.record(values[i & 4095]);
+            }
+        }));
+    }
+    Clock::time_point begin = Clock::now();
+    go = true;
+    for (size_t t = 0; t < workers.size(); ++ t) {
+        workers[t].join();
+    }
+    r.seconds = seconds_since(begin);
+    r.ops = n * threads;
+    g_sink.fetch_add(hist.snapshot().count, std::memory_order_relaxed);
+    return r;
+}
+
+std::string to_json(const BenchResult& r) {
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(6);
+    os << "{\"name\":\"" << r.name << "\",\"ops\":" << r.ops << ",\"seconds\":" << r.seconds << std::setprecision(3)
+       << ",\"ns_per_op\":" << r.nsPerOp() << ",\"ops_per_sec\":" << r.opsPerSec();
+    if (r.has_latency) {
+        os << ",\"p50_us\":" << r.latency.percentile(0.50) << ",\"p99_us\":" << r.latency.percentile(0.99)
+           << ",\"max_us\":" << r.latency.max;
+    }
+    os << "}";
+    return os.str();
+}
+
+// 从 --out 写出的文件里读回 name -> ns_per_op
+std::map<std::string, double> load_baseline(const std::string& path) {
+    std::map<std::string, double> baseline;
+    std::ifstream ifs(path.c_str());
+    std::string line;
+    while (std::getline(ifs, line)) {
+        size_t name = line.find("\"name\":\"");
+        size_t ns = line.find("\"ns_per_op\":");
+        if (name == std::string::npos || ns == std::string::npos) {
+            continue;
+        }
+        name += 8;
+        size_t end = line.find('"', name);
+        baseline[line.substr(name, end - name)] = atof(line.c_str() + ns + 12);
+    }
+    return baseline;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string filter;
+    double scale = 1.0;
+    int max_producers = std::max(1, (int)std::thread::hardware_concurrency());
+    std::string out_file;
+    std::string baseline_file;
+    double tolerance = 0.2;
+    for (int i = 1; i < argc; ++ i) {
+        if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++ i];
+        }
+        else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            scale = atof(argv[++ i]);
+        }
+        else if (strcmp(argv[i], "--max-producers") == 0 && i + 1 < argc) {
+            max_producers = std::max(1, atoi(argv[++ i]));
+        }
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_file = argv[++ i];
+        }
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline_file = argv[++ i];
+        }
+        else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+            tolerance = atof(argv[++ i]);
+        }
+        else {
+            std::cerr << "unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if (scale <= 0) {
+        scale = 1.0;
+    }
+    auto ops = [scale](uint64_t n) { return std::max<uint64_t>(1, (uint64_t)(n * scale)); };
+    auto wanted = [&filter](const std::string& name) {
+        return filter.empty() || name.find(filter) != std::string::npos;
+    };
+
+    std::vector<BenchResult> results;
+    std::vector<int> producers;
+    for (int p = 1; p < max_producers; p *= 2) {
+        producers.push_back(p);
+    }
+    producers.push_back(max_producers);
+    for (size_t i = 0; i < producers.size(); ++ i) {
+        if (wanted("executor_post/producers=" + std::to_string(producers[i]))) {
+            results.push_back(bench_executor_post(producers[i], ops(400000) / producers[i]));
+        }
+    }
+    const uint64_t sizes[] = {4096, 32768};
+    for (size_t i = 0; i < 2; ++ i) {
+        if (wanted("buffer_alloc/size=" + std::to_string(sizes[i]))) {
+            results.push_back(bench_buffer_alloc(sizes[i], ops(1000000)));
+        }
+        if (wanted("buffer_recycle/size=" + std::to_string(sizes[i]))) {
+            results.push_back(bench_buffer_recycle(sizes[i], ops(1000000)));
+        }
+    }
+    const size_t lives[] = {100, 10000, 1000000};
+    for (size_t i = 0; i < 3; ++ i) {
+        if (wanted("rr_map/live=" + std::to_string(lives[i]))) {
+            results.push_back(bench_rr_map(lives[i], ops(1000000)));
+        }
+    }
+    for (size_t i = 0; i < producers.size(); ++ i) {
+        if (wanted("histogram_record/threads=" + std::to_string(producers[i]))) {
+            results.push_back(bench_histogram_record(producers[i], ops(4000000) / producers[i]));
+        }
+    }
+
+    std::map<std::string, double> baseline;
+    if (!baseline_file.empty()) {
+        baseline = load_baseline(baseline_file);
+        if (baseline.empty()) {
+            std::cerr << "no result in baseline " << baseline_file << std::endl;
+        }
+    }
+    int regressions = 0;
+    std::cout << std::left << std::setw(34) << "benchmark" << std::right << std::setw(12) << "ns/op"
+              << std::setw(14) << "ops/s" << std::setw(10) << "p50 us" << std::setw(10) << "p99 us";
+    if (!baseline.empty()) {
+        std::cout << std::setw(12) << "vs base";
+    }
+    std::cout << std::endl << std::fixed << std::setprecision(1);
+    for (size_t i = 0; i < results.size(); ++ i) {
+        const BenchResult& r = results[i];
+        std::cout << std::left << std::setw(34) << r.name << std::right << std::setw(12) << r.nsPerOp()
+                  << std::setw(14) << std::setprecision(0) << r.opsPerSec() << std::setprecision(1);
+        if (r.has_latency) {
+            std::cout << std::setw(10) << r.latency.percentile(0.50) << std::setw(10) << r.latency.percentile(0.99);
+        }
+        else {
+            std::cout << std::setw(10) << "-" << std::setw(10) << "-";
+        }
+        auto it = baseline.find(r.name);
+        if (it != baseline.end() && it->second > 0) {
+            double change = r.nsPerOp() / it->second - 1;
+            bool regressed = change > tolerance;
+            regressions += regressed ? 1 : 0;
+            std::cout << std::setw(11) << std::showpos << change * 100 << std::noshowpos << "%"
+                      << (regressed ? "  REGRESSION" : "");
+        }
+        std::cout << std::endl;
+    }
+
+    if (!out_file.empty()) {
+        std::ofstream ofs(out_file.c_str());
+        for (size_t i = 0; i < results.size(); ++ i) {
+            ofs << to_json(results[i]) << "\n";
+        }
+        if (!ofs) {
+            std::cerr << "write " << out_file << " failed" << std::endl;
+            return 1;
+        }
+    }
+    if (regressions) {
+        std::cerr << regressions << " benchmark(s) slower than baseline by more than " << tolerance * 100 << "%"
+                  << std::endl;
+        return 2;
+    }
+    return 0;
+}
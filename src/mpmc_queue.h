@@ -0,0 +1,99 @@
+#ifndef CRONET_CONN_STAT_MPMC_QUEUE_H
+#define CRONET_CONN_STAT_MPMC_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+// 有界无锁队列（Vyukov bounded MPMC），满时 tryPush 直接返回 false，
+// 用于从 Cronet 回调线程把数据交给后台线程而不阻塞回调
+template <typename T>
+class MpmcQueue {
+public:
+    // capacity 会向上取整为 2 的幂
+    explicit MpmcQueue(size_t capacity) {
+        size_t n = 2;
+        while (n < capacity) {
+            n <<= 1;
+        }
+        mask_ = n - 1;
+        cells_ = std::vector<Cell>(n);
+        for (size_t i = 0; i < n; ++ i) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+    }
+
+    bool tryPush(const T& value) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & mask_];
+            size_t seq = cell.seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T& value) {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & mask_];
+            size_t seq = cell.seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    value = cell.value;
+                    cell.seq.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        T value;
+
+        Cell() : seq(0), value() {}
+        Cell(const Cell& o) : seq(o.seq.load(std::memory_order_relaxed)), value(o.value) {}
+        Cell& operator=(const Cell& o) {
+            seq.store(o.seq.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            value = o.value;
+            return *this;
+        }
+    };
+
+    std::vector<Cell> cells_;
+    size_t mask_ = 0;
+    // head/tail 分开放在不同缓存行，避免生产者与消费者互相伪共享
+    char pad0_[64];
+    std::atomic<size_t> tail_;
+    char pad1_[64];
+    std::atomic<size_t> head_;
+    char pad2_[64];
+};
+
+#endif // CRONET_CONN_STAT_MPMC_QUEUE_H
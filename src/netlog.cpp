@@ -0,0 +1,768 @@
+#include "netlog.h"
+#include "record_log.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <iomanip>
+
+static const size_t kChunkSize = 4 * 1024 * 1024;
+
+static inline bool is_ws(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static const char* skip_ws(const char* p, const char* end) {
+    while (p < end && is_ws(*p)) {
+        ++ p;
+    }
+    return p;
+}
+
+// p 指向开头的引号，返回结束引号之后的位置；数据不完整时返回 nullptr
+static const char* skip_string(const char* p, const char* end) {
+    for (++ p; p < end; ++ p) {
+        const char* q = (const char*)memchr(p, '"', end - p);
+        if (!q) {
+            return nullptr;
+        }
+        // 引号前连续反斜杠为奇数个时是转义
+        const char* b = q;
+        while (b > p && b[-1] == '\\') {
+            -- b;
+        }
+        if ((q - b) % 2 == 0) {
+            return q + 1;
+        }
+        p = q;
+    }
+    return nullptr;
+}
+
+// 跳过一个 JSON 值，数据不完整时返回 nullptr
+static const char* skip_value(const char* p, const char* end) {
+    p = skip_ws(p, end);
+    if (p >= end) {
+        return nullptr;
+    }
+    if (*p == '"') {
+        return skip_string(p, end);
+    }
+    if (*p == '{' || *p == '[') {
+        int depth = 0;
+        while (p < end) {
+            char c = *p;
+            if (c == '"') {
+                p = skip_string(p, end);
+                if (!p) {
+                    return nullptr;
+                }
+                continue;
+            }
+            if (c == '{' || c == '[') {
+                ++ depth;
+            }
+            else if (c == '}' || c == ']') {
+                if (-- depth == 0) {
+                    return p + 1;
+                }
+            }
+            ++ p;
+        }
+        return nullptr;
+    }
+    // 数字与 true/false/null，以分隔符结束
+    while (p < end && *p != ',' && *p != '}' && *p != ']' && !is_ws(*p)) {
+        ++ p;
+    }
+    return p < end ? p : nullptr;
+}
+
+static bool key_is(const char* key, size_t len, const char* name) {
+    return strlen(name) == len && memcmp(key, name, len) == 0;
+}
+
+// 依次回调对象的每个成员 fn(key, key_len, value_begin, value_end)，格式不对时返回 false
+template <typename F>
+static bool for_each_member(const char* p, const char* end, F fn) {
+    p = skip_ws(p, end);
+    if (p >= end || *p != '{') {
+        return false;
+    }
+    ++ p;
+    while (true) {
+        p = skip_ws(p, end);
+        if (p >= end) {
+            return false;
+        }
+        if (*p == '}') {
+            return true;
+        }
+        if (*p == ',') {
+            ++ p;
+            continue;
+        }
+        if (*p != '"') {
+            return false;
+        }
+        const char* key_end = skip_string(p, end);
+        if (!key_end) {
+            return false;
+        }
+        const char* key = p + 1;
+        p = skip_ws(key_end, end);
+        if (p >= end || *p != ':') {
+            return false;
+        }
+        const char* value = skip_ws(p + 1, end);
+        const char* value_end = skip_value(value, end);
+        if (!value_end) {
+            return false;
+        }
+        fn(key, (size_t)(key_end - 1 - key), value, value_end);
+        p = value_end;
+    }
+}
+
+// 数字或带引号的数字（NetLog 的 time 与 timeTickOffset 是字符串）
+static bool parse_int(const char* p, const char* end, int64_t* out) {
+    if (p < end && *p == '"') {
+        ++ p;
+    }
+    if (p >= end || !(*p == '-' || (*p >= '0' && *p <= '9'))) {
+        return false;
+    }
+    char* stop = nullptr;
+    *out = strtoll(p, &stop, 10);
+    return stop != p;
+}
+
+// 去掉引号并处理常见转义，\u 只保留 ASCII
+static bool parse_string(const char* p, const char* end, std::string* out) {
+    if (p >= end || *p != '"' || end - p < 2) {
+        return false;
+    }
+    out->clear();
+    for (++ p, -- end; p < end; ++ p) {
+        char c = *p;
+        if (c != '\\' || p + 1 >= end) {
+            out->push_back(c);
+            continue;
+        }
+        c = *++ p;
+        switch (c) {
+        case 'n': out->push_back('\n'); break;
+        case 't': out->push_back('\t'); break;
+        case 'r': out->push_back('\r'); break;
+        case 'u':
+            if (end - p > 4) {
+                char hex[5] = {p[1], p[2], p[3], p[4], 0};
+                long v = strtol(hex, nullptr, 16);
+                out->push_back(v < 0x80 ? (char)v : '?');
+                p += 4;
+            }
+            break;
+        default: out->push_back(c); break;
+        }
+    }
+    return true;
+}
+
+static bool parse_name_table(const char* p, const char* end, std::map<std::string, int>* out) {
+    return for_each_member(p, end, [out](const char* key, size_t len, const char* v, const char* ve) {
+        int64_t id = 0;
+        if (parse_int(v, ve, &id)) {
+            (*out)[std::string(key, len)] = (int)id;
+        }
+    });
+}
+
+bool netlog_string_param(const NetLogEvent& ev, const char* key, std::string* out) {
+    bool found = false;
+    for_each_member(ev.params, ev.params + ev.params_len,
+                    [&](const char* k, size_t len, const char* v, const char* ve) {
+                        if (!found && key_is(k, len, key)) {
+                            found = parse_string(v, ve, out);
+                        }
+                    });
+    return found;
+}
+
+bool netlog_int_param(const NetLogEvent& ev, const char* key, int64_t* out) {
+    bool found = false;
+    for_each_member(ev.params, ev.params + ev.params_len,
+                    [&](const char* k, size_t len, const char* v, const char* ve) {
+                        if (!found && key_is(k, len, key)) {
+                            found = parse_int(v, ve, out);
+                        }
+                    });
+    return found;
+}
+
+bool netlog_dependency(const NetLogEvent& ev, uint32_t* id, int* type) {
+    if (type) {
+        *type = -1;
+    }
+    bool found = false;
+    for_each_member(ev.params, ev.params + ev.params_len,
+                    [&](const char* k, size_t len, const char* v, const char* ve) {
+                        if (found || !key_is(k, len, "source_dependency")) {
+                            return;
+                        }
+                        for_each_member(v, ve, [&](const char* k2, size_t len2, const char* v2, const char* ve2) {
+                            int64_t value = 0;
+                            if (key_is(k2, len2, "id") && parse_int(v2, ve2, &value)) {
+                                *id = (uint32_t)value;
+                                found = true;
+                            }
+                            else if (type && key_is(k2, len2, "type") && parse_int(v2, ve2, &value)) {
+                                *type = (int)value;
+                            }
+                        });
+                    });
+    return found;
+}
+
+NetLogReader::NetLogReader() {
+}
+
+NetLogReader::~NetLogReader() {
+    if (file_) {
+        fclose(file_);
+    }
+}
+
+// 把未处理的数据挪到缓冲区开头再读一块；一个值比缓冲区还大时扩容
+bool NetLogReader::fill() {
+    if (pos_ > 0) {
+        memmove(buf_.data(), buf_.data() + pos_, len_ - pos_);
+        len_ -= pos_;
+        pos_ = 0;
+    }
+    if (len_ == buf_.size()) {
+        buf_.resize(buf_.size() * 2);
+    }
+    size_t n = fread(buf_.data() + len_, 1, buf_.size() - len_, file_);
+    len_ += n;
+    bytes_read_ += n;
+    if (n == 0) {
+        if (ferror(file_)) {
+            return false;
+        }
+        eof_ = true;
+    }
+    return true;
+}
+
+bool NetLogReader::open(const std::string& path, std::string* error) {
+    file_ = fopen(path.c_str(), "rb");
+    if (!file_) {
+        *error = "cannot open " + path + ": " + strerror(errno);
+        return false;
+    }
+    buf_.resize(kChunkSize);
+    if (!fill()) {
+        *error = "cannot read " + path;
+        return false;
+    }
+    const char* p = skip_ws(buf_.data(), buf_.data() + len_);
+    if (p >= buf_.data() + len_ || *p != '{') {
+        *error = path + " is not a NetLog JSON file";
+        return false;
+    }
+    pos_ = p + 1 - buf_.data();
+
+    // 顶层对象的成员依次处理，直到 "events": [
+    while (true) {
+        const char* begin = buf_.data() + pos_;
+        const char* end = buf_.data() + len_;
+        p = skip_ws(begin, end);
+        if (p < end && *p == ',') {
+            pos_ = p + 1 - buf_.data();
+            continue;
+        }
+        if (p < end && *p == '}') {
+            *error = path + " has no events array";
+            return false;
+        }
+        if (p < end && *p != '"') {
+            *error = path + " is not a NetLog JSON file";
+            return false;
+        }
+        const char* key_end = p < end ? skip_string(p, end) : nullptr;
+        const char* value = key_end ? skip_ws(key_end, end) : nullptr;
+        if (value && value < end && *value == ':') {
+            value = skip_ws(value + 1, end);
+            if (value < end && key_is(p + 1, key_end - 1 - (p + 1), "events")) {
+                if (*value != '[') {
+                    *error = "events in " + path + " is not an array";
+                    return false;
+                }
+                pos_ = value + 1 - buf_.data();
+                return true;
+            }
+            const char* value_end = value < end ? skip_value(value, end) : nullptr;
+            if (value_end) {
+                if (key_is(p + 1, key_end - 1 - (p + 1), "constants") && !parseConstants(value, value_end)) {
+                    *error = "bad constants in " + path;
+                    return false;
+                }
+                pos_ = value_end - buf_.data();
+                continue;
+            }
+        }
+        // 当前成员不完整，再读一块
+        if (eof_) {
+            *error = path + " is truncated before the events array";
+            return false;
+        }
+        if (!fill()) {
+            *error = "cannot read " + path;
+            return false;
+        }
+    }
+}
+
+bool NetLogReader::parseConstants(const char* begin, const char* end) {
+    bool ok = true;
+    return for_each_member(begin, end, [&](const char* key, size_t len, const char* v, const char* ve) {
+        if (key_is(key, len, "logEventTypes")) {
+            ok = parse_name_table(v, ve, &event_types_) && ok;
+        }
+        else if (key_is(key, len, "logSourceType")) {
+            ok = parse_name_table(v, ve, &source_types_) && ok;
+        }
+        else if (key_is(key, len, "timeTickOffset")) {
+            parse_int(v, ve, &tick_offset_);
+        }
+    }) && ok;
+}
+
+bool NetLogReader::parseEvent(const char* begin, const char* end, NetLogEvent* ev) const {
+    int64_t tick = 0;
+    bool ok = for_each_member(begin, end, [&](const char* key, size_t len, const char* v, const char* ve) {
+        int64_t value = 0;
+        if (key_is(key, len, "type")) {
+            if (parse_int(v, ve, &value)) {
+                ev->type = (int)value;
+            }
+        }
+        else if (key_is(key, len, "phase")) {
+            if (parse_int(v, ve, &value)) {
+                ev->phase = (int)value;
+            }
+        }
+        else if (key_is(key, len, "time")) {
+            parse_int(v, ve, &tick);
+        }
+        else if (key_is(key, len, "params")) {
+            ev->params = v;
+            ev->params_len = ve - v;
+        }
+        else if (key_is(key, len, "source")) {
+            for_each_member(v, ve, [&](const char* k2, size_t len2, const char* v2, const char* ve2) {
+                int64_t id = 0;
+                if (key_is(k2, len2, "id") && parse_int(v2, ve2, &id)) {
+                    ev->source_id = (uint32_t)id;
+                }
+                else if (key_is(k2, len2, "type") && parse_int(v2, ve2, &id)) {
+                    ev->source_type = (int)id;
+                }
+            });
+        }
+    });
+    ev->time_ms = tick + tick_offset_;
+    return ok && ev->type >= 0;
+}
+
+bool NetLogReader::run(const Handler& handler) {
+    while (true) {
+        const char* begin = buf_.data() + pos_;
+        const char* end = buf_.data() + len_;
+        const char* p = begin;
+        while (p < end && (is_ws(*p) || *p == ',')) {
+            ++ p;
+        }
+        pos_ = p - buf_.data();
+        if (p < end && *p == ']') {
+            return true;
+        }
+        if (p < end && *p != '{') {
+            // 事件数组中出现了别的东西，后面的内容不再可信
+            truncated_ = true;
+            return true;
+        }
+        const char* event_end = p < end ? skip_value(p, end) : nullptr;
+        if (!event_end) {
+            // 没有 ']' 就到了文件尾：写 NetLog 的进程没有正常停止
+            if (eof_) {
+                truncated_ = true;
+                return true;
+            }
+            if (!fill()) {
+                return false;
+            }
+            continue;
+        }
+        NetLogEvent ev;
+        if (parseEvent(p, event_end, &ev)) {
+            ++ events_;
+            handler(ev);
+        }
+        pos_ = event_end - buf_.data();
+    }
+}
+
+int NetLogReader::eventType(const std::string& name) const {
+    std::map<std::string, int>::const_iterator it = event_types_.find(name);
+    return it == event_types_.end() ? -1 : it->second;
+}
+
+int NetLogReader::sourceType(const std::string& name) const {
+    std::map<std::string, int>::const_iterator it = source_types_.find(name);
+    return it == source_types_.end() ? -1 : it->second;
+}
+
+// scheme://host[:port]/path -> host:port，与 DNS 任务、会话里的 host 写法一致
+static std::string host_of_url(const std::string& url) {
+    size_t scheme = url.find("://");
+    size_t begin = scheme == std::string::npos ? 0 : scheme + 3;
+    size_t end = url.find_first_of("/?#", begin);
+    std::string host = url.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+    if (!host.empty() && host.find(':', host[0] == '[' ? host.find(']') : 0) == std::string::npos) {
+        host += url.compare(0, scheme, "http") == 0 ? ":80" : ":443";
+    }
+    return host;
+}
+
+NetLogAnalyzer::NetLogAnalyzer(const NetLogReader& reader) {
+    ev_request_alive_ = reader.eventType("REQUEST_ALIVE");
+    ev_start_job_ = reader.eventType("URL_REQUEST_START_JOB");
+    ev_bound_ = reader.eventType("SOCKET_POOL_BOUND_TO_SOCKET");
+    ev_resolver_ = reader.eventType("HOST_RESOLVER_MANAGER_JOB");
+    ev_tcp_connect_ = reader.eventType("TCP_CONNECT");
+    ev_tcp_attempt_ = reader.eventType("TCP_CONNECT_ATTEMPT");
+    ev_ssl_ = reader.eventType("SSL_CONNECT");
+    ev_h2_session_ = reader.eventType("HTTP2_SESSION");
+    ev_quic_session_ = reader.eventType("QUIC_SESSION");
+    ev_bound_to_job_ = reader.eventType("HTTP_STREAM_REQUEST_BOUND_TO_JOB");
+    src_url_request_ = reader.sourceType("URL_REQUEST");
+    src_job_ = reader.sourceType("HTTP_STREAM_JOB");
+    src_socket_ = reader.sourceType("SOCKET");
+    src_h2_ = reader.sourceType("HTTP2_SESSION");
+    src_quic_ = reader.sourceType("QUIC_SESSION");
+}
+
+NetLogAnalyzer::Request& NetLogAnalyzer::request(uint32_t id) {
+    std::unordered_map<uint32_t, size_t>::iterator it = request_index_.find(id);
+    if (it != request_index_.end()) {
+        return requests_[it->second];
+    }
+    request_index_[id] = requests_.size();
+    requests_.push_back(Request());
+    requests_.back().id = id;
+    return requests_.back();
+}
+
+void NetLogAnalyzer::bind(uint32_t request_id, uint32_t socket, int64_t time_ms) {
+    Request& r = request(request_id);
+    if (r.bound_ms >= 0 || socket == 0) {
+        return;
+    }
+    r.bound_ms = time_ms;
+    r.socket = socket;
+    Socket& s = sockets_[socket];
+    if (s.first_request == 0) {
+        s.first_request = r.id;
+        if (s.host.empty()) {
+            s.host = host_of_url(r.url);
+        }
+        ++ hosts_[s.host].sockets;
+    }
+    ++ s.requests;
+}
+
+uint32_t NetLogAnalyzer::socketOf(uint32_t id, int type) const {
+    if (type >= 0 && type == src_h2_) {
+        std::unordered_map<uint32_t, uint32_t>::const_iterator it = h2_sockets_.find(id);
+        // 会话开始事件里没有所在连接时把会话本身当作连接
+        return it == h2_sockets_.end() ? id : it->second;
+    }
+    if (type < 0 || type == src_socket_ || type == src_quic_) {
+        return id;
+    }
+    return 0;
+}
+
+bool NetLogAnalyzer::onNewSocket(const Request& r) const {
+    std::unordered_map<uint32_t, Socket>::const_iterator it = sockets_.find(r.socket);
+    return it != sockets_.end() && it->second.first_request == r.id;
+}
+
+void NetLogAnalyzer::add(const NetLogEvent& ev) {
+    const int t = ev.type;
+    if (t < 0) {
+        return;
+    }
+    int64_t net_error = 0;
+    if (t == ev_request_alive_) {
+        Request& r = request(ev.source_id);
+        if (ev.phase == 1) {
+            r.start_ms = ev.time_ms;
+        }
+        else if (ev.phase == 2) {
+            r.end_ms = ev.time_ms;
+            netlog_int_param(ev, "net_error", &r.net_error);
+        }
+    }
+    else if (t == ev_start_job_) {
+        if (ev.phase == 1) {
+            netlog_string_param(ev, "url", &request(ev.source_id).url);
+        }
+    }
+    else if (t == ev_bound_to_job_) {
+        uint32_t job = 0;
+        if (!netlog_dependency(ev, &job)) {
+            return;
+        }
+        std::unordered_map<uint32_t, Job>::iterator it = jobs_.find(job);
+        if (it != jobs_.end()) {
+            bind(ev.source_id, it->second.socket, it->second.bound_ms);
+            jobs_.erase(it);
+        }
+    }
+    else if (ev.source_type >= 0 && ev.source_type == src_job_) {
+        // job 上带来源依赖的事件：SOCKET_POOL_BOUND_TO_SOCKET、HTTP2_SESSION_POOL_FOUND_EXISTING_SESSION 等
+        uint32_t id = 0;
+        int type = -1;
+        if (!netlog_dependency(ev, &id, &type)) {
+            return;
+        }
+        uint32_t socket = socketOf(id, type);
+        Job& job = jobs_[ev.source_id];
+        if (socket != 0 && job.socket == 0) {
+            job.socket = socket;
+            job.bound_ms = ev.time_ms;
+        }
+    }
+    else if (t == ev_bound_ && (src_url_request_ < 0 || ev.source_type == src_url_request_)) {
+        // 旧格式：直接记在 URL_REQUEST 上
+        uint32_t socket = 0;
+        int type = -1;
+        if (netlog_dependency(ev, &socket, &type)) {
+            bind(ev.source_id, socketOf(socket, type), ev.time_ms);
+        }
+    }
+    else if (t == ev_resolver_) {
+        if (ev.phase == 1) {
+            netlog_string_param(ev, "host", &resolves_[ev.source_id].host);
+            resolves_[ev.source_id].begin_ms = ev.time_ms;
+        }
+        else if (ev.phase == 2) {
+            std::unordered_map<uint32_t, Resolve>::iterator it = resolves_.find(ev.source_id);
+            if (it == resolves_.end()) {
+                return;
+            }
+            HostStat& h = hosts_[it->second.host];
+            ++ h.resolves;
+            if (netlog_int_param(ev, "net_error", &net_error) && net_error != 0) {
+                ++ h.resolve_errors;
+            }
+            else if (it->second.begin_ms >= 0) {
+                h.resolve.record((uint64_t)std::max<int64_t>(0, ev.time_ms - it->second.begin_ms) * 1000);
+            }
+            resolves_.erase(it);
+        }
+    }
+    else if (t == ev_tcp_connect_) {
+        Socket& s = sockets_[ev.source_id];
+        if (ev.phase == 1) {
+            s.connect_begin_ms = ev.time_ms;
+        }
+        else if (ev.phase == 2 && s.connect_begin_ms >= 0) {
+            if (netlog_int_param(ev, "net_error", &net_error) && net_error != 0) {
+                s.net_error = net_error;
+                ++ socket_errors_;
+            }
+            else {
+                s.connect_ms = ev.time_ms - s.connect_begin_ms;
+                tcp_connect_.record((uint64_t)std::max<int64_t>(0, s.connect_ms) * 1000);
+            }
+            if (s.attempts > 1) {
+                ++ retried_connects_;
+            }
+        }
+    }
+    else if (t == ev_tcp_attempt_) {
+        if (ev.phase == 1) {
+            ++ sockets_[ev.source_id].attempts;
+        }
+    }
+    else if (t == ev_ssl_) {
+        Socket& s = sockets_[ev.source_id];
+        if (ev.phase == 1) {
+            s.ssl_begin_ms = ev.time_ms;
+        }
+        else if (ev.phase == 2 && s.ssl_begin_ms >= 0) {
+            if (netlog_int_param(ev, "net_error", &net_error) && net_error != 0) {
+                s.net_error = net_error;
+                ++ socket_errors_;
+            }
+            else {
+                s.ssl_ms = ev.time_ms - s.ssl_begin_ms;
+                ssl_.record((uint64_t)std::max<int64_t>(0, s.ssl_ms) * 1000);
+            }
+        }
+    }
+    else if (t == ev_h2_session_) {
+        std::string host;
+        if (ev.phase == 1 && netlog_string_param(ev, "host", &host)) {
+            ++ hosts_[host].h2_sessions;
+        }
+        uint32_t socket = 0;
+        if (ev.phase == 1 && netlog_dependency(ev, &socket)) {
+            h2_sockets_[ev.source_id] = socket;
+        }
+    }
+    else if (t == ev_quic_session_) {
+        if (ev.phase == 1) {
+            Socket& s = sockets_[ev.source_id];
+            s.quic = true;
+            netlog_string_param(ev, "host", &s.host);
+            ++ hosts_[s.host].quic_sessions;
+        }
+    }
+}
+
+void NetLogAnalyzer::report(std::ostream& os) const {
+    std::ios::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << std::fixed << std::setprecision(1);
+
+    uint64_t failed = 0, unbound = 0, quic_sockets = 0;
+    LatencyHistogram wait_new, wait_reused;
+    for (size_t i = 0; i < requests_.size(); ++ i) {
+        const Request& r = requests_[i];
+        if (r.net_error != 0) {
+            ++ failed;
+        }
+        if (r.bound_ms < 0 || r.start_ms < 0) {
+            ++ unbound;
+            continue;
+        }
+        uint64_t wait_us = (uint64_t)std::max<int64_t>(0, r.bound_ms - r.start_ms) * 1000;
+        (onNewSocket(r) ? wait_new : wait_reused).record(wait_us);
+    }
+    uint64_t used_sockets = 0, requests_on_sockets = 0;
+    for (std::unordered_map<uint32_t, Socket>::const_iterator it = sockets_.begin(); it != sockets_.end(); ++ it) {
+        quic_sockets += it->second.quic;
+        if (it->second.requests) {
+            ++ used_sockets;
+            requests_on_sockets += it->second.requests;
+        }
+    }
+
+    os << "==== netlog ====" << std::endl;
+    os << "requests: " << requests_.size() << " failed=" << failed << " without socket=" << unbound << std::endl;
+    os << "sockets: " << sockets_.size() - quic_sockets << " tcp, " << quic_sockets << " quic, "
+       << (used_sockets ? (double)requests_on_sockets / used_sockets : 0.0) << " requests/socket" << std::endl;
+    os << "connect errors: " << socket_errors_ << ", sockets with more than one connect attempt: " << retried_connects_
+       << std::endl;
+    print_percentiles(os, "tcp connect", tcp_connect_.snapshot());
+    print_percentiles(os, "ssl", ssl_.snapshot());
+    // 请求开始到拿到连接：新建连接含 DNS/连接/TLS，复用连接为在池中等空闲连接的时间
+    print_percentiles(os, "socket wait (new)", wait_new.snapshot());
+    print_percentiles(os, "socket wait (reused)", wait_reused.snapshot());
+    for (std::map<std::string, HostStat>::const_iterator it = hosts_.begin(); it != hosts_.end(); ++ it) {
+        const HostStat& h = it->second;
+        os << "host " << (it->first.empty() ? "-" : it->first) << ": resolves=" << h.resolves
+           << " errors=" << h.resolve_errors << " sockets=" << h.sockets << " h2_sessions=" << h.h2_sessions
+           << " quic_sessions=" << h.quic_sessions << std::endl;
+        if (h.resolves > h.resolve_errors) {
+            print_percentiles(os, "  dns", h.resolve.snapshot());
+        }
+    }
+    os.flags(flags);
+    os.precision(precision);
+}
+
+void NetLogAnalyzer::join(const RecordLogReader& records, std::ostream& os) const {
+    const uint64_t n = records.count();
+    const int64_t* start = records.column<int64_t>(COL_REQUEST_START);
+    const uint8_t* reused = records.column<uint8_t>(COL_REUSED);
+    const int32_t* dns = records.column<int32_t>(COL_DNS);
+    const int32_t* connect = records.column<int32_t>(COL_CONNECT);
+    const int32_t* total = records.column<int32_t>(COL_TOTAL);
+    const uint32_t* url_hash = records.column<uint32_t>(COL_URL_HASH);
+
+    // 记录按开始时间索引，配上的删掉，避免一条记录配给两个请求
+    std::multimap<int64_t, uint64_t> by_start;
+    for (uint64_t i = 0; i < n; ++ i) {
+        by_start.insert(std::make_pair(start[i], i));
+    }
+
+    uint64_t matched = 0, retried = 0;
+    LatencyHistogram queue_new, queue_reused, retried_total;
+    uint64_t queued_new = 0;
+    for (size_t i = 0; i < requests_.size(); ++ i) {
+        const Request& r = requests_[i];
+        if (r.start_ms < 0) {
+            continue;
+        }
+        bool fresh = r.bound_ms >= 0 && onNewSocket(r);
+        bool want_reused = r.bound_ms >= 0 && !fresh;
+        // 同一毫秒开始的请求常有好几个，URL 不同的不配；记录或 NetLog 没有 URL 时不比较
+        uint32_t want_url = record_url_hash(r.url);
+        // 两边的毫秒取整可能差 1
+        std::multimap<int64_t, uint64_t>::iterator best = by_start.end();
+        for (std::multimap<int64_t, uint64_t>::iterator it = by_start.lower_bound(r.start_ms - 1);
+             it != by_start.end() && it->first <= r.start_ms + 1; ++ it) {
+            if ((reused[it->second] != 0) != want_reused) {
+                continue;
+            }
+            if (want_url != 0 && url_hash[it->second] != 0 && url_hash[it->second] != want_url) {
+                continue;
+            }
+            if (best == by_start.end() || llabs(it->first - r.start_ms) < llabs(best->first - r.start_ms)) {
+                best = it;
+            }
+        }
+        if (best == by_start.end()) {
+            continue;
+        }
+        uint64_t row = best->second;
+        by_start.erase(best);
+        ++ matched;
+        if (r.bound_ms < 0) {
+            continue;
+        }
+        int64_t wait = r.bound_ms - r.start_ms;
+        if (fresh) {
+            // 拿到新连接前除去 DNS 与建连（Cronet 的 connect 含 TLS）的部分，是排队等连接槽位的时间
+            int64_t queue = wait - std::max(0, dns[row]) - std::max(0, connect[row]);
+            queue = std::max<int64_t>(0, queue);
+            queued_new += queue > 0;
+            queue_new.record((uint64_t)queue * 1000);
+            std::unordered_map<uint32_t, Socket>::const_iterator s = sockets_.find(r.socket);
+            if (s != sockets_.end() && s->second.attempts > 1) {
+                ++ retried;
+                if (total[row] >= 0) {
+                    retried_total.record((uint64_t)total[row] * 1000);
+                }
+            }
+        }
+        else {
+            queue_reused.record((uint64_t)std::max<int64_t>(0, wait) * 1000);
+        }
+    }
+
+    os << "==== netlog x records ====" << std::endl;
+    os << "records: " << n << " netlog requests: " << requests_.size() << " matched: " << matched << std::endl;
+    os << "new-socket requests that queued for a socket slot: " << queued_new << std::endl;
+    print_percentiles(os, "pool queue (new socket)", queue_new.snapshot());
+    print_percentiles(os, "pool wait (reused socket)", queue_reused.snapshot());
+    os << "requests on sockets with more than one connect attempt: " << retried << std::endl;
+    if (retried) {
+        print_percentiles(os, "  total", retried_total.snapshot());
+    }
+}
@@ -0,0 +1,59 @@
+// 离线解析 cronet_conn_stat --netlog 写出的 NetLog（也可以是 Chrome/Cronet 导出的文件），
+// 汇总 DNS、建连、TLS 与请求等连接的时间；给出 --records 时与逐请求记录对齐。
+// 流式读取，不把整个 JSON 载入内存，几百 MB 的文件也可以处理
+//
+// usage: cronet_netlog_parser <netlog.json> [--records DIR]
+
+#include "netlog.h"
+#include "record_log.h"
+#include <string.h>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <netlog.json> [--records DIR]" << std::endl;
+        return 1;
+    }
+    std::string path = argv[1];
+    std::string records_dir;
+    for (int i = 2; i < argc; ++ i) {
+        if (strcmp(argv[i], "--records") == 0 && i + 1 < argc) {
+            records_dir = argv[++ i];
+        }
+    }
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    NetLogReader reader;
+    std::string error;
+    if (!reader.open(path, &error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    NetLogAnalyzer analyzer(reader);
+    if (!reader.run([&analyzer](const NetLogEvent& ev) { analyzer.add(ev); })) {
+        std::cerr << "cannot read " << path << std::endl;
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    double mb = reader.bytesRead() / (1024.0 * 1024.0);
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "parsed " << mb << " MB, " << reader.events() << " events in " << seconds * 1000 << " ms ("
+              << (seconds > 0 ? mb / seconds : 0.0) << " MB/s)" << std::endl;
+    if (reader.truncated()) {
+        std::cout << "warning: " << path << " is truncated, events after the last complete one are ignored"
+                  << std::endl;
+    }
+    analyzer.report(std::cout);
+
+    if (!records_dir.empty()) {
+        RecordLogReader records;
+        if (!records.open(records_dir)) {
+            return 1;
+        }
+        analyzer.join(records, std::cout);
+    }
+    return 0;
+}
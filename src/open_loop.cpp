@@ -0,0 +1,111 @@
+#include "open_loop.h"
+#include <string.h>
+#include <iomanip>
+#include <random>
+
+// 剩余时间小于该值后不再 sleep，改为让出 CPU 自旋
+static const std::chrono::microseconds kSpinThreshold(200);
+
+OpenLoopScheduler::OpenLoopScheduler(double rate, Arrival arrival, uint32_t seed)
+    : rate_(rate > 0 ? rate : 1), arrival_(arrival), seed_(seed) {
+}
+
+OpenLoopScheduler::~OpenLoopScheduler() {
+    join();
+}
+
+bool OpenLoopScheduler::parseArrival(const char* name, Arrival* out) {
+    if (strcmp(name, "fixed") == 0) {
+        *out = ARRIVAL_FIXED;
+        return true;
+    }
+    if (strcmp(name, "poisson") == 0) {
+        *out = ARRIVAL_POISSON;
+        return true;
+    }
+    return false;
+}
+
+void OpenLoopScheduler::start(size_t total, StartFunc fn) {
+    join();
+    started_ = 0;
+    thread_ = std::thread([this, total, fn]() { run(total, fn); });
+}
+
+void OpenLoopScheduler::replay(const std::vector<double>& offsets_s, StartFunc fn) {
+    join();
+    started_ = 0;
+    replay_ = true;
+    // 报告里的目标速率取录制的平均速率
+    if (offsets_s.size() > 1 && offsets_s.back() > offsets_s.front()) {
+        rate_ = (offsets_s.size() - 1) / (offsets_s.back() - offsets_s.front());
+    }
+    thread_ = std::thread([this, offsets_s, fn]() mutable {
+        first_ = Clock::now();
+        for (size_t i = 0; i < offsets_s.size(); ++ i) {
+            schedule(i, offsets_s[i], fn);
+        }
+    });
+}
+
+void OpenLoopScheduler::join() {
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void OpenLoopScheduler::waitUntil(Clock::time_point t) {
+    Clock::time_point now = Clock::now();
+    if (t - now > kSpinThreshold) {
+        std::this_thread::sleep_until(t - kSpinThreshold);
+    }
+    while (Clock::now() < t) {
+        std::this_thread::yield();
+    }
+}
+
+void OpenLoopScheduler::run(size_t total, StartFunc fn) {
+    std::mt19937_64 rng(seed_);
+    std::exponential_distribution<double> gap(rate_);
+    // 以 double 秒累加预定时间，避免逐个间隔取整累积误差
+    double offset_s = 0;
+    first_ = Clock::now();
+    for (size_t i = 0; i < total; ++ i) {
+        schedule(i, offset_s, fn);
+        offset_s += arrival_ == ARRIVAL_POISSON ? gap(rng) : 1.0 / rate_;
+    }
+}
+
+void OpenLoopScheduler::schedule(size_t i, double offset_s, StartFunc& fn) {
+    Clock::time_point intended = first_ + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(offset_s));
+    waitUntil(intended);
+    Clock::time_point now = Clock::now();
+    lag_.record(std::chrono::duration_cast<std::chrono::microseconds>(now - intended).count());
+    // 落后于计划时不跳过，立即补发，落后的时间由调用方按预定时间计入延迟
+    fn(i, intended);
+    last_ = Clock::now();
+    started_.fetch_add(1);
+}
+
+double OpenLoopScheduler::achievedRate() const {
+    size_t n = started_.load();
+    if (n < 2) {
+        return 0;
+    }
+    double span = std::chrono::duration<double>(last_ - first_).count();
+    // n 个请求之间有 n - 1 个间隔
+    return span > 0 ? (n - 1) / span : 0;
+}
+
+void OpenLoopScheduler::report(std::ostream& os) const {
+    std::ios::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << std::fixed << std::setprecision(2);
+    os << "open loop: target=" << rate_ << " req/s ("
+       << (replay_ ? "replay" : arrival_ == ARRIVAL_POISSON ? "poisson" : "fixed")
+       << ") achieved=" << achievedRate() << " req/s started=" << started() << std::endl;
+    os.flags(flags);
+    os.precision(precision);
+    print_percentiles(os, "schedule lag", lag_.snapshot());
+}
@@ -0,0 +1,68 @@
+#ifndef CRONET_CONN_STAT_OPEN_LOOP_H
+#define CRONET_CONN_STAT_OPEN_LOOP_H
+
+#include "histogram.h"
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+// 开环发压：按目标速率在预定时间点发起请求，不等前一个请求完成。
+// 调用方应以预定时间（而不是实际 Start 的时间）为起点计算延迟，
+// 这样发压线程被拖慢或引擎排队时，等待时间也会反映在分位数里
+class OpenLoopScheduler {
+public:
+    typedef std::chrono::steady_clock Clock;
+    enum Arrival {
+        ARRIVAL_FIXED,      // 等间隔
+        ARRIVAL_POISSON,    // 指数分布的间隔
+    };
+    // i 为第几个请求，intended 为它的预定发起时间
+    typedef std::function<void(size_t i, Clock::time_point intended)> StartFunc;
+
+    OpenLoopScheduler(double rate, Arrival arrival, uint32_t seed);
+    ~OpenLoopScheduler();
+
+    // 在独立的定时线程上发起 total 个请求
+    void start(size_t total, StartFunc fn);
+    // 同样在定时线程上，按给定的相对时间（秒，非递减）发起，用于回放录制的流量
+    void replay(const std::vector<double>& offsets_s, StartFunc fn);
+    // 等待全部请求发起
+    void join();
+
+    double targetRate() const { return rate_; }
+    // 实际发起速率：发起数 / (最后一次实际发起 - 第一个预定时间)
+    double achievedRate() const;
+    size_t started() const { return started_.load(); }
+    // 实际发起时间相对预定时间的滞后（微秒）
+    const LatencyHistogram& lag() const { return lag_; }
+
+    void report(std::ostream& os) const;
+
+    static bool parseArrival(const char* name, Arrival* out);
+
+private:
+    OpenLoopScheduler(const OpenLoopScheduler&);
+    OpenLoopScheduler& operator=(const OpenLoopScheduler&);
+
+    void run(size_t total, StartFunc fn);
+    // 第 i 个请求相对开始的预定时间
+    void schedule(size_t i, double offset_s, StartFunc& fn);
+    // sleep 到接近目标时间，最后一小段自旋，避免 sleep 粒度带来的抖动
+    static void waitUntil(Clock::time_point t);
+
+    double rate_;
+    const Arrival arrival_;
+    bool replay_ = false;
+    const uint32_t seed_;
+    std::thread thread_;
+    std::atomic<size_t> started_{0};
+    Clock::time_point first_;
+    Clock::time_point last_;
+    LatencyHistogram lag_;
+};
+
+#endif // CRONET_CONN_STAT_OPEN_LOOP_H
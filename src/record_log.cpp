@@ -0,0 +1,247 @@
+#include "record_log.h"
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <limits>
+#include <fstream>
+#include <iostream>
+#ifdef _WIN32
+#include <direct.h>
+#define make_dir(p) _mkdir(p)
+#else
+#include <sys/stat.h>
+#define make_dir(p) mkdir(p, 0755)
+#endif
+
+const RecordColumnDesc kRecordColumns[COL_COUNT] = {
+    {"request_start_ms", 8, false},
+    {"dns_ms", 4, false},
+    {"connect_ms", 4, false},
+    {"ssl_ms", 4, false},
+    {"send_ms", 4, false},
+    {"ttfb_ms", 4, false},
+    {"total_ms", 4, false},
+    {"sent_bytes", 8, false},
+    {"received_bytes", 8, false},
+    {"http_status", 2, false},
+    {"finished_reason", 1, false},
+    {"protocol", 1, false},
+    {"socket_reused", 1, false},
+    {"attempt", 1, true},
+    {"url_hash", 4, true},
+};
+
+static const uint64_t kInitialRows = 1 << 16;
+static const size_t kQueueRows = 1 << 16;
+
+static int32_t clamp_ms(int64_t v) {
+    return v > std::numeric_limits<int32_t>::max() ? std::numeric_limits<int32_t>::max() : (int32_t)v;
+}
+
+void make_record_row(const RequestMetrics& m, RecordRow* row) {
+    memset(row, 0, sizeof(*row));
+    row->request_start_ms = m.request_start_ms;
+    row->phase_ms[COL_DNS - COL_DNS] = clamp_ms(phase_ms(m.dns_start_ms, m.dns_end_ms));
+    row->phase_ms[COL_CONNECT - COL_DNS] = clamp_ms(phase_ms(m.connect_start_ms, m.connect_end_ms));
+    row->phase_ms[COL_SSL - COL_DNS] = clamp_ms(phase_ms(m.ssl_start_ms, m.ssl_end_ms));
+    row->phase_ms[COL_SEND - COL_DNS] = clamp_ms(phase_ms(m.sending_start_ms, m.sending_end_ms));
+    row->phase_ms[COL_TTFB - COL_DNS] = clamp_ms(phase_ms(m.request_start_ms, m.response_start_ms));
+    row->phase_ms[COL_TOTAL - COL_DNS] = clamp_ms(phase_ms(m.request_start_ms, m.request_end_ms));
+    row->sent_bytes = m.sent_bytes;
+    row->received_bytes = m.received_bytes;
+    row->http_status = (int16_t)m.http_status;
+    row->reason = (uint8_t)m.finished_reason;
+    row->reused = m.socket_reused ? 1 : 0;
+    row->attempt = (uint8_t)(m.attempt < 255 ? m.attempt : 255);
+    row->url_hash = record_url_hash(m.url);
+    strncpy(row->protocol, m.protocol.c_str(), sizeof(row->protocol) - 1);
+}
+
+uint32_t record_url_hash(const std::string& url) {
+    if (url.empty()) {
+        return 0;
+    }
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < url.size(); ++ i) {
+        h ^= (uint8_t)url[i];
+        h *= 16777619u;
+    }
+    return h ? h : 1;
+}
+
+static const void* row_field(const RecordRow& row, int col) {
+    switch (col) {
+    case COL_REQUEST_START: return &row.request_start_ms;
+    case COL_SENT_BYTES: return &row.sent_bytes;
+    case COL_RECEIVED_BYTES: return &row.received_bytes;
+    case COL_STATUS: return &row.http_status;
+    case COL_REASON: return &row.reason;
+    case COL_REUSED: return &row.reused;
+    case COL_ATTEMPT: return &row.attempt;
+    case COL_URL_HASH: return &row.url_hash;
+    default: return &row.phase_ms[col - COL_DNS];
+    }
+}
+
+RecordLog::RecordLog() : queue_(kQueueRows) {
+}
+
+RecordLog::~RecordLog() {
+    close();
+}
+
+bool RecordLog::open(const std::string& dir) {
+    dir_ = dir;
+    make_dir(dir.c_str());
+    capacity_ = kInitialRows;
+    count_ = 0;
+    for (int c = 0; c < COL_COUNT; ++ c) {
+        std::string path = dir + "/" + kRecordColumns[c].name + ".col";
+        // 每次运行重新开始，不与旧文件混在一起
+        remove(path.c_str());
+        uint64_t bytes = sizeof(RecordColumnHeader) + capacity_ * kRecordColumns[c].elem_size;
+        if (!columns_[c].openWrite(path, bytes)) {
+            std::cerr << "record log: cannot map " << path << std::endl;
+            return false;
+        }
+        RecordColumnHeader* h = (RecordColumnHeader*)columns_[c].data();
+        memset(h, 0, sizeof(*h));
+        memcpy(h->magic, "CCSCOL01", 8);
+        h->elem_size = kRecordColumns[c].elem_size;
+        h->column = (uint32_t)c;
+        strncpy(h->name, kRecordColumns[c].name, sizeof(h->name) - 1);
+    }
+    stop_ = false;
+    thread_ = std::thread([this]() { run(); });
+    return true;
+}
+
+void RecordLog::append(const RequestMetrics& m) {
+    RecordRow row;
+    make_record_row(m, &row);
+    if (!queue_.tryPush(row)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+uint8_t RecordLog::protocolId(const char* name) {
+    std::string key(name, strnlen(name, sizeof(RecordRow().protocol)));
+    auto it = protocols_.find(key);
+    if (it != protocols_.end()) {
+        return it->second;
+    }
+    uint8_t id = (uint8_t)protocols_.size();
+    protocols_[key] = id;
+    std::ofstream ofs((dir_ + "/protocols.txt").c_str(), std::ios::trunc);
+    for (auto p = protocols_.begin(); p != protocols_.end(); ++ p) {
+        ofs << (int)p->second << " " << p->first << "\n";
+    }
+    return id;
+}
+
+bool RecordLog::ensureCapacity(uint64_t rows) {
+    if (rows <= capacity_) {
+        return true;
+    }
+    uint64_t cap = capacity_;
+    while (cap < rows) {
+        cap *= 2;
+    }
+    for (int c = 0; c < COL_COUNT; ++ c) {
+        if (!columns_[c].resize(sizeof(RecordColumnHeader) + cap * kRecordColumns[c].elem_size)) {
+            std::cerr << "record log: grow column " << kRecordColumns[c].name << " failed" << std::endl;
+            return false;
+        }
+    }
+    capacity_ = cap;
+    return true;
+}
+
+void RecordLog::commit() {
+    for (int c = 0; c < COL_COUNT; ++ c) {
+        RecordColumnHeader* h = (RecordColumnHeader*)columns_[c].data();
+        h->count = count_;
+    }
+}
+
+size_t RecordLog::drain() {
+    size_t n = 0;
+    RecordRow row;
+    while (queue_.tryPop(row)) {
+        if (!ensureCapacity(count_ + 1)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        uint8_t proto = protocolId(row.protocol);
+        for (int c = 0; c < COL_COUNT; ++ c) {
+            uint32_t sz = kRecordColumns[c].elem_size;
+            char* dst = columns_[c].data() + sizeof(RecordColumnHeader) + count_ * sz;
+            memcpy(dst, c == COL_PROTOCOL ? (const void*)&proto : row_field(row, c), sz);
+        }
+        ++ count_;
+        ++ n;
+    }
+    if (n) {
+        commit();
+        written_.fetch_add(n, std::memory_order_relaxed);
+    }
+    return n;
+}
+
+void RecordLog::run() {
+    while (!stop_) {
+        if (drain() == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+    drain();
+}
+
+void RecordLog::close() {
+    if (!thread_.joinable()) {
+        return;
+    }
+    stop_ = true;
+    thread_.join();
+    for (int c = 0; c < COL_COUNT; ++ c) {
+        columns_[c].close(sizeof(RecordColumnHeader) + count_ * kRecordColumns[c].elem_size);
+    }
+}
+
+bool RecordLogReader::open(const std::string& dir) {
+    count_ = std::numeric_limits<uint64_t>::max();
+    for (int c = 0; c < COL_COUNT; ++ c) {
+        std::string path = dir + "/" + kRecordColumns[c].name + ".col";
+        if (kRecordColumns[c].optional && !std::ifstream(path.c_str()).good()) {
+            continue;
+        }
+        if (!files_[c].openRead(path) || files_[c].size() < sizeof(RecordColumnHeader)) {
+            std::cerr << "cannot open column " << path << std::endl;
+            return false;
+        }
+        const RecordColumnHeader* h = (const RecordColumnHeader*)files_[c].data();
+        if (memcmp(h->magic, "CCSCOL01", 8) != 0 || h->elem_size != kRecordColumns[c].elem_size) {
+            std::cerr << "bad column header " << path << std::endl;
+            return false;
+        }
+        uint64_t fit = (files_[c].size() - sizeof(RecordColumnHeader)) / h->elem_size;
+        uint64_t n = h->count < fit ? h->count : fit;
+        if (n < count_) {
+            count_ = n;
+        }
+    }
+    zeros_.assign(count_, 0);
+
+    std::ifstream ifs((dir + "/protocols.txt").c_str());
+    int id;
+    std::string name;
+    while (ifs >> id >> name) {
+        if (id >= 0 && id < 256) {
+            if ((size_t)id >= protocols_.size()) {
+                protocols_.resize(id + 1);
+            }
+            protocols_[id] = name;
+        }
+    }
+    return true;
+}
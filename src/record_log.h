@@ -0,0 +1,127 @@
+#ifndef CRONET_CONN_STAT_RECORD_LOG_H
+#define CRONET_CONN_STAT_RECORD_LOG_H
+
+#include "mapped_file.h"
+#include "mpmc_queue.h"
+#include "request_metrics.h"
+#include <stdint.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 列式请求记录：目录下每列一个文件 <name>.col，文件头 64 字节，后面是定长元素数组。
+// 阶段耗时单位为毫秒，-1 表示该阶段未发生；protocol 列存 id，id -> 名称见 protocols.txt
+enum RecordColumn {
+    COL_REQUEST_START = 0,  // int64 ms since epoch
+    COL_DNS,                // int32 ms
+    COL_CONNECT,
+    COL_SSL,
+    COL_SEND,
+    COL_TTFB,
+    COL_TOTAL,
+    COL_SENT_BYTES,         // int64
+    COL_RECEIVED_BYTES,     // int64
+    COL_STATUS,             // int16 http status
+    COL_REASON,             // uint8 finished reason
+    COL_PROTOCOL,           // uint8 protocol id
+    COL_REUSED,             // uint8
+    COL_ATTEMPT,            // uint8 第几次尝试，0 为首次
+    COL_URL_HASH,           // uint32 最终 URL 的哈希（record_url_hash），0 为未知
+    COL_COUNT
+};
+
+struct RecordColumnDesc {
+    const char* name;
+    uint32_t elem_size;
+    bool optional;          // 后来加的列，旧的记录目录里没有，读取时按全 0 处理
+};
+
+extern const RecordColumnDesc kRecordColumns[COL_COUNT];
+
+struct RecordColumnHeader {
+    char magic[8];          // "CCSCOL01"
+    uint32_t elem_size;
+    uint32_t column;
+    uint64_t count;         // 已提交的元素个数，写线程每批追加后更新
+    char name[40];
+};
+
+// 一行记录，在回调线程上从 RequestMetrics 生成后入队
+struct RecordRow {
+    int64_t request_start_ms;
+    int32_t phase_ms[COL_TOTAL - COL_DNS + 1];
+    int64_t sent_bytes;
+    int64_t received_bytes;
+    int16_t http_status;
+    uint8_t reason;
+    uint8_t reused;
+    uint8_t attempt;
+    uint32_t url_hash;
+    char protocol[14];
+};
+
+void make_record_row(const RequestMetrics& m, RecordRow* row);
+// URL 的 32 位 FNV-1a，空 URL 为 0，不会为 0 的 URL 映射到 1；用来与 NetLog 中的请求对齐
+uint32_t record_url_hash(const std::string& url);
+
+// 追加写：append() 只把定长行放进无锁队列，满了就丢弃并计数；
+// 后台线程批量取出写入各列的 mmap 区域
+class RecordLog {
+public:
+    RecordLog();
+    ~RecordLog();
+
+    bool open(const std::string& dir);
+    void append(const RequestMetrics& m);
+    void close();
+
+    uint64_t written() const { return written_.load(); }
+    uint64_t dropped() const { return dropped_.load(); }
+
+private:
+    RecordLog(const RecordLog&);
+    RecordLog& operator=(const RecordLog&);
+
+    void run();
+    size_t drain();
+    bool ensureCapacity(uint64_t rows);
+    uint8_t protocolId(const char* name);
+    void commit();
+
+    std::string dir_;
+    MpmcQueue<RecordRow> queue_;
+    MappedFile columns_[COL_COUNT];
+    uint64_t capacity_ = 0;     // 每列当前可容纳的行数
+    uint64_t count_ = 0;
+    std::map<std::string, uint8_t> protocols_;
+    std::thread thread_;
+    std::atomic<bool> stop_{false};
+    std::atomic<uint64_t> written_{0};
+    std::atomic<uint64_t> dropped_{0};
+};
+
+// 只读打开一个记录目录，各列以 mmap 方式直接访问
+class RecordLogReader {
+public:
+    bool open(const std::string& dir);
+    uint64_t count() const { return count_; }
+    template <typename T>
+    const T* column(RecordColumn col) const {
+        if (!files_[col].isOpen()) {
+            return (const T*)zeros_.data();
+        }
+        return (const T*)(files_[col].data() + sizeof(RecordColumnHeader));
+    }
+    const std::vector<std::string>& protocols() const { return protocols_; }
+
+private:
+    MappedFile files_[COL_COUNT];
+    uint64_t count_ = 0;
+    std::vector<std::string> protocols_;
+    std::vector<uint64_t> zeros_;   // 缺少的可选列，count_ 个全 0 元素
+};
+
+#endif // CRONET_CONN_STAT_RECORD_LOG_H
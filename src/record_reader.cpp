@@ -0,0 +1,129 @@
+// 读取 cronet_conn_stat --record-log 生成的列式记录，计算汇总统计。
+// 各列直接 mmap，只扫描需要的列，百万级记录可在秒级完成
+//
+// usage: cronet_record_reader <dir> [--protocol NAME] [--reused 0|1]
+
+#include "histogram.h"
+#include "record_log.h"
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <dir> [--protocol NAME] [--reused 0|1]" << std::endl;
+        return 1;
+    }
+    std::string dir = argv[1];
+    std::string protocol;
+    int reused_filter = -1;
+    for (int i = 2; i < argc; ++ i) {
+        if (strcmp(argv[i], "--protocol") == 0 && i + 1 < argc) {
+            protocol = argv[++ i];
+        }
+        else if (strcmp(argv[i], "--reused") == 0 && i + 1 < argc) {
+            reused_filter = atoi(argv[++ i]);
+        }
+    }
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    RecordLogReader reader;
+    if (!reader.open(dir)) {
+        return 1;
+    }
+    const uint64_t n = reader.count();
+    const std::vector<std::string>& protocols = reader.protocols();
+
+    int protocol_id = -1;
+    if (!protocol.empty()) {
+        for (size_t i = 0; i < protocols.size(); ++ i) {
+            if (protocols[i] == protocol) {
+                protocol_id = (int)i;
+            }
+        }
+        if (protocol_id < 0) {
+            std::cerr << "protocol " << protocol << " not found in " << dir << std::endl;
+            return 1;
+        }
+    }
+
+    const int64_t* start = reader.column<int64_t>(COL_REQUEST_START);
+    const int64_t* sent = reader.column<int64_t>(COL_SENT_BYTES);
+    const int64_t* received = reader.column<int64_t>(COL_RECEIVED_BYTES);
+    const int16_t* status = reader.column<int16_t>(COL_STATUS);
+    const uint8_t* reason = reader.column<uint8_t>(COL_REASON);
+    const uint8_t* proto = reader.column<uint8_t>(COL_PROTOCOL);
+    const uint8_t* reused = reader.column<uint8_t>(COL_REUSED);
+    const uint8_t* attempt = reader.column<uint8_t>(COL_ATTEMPT);
+    const int32_t* phases[COL_TOTAL - COL_DNS + 1];
+    for (int c = COL_DNS; c <= COL_TOTAL; ++ c) {
+        phases[c - COL_DNS] = reader.column<int32_t>((RecordColumn)c);
+    }
+
+    LatencyHistogram phase_hist[COL_TOTAL - COL_DNS + 1];
+    std::vector<uint64_t> per_protocol(256, 0);
+    uint64_t matched = 0, reasons[3] = {0, 0, 0}, status_class[6] = {0, 0, 0, 0, 0, 0};
+    uint64_t reused_count = 0, retry_count = 0, sent_total = 0, received_total = 0;
+    int64_t first = 0, last = 0;
+
+    for (uint64_t i = 0; i < n; ++ i) {
+        if (protocol_id >= 0 && proto[i] != protocol_id) {
+            continue;
+        }
+        if (reused_filter >= 0 && reused[i] != reused_filter) {
+            continue;
+        }
+        ++ matched;
+        if (reason[i] < 3) {
+            ++ reasons[reason[i]];
+        }
+        int sc = status[i] / 100;
+        ++ status_class[(sc >= 1 && sc <= 5) ? sc : 0];
+        reused_count += reused[i];
+        retry_count += attempt[i] > 0 ? 1 : 0;
+        ++ per_protocol[proto[i]];
+        if (sent[i] > 0) sent_total += sent[i];
+        if (received[i] > 0) received_total += received[i];
+        if (start[i] > 0) {
+            if (first == 0 || start[i] < first) first = start[i];
+            if (start[i] > last) last = start[i];
+        }
+        for (int c = 0; c <= COL_TOTAL - COL_DNS; ++ c) {
+            int32_t v = phases[c][i];
+            if (v >= 0) {
+                phase_hist[c].record((uint64_t)v * 1000);
+            }
+        }
+    }
+    double scan_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "records: " << n << " matched: " << matched << " (scan " << scan_ms << " ms)" << std::endl;
+    if (matched == 0) {
+        return 0;
+    }
+    double span_s = (last - first) / 1000.0;
+    std::cout << "span: " << span_s << " s";
+    if (span_s > 0) {
+        std::cout << " rate: " << matched / span_s << " req/s";
+    }
+    std::cout << std::endl;
+    std::cout << "succeeded=" << reasons[0] << " failed=" << reasons[1] << " canceled=" << reasons[2] << std::endl;
+    std::cout << "status: 1xx=" << status_class[1] << " 2xx=" << status_class[2] << " 3xx=" << status_class[3]
+              << " 4xx=" << status_class[4] << " 5xx=" << status_class[5] << " none=" << status_class[0] << std::endl;
+    std::cout << "socket reused: " << 100.0 * reused_count / matched << "%" << std::endl;
+    std::cout << "retry attempts: " << retry_count << " (" << 100.0 * retry_count / matched << "%)" << std::endl;
+    std::cout << "bytes: sent=" << sent_total << " received=" << received_total << std::endl;
+    for (size_t p = 0; p < protocols.size(); ++ p) {
+        if (per_protocol[p]) {
+            std::cout << "protocol " << protocols[p] << ": " << per_protocol[p] << std::endl;
+        }
+    }
+    for (int c = COL_DNS; c <= COL_TOTAL; ++ c) {
+        print_percentiles(std::cout, kRecordColumns[c].name, phase_hist[c - COL_DNS].snapshot());
+    }
+    return 0;
+}
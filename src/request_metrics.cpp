@@ -0,0 +1,70 @@
+#include "request_metrics.h"
+
+static int64_t date_ms(Cronet_DateTimePtr dt) {
+    return dt ? Cronet_DateTime_value_get(dt) : 0;
+}
+
+std::string url_host(const std::string& url) {
+    size_t begin = url.find("://");
+    begin = (begin == std::string::npos) ? 0 : begin + 3;
+    size_t end = url.find_first_of("/?#", begin);
+    std::string host = url.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+    size_t at = host.rfind('@');
+    if (at != std::string::npos) {
+        host = host.substr(at + 1);
+    }
+    return host;
+}
+
+void extract_request_metrics(Cronet_RequestFinishedInfoPtr request_info,
+                             Cronet_UrlResponseInfoPtr response_info,
+                             Cronet_ErrorPtr error,
+                             RequestMetrics* out) {
+    *out = RequestMetrics();
+    if (error) {
+        out->error_code = Cronet_Error_error_code_get(error);
+    }
+    if (request_info) {
+        out->finished_reason = Cronet_RequestFinishedInfo_finished_reason_get(request_info);
+        Cronet_MetricsPtr metrics = Cronet_RequestFinishedInfo_metrics_get(request_info);
+        if (metrics) {
+            out->has_metrics = true;
+            out->request_start_ms = date_ms(Cronet_Metrics_request_start_get(metrics));
+            out->dns_start_ms = date_ms(Cronet_Metrics_dns_start_get(metrics));
+            out->dns_end_ms = date_ms(Cronet_Metrics_dns_end_get(metrics));
+            out->connect_start_ms = date_ms(Cronet_Metrics_connect_start_get(metrics));
+            out->connect_end_ms = date_ms(Cronet_Metrics_connect_end_get(metrics));
+            out->ssl_start_ms = date_ms(Cronet_Metrics_ssl_start_get(metrics));
+            out->ssl_end_ms = date_ms(Cronet_Metrics_ssl_end_get(metrics));
+            out->sending_start_ms = date_ms(Cronet_Metrics_sending_start_get(metrics));
+            out->sending_end_ms = date_ms(Cronet_Metrics_sending_end_get(metrics));
+            out->response_start_ms = date_ms(Cronet_Metrics_response_start_get(metrics));
+            out->request_end_ms = date_ms(Cronet_Metrics_request_end_get(metrics));
+            out->socket_reused = Cronet_Metrics_socket_reused_get(metrics);
+            out->sent_bytes = Cronet_Metrics_sent_byte_count_get(metrics);
+            out->received_bytes = Cronet_Metrics_received_byte_count_get(metrics);
+        }
+    }
+
+    if (response_info) {
+        out->http_status = Cronet_UrlResponseInfo_http_status_code_get(response_info);
+        Cronet_String url = Cronet_UrlResponseInfo_url_get(response_info);
+        if (url) {
+            out->url = url;
+            out->host = url_host(out->url);
+        }
+        Cronet_String proto = Cronet_UrlResponseInfo_negotiated_protocol_get(response_info);
+        if (proto) {
+            out->protocol = proto;
+        }
+        Cronet_String proxy = Cronet_UrlResponseInfo_proxy_server_get(response_info);
+        if (proxy) {
+            out->proxy = proxy;
+        }
+        out->wire_received_bytes = Cronet_UrlResponseInfo_received_byte_count_get(response_info);
+        out->was_cached = Cronet_UrlResponseInfo_was_cached_get(response_info);
+    }
+    if (out->protocol.empty()) {
+        out->protocol = "unknown";
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef CRONET_CONN_STAT_REQUEST_METRICS_H
+#define CRONET_CONN_STAT_REQUEST_METRICS_H
+
+#include <cronet/cronet_c.h>
+#include <stdint.h>
+#include <string>
+
+// 从 Cronet_RequestFinishedInfo / Cronet_UrlResponseInfo 中抽取出的一次请求的指标，
+// 时间戳均为 Cronet_DateTime 的毫秒值，0 表示该阶段未发生
+struct RequestMetrics {
+    bool has_metrics = false;
+    int64_t request_start_ms = 0;
+    int64_t dns_start_ms = 0;
+    int64_t dns_end_ms = 0;
+    int64_t connect_start_ms = 0;
+    int64_t connect_end_ms = 0;
+    int64_t ssl_start_ms = 0;
+    int64_t ssl_end_ms = 0;
+    int64_t sending_start_ms = 0;
+    int64_t sending_end_ms = 0;
+    int64_t response_start_ms = 0;
+    int64_t request_end_ms = 0;
+    bool socket_reused = false;
+    bool was_cached = false;        // 响应来自 HTTP 缓存，没有网络阶段
+    int64_t sent_bytes = 0;
+    int64_t received_bytes = 0;
+    int64_t wire_received_bytes = -1;   // UrlResponseInfo.received_byte_count，含头部与压缩后的 body
+    int64_t body_bytes = -1;            // 应用在 on_read_completed 中实际读到的字节数，由调用方填写
+    int attempt = 0;                    // 第几次尝试，0 为首次，重试的每次尝试各是一个请求，由调用方填写
+    int64_t duration_us = -1;           // 客户端测得的 Start 到结束（微秒），上面的时间戳只到毫秒，由调用方填写
+
+    int finished_reason = Cronet_RequestFinishedInfo_FINISHED_REASON_SUCCEEDED;
+    int error_code = -1;            // Cronet_Error_ERROR_CODE，无错误时为 -1
+    int32_t http_status = 0;
+    std::string url;
+    std::string host;
+    std::string protocol;
+    std::string proxy;              // 经过的代理，直连为空
+};
+
+// 阶段耗时（毫秒），任一端缺失时返回 -1
+inline int64_t phase_ms(int64_t start_ms, int64_t end_ms) {
+    return (start_ms > 0 && end_ms >= start_ms) ? (end_ms - start_ms) : -1;
+}
+
+// "scheme://host:port/path" -> "host:port"
+std::string url_host(const std::string& url);
+
+void extract_request_metrics(Cronet_RequestFinishedInfoPtr request_info,
+                             Cronet_UrlResponseInfoPtr response_info,
+                             Cronet_ErrorPtr error,
+                             RequestMetrics* out);
+
+#endif // CRONET_CONN_STAT_REQUEST_METRICS_H
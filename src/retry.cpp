@@ -0,0 +1,112 @@
+#include "retry.h"
+
+bool retriable_error(Cronet_ErrorPtr error) {
+    if (!error) {
+        return false;
+    }
+    if (Cronet_Error_immediately_retryable_get(error)) {
+        return true;
+    }
+    switch (Cronet_Error_error_code_get(error)) {
+    case Cronet_Error_ERROR_CODE_ERROR_NETWORK_CHANGED:
+    case Cronet_Error_ERROR_CODE_ERROR_TIMED_OUT:
+    case Cronet_Error_ERROR_CODE_ERROR_CONNECTION_CLOSED:
+    case Cronet_Error_ERROR_CODE_ERROR_CONNECTION_TIMED_OUT:
+    case Cronet_Error_ERROR_CODE_ERROR_CONNECTION_REFUSED:
+    case Cronet_Error_ERROR_CODE_ERROR_CONNECTION_RESET:
+    case Cronet_Error_ERROR_CODE_ERROR_ADDRESS_UNREACHABLE:
+    case Cronet_Error_ERROR_CODE_ERROR_QUIC_PROTOCOL_FAILED:
+        return true;
+    default:
+        return false;
+    }
+}
+
+size_t mark_idempotent(Workload* workload) {
+    static const char* kIdempotent[] = {"GET", "HEAD", "OPTIONS", "PUT", "DELETE"};
+    size_t marked = 0;
+    for (size_t i = 0; i < workload->endpoints.size(); ++ i) {
+        Endpoint& ep = workload->endpoints[i];
+        if (ep.idempotency != 0) {
+            continue;
+        }
+        for (size_t m = 0; m < sizeof(kIdempotent) / sizeof(kIdempotent[0]); ++ m) {
+            if (ep.method == kIdempotent[m]) {
+                ep.idempotency = 1;
+                ++ marked;
+                break;
+            }
+        }
+    }
+    return marked;
+}
+
+RetryController::RetryController(const RetryPolicy& policy) : policy_(policy), rng_(std::random_device()()) {
+    for (int c = 0; c <= Cronet_Error_ERROR_CODE_ERROR_OTHER; ++ c) {
+        by_error_[c] = 0;
+    }
+}
+
+void RetryController::countError(int error_code) {
+    if (error_code >= 0 && error_code <= Cronet_Error_ERROR_CODE_ERROR_OTHER) {
+        by_error_[error_code].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void RetryController::onNotRetriable(int error_code) {
+    countError(error_code);
+    not_retriable_.fetch_add(1, std::memory_order_relaxed);
+}
+
+int64_t RetryController::acquire(int attempt, int error_code) {
+    countError(error_code);
+    if (attempt >= policy_.max_retries) {
+        exhausted_.fetch_add(1, std::memory_order_relaxed);
+        return -1;
+    }
+    uint64_t allowed = (uint64_t)(requests_.load(std::memory_order_relaxed) * policy_.budget) + kBurst;
+    uint64_t retries = retries_.load(std::memory_order_relaxed);
+    do {
+        if (retries >= allowed) {
+            over_budget_.fetch_add(1, std::memory_order_relaxed);
+            return -1;
+        }
+    } while (!retries_.compare_exchange_weak(retries, retries + 1, std::memory_order_relaxed));
+
+    // full jitter：在 [0, min(max, base * 2^attempt)] 中均匀取，避免同时失败的请求同时重试
+    uint64_t cap = policy_.base_backoff_us;
+    for (int n = 0; n < attempt && cap < policy_.max_backoff_us; ++ n) {
+        cap *= 2;
+    }
+    if (cap > policy_.max_backoff_us) {
+        cap = policy_.max_backoff_us;
+    }
+    uint64_t backoff;
+    {
+        std::lock_guard<std::mutex> lock(rng_mutex_);
+        backoff = std::uniform_int_distribution<uint64_t>(0, cap)(rng_);
+    }
+    backoff_.record(backoff);
+    return (int64_t)backoff;
+}
+
+void RetryController::report(std::ostream& os) const {
+    static const char* kErrors[] = {"callback", "name_not_resolved", "internet_disconnected", "network_changed",
+                                    "timed_out", "connection_closed", "connection_timed_out", "connection_refused",
+                                    "connection_reset", "address_unreachable", "quic_protocol_failed", "other"};
+    uint64_t requests = requests_.load();
+    uint64_t retries = retries_.load();
+    os << "retry: max_retries=" << policy_.max_retries << " budget=" << policy_.budget * 100 << "%, requests="
+       << requests << " retries=" << retries << " (" << (requests ? 100.0 * retries / requests : 0)
+       << "%) recovered=" << recovered_.load() << " gave_up=" << gave_up_.load() << " exhausted=" << exhausted_.load()
+       << " over_budget=" << over_budget_.load() << " not_retriable=" << not_retriable_.load() << std::endl;
+    os << "  failed attempts by error:";
+    for (int c = 0; c <= Cronet_Error_ERROR_CODE_ERROR_OTHER; ++ c) {
+        uint64_t n = by_error_[c].load();
+        if (n) {
+            os << " " << kErrors[c] << "=" << n;
+        }
+    }
+    os << std::endl;
+    print_percentiles(os, "  retry backoff", backoff_.snapshot());
+}
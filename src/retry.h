@@ -0,0 +1,79 @@
+#ifndef CRONET_CONN_STAT_RETRY_H
+#define CRONET_CONN_STAT_RETRY_H
+
+#include "histogram.h"
+#include "timer_thread.h"
+#include "workload.h"
+#include <cronet/cronet_c.h>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <ostream>
+#include <random>
+
+// 失败重试：可重试的错误按带抖动的指数退避在定时线程上安排下一次尝试，全局预算限制重试总量
+struct RetryPolicy {
+    int max_retries = 0;                // 每个请求最多重试几次，0 为关闭
+    uint64_t base_backoff_us = 10000;   // 第 n 次重试的退避上限为 base * 2^(n-1)，实际在 [0, 上限] 中均匀抽取
+    uint64_t max_backoff_us = 1000000;
+    double budget = 0.1;                // 重试数不超过已发起请求数的这个比例
+
+    bool enabled() const { return max_retries > 0; }
+};
+
+// 连接被重置、超时、网络切换等可重试的错误；DNS 失败、断网与回调错误重试也没用
+bool retriable_error(Cronet_ErrorPtr error);
+
+// 没有显式声明幂等性的幂等方法（GET/HEAD/OPTIONS/PUT/DELETE）标记为幂等，返回标记的端点数。
+// PUT/DELETE 幂等但不安全，需要安全方法的地方不能用这个集合。
+// 需在构建请求参数前调用，Cronet_UrlRequestParams_idempotency_set 随之生效
+size_t mark_idempotent(Workload* workload);
+// 只重试幂等的请求
+inline bool retry_eligible(const Endpoint& ep) { return ep.idempotency == 1; }
+
+// 重试的预算、退避与统计，各方法可在任意线程上调用
+class RetryController {
+public:
+    explicit RetryController(const RetryPolicy& policy);
+
+    const RetryPolicy& policy() const { return policy_; }
+    TimerThread& timer() { return timer_; }
+
+    // 发起了一个可重试的请求（首次尝试）
+    void onRequest() { requests_.fetch_add(1, std::memory_order_relaxed); }
+    // 第 attempt 次尝试（0 为首次）以可重试的错误失败：还有次数且预算允许时计数，
+    // 返回下一次尝试前的退避（微秒），不重试时返回 -1
+    int64_t acquire(int attempt, int error_code);
+    // 失败但错误不可重试
+    void onNotRetriable(int error_code);
+    // 重试过的请求最终成功 / 用完次数或预算后仍失败
+    void onRecovered() { recovered_.fetch_add(1, std::memory_order_relaxed); }
+    void onGaveUp() { gave_up_.fetch_add(1, std::memory_order_relaxed); }
+
+    void report(std::ostream& os) const;
+
+private:
+    RetryController(const RetryController&);
+    RetryController& operator=(const RetryController&);
+
+    // 允许少量重试的突发，请求数很少时也能重试
+    static const uint64_t kBurst = 10;
+
+    void countError(int error_code);
+
+    const RetryPolicy policy_;
+    TimerThread timer_;
+    std::mutex rng_mutex_;
+    std::mt19937 rng_;
+    LatencyHistogram backoff_;
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> retries_{0};
+    std::atomic<uint64_t> exhausted_{0};        // 用完重试次数
+    std::atomic<uint64_t> over_budget_{0};
+    std::atomic<uint64_t> not_retriable_{0};
+    std::atomic<uint64_t> recovered_{0};
+    std::atomic<uint64_t> gave_up_{0};
+    std::atomic<uint64_t> by_error_[Cronet_Error_ERROR_CODE_ERROR_OTHER + 1];
+};
+
+#endif // CRONET_CONN_STAT_RETRY_H
@@ -0,0 +1,2227 @@
+// Linux 下用于基准测试的 Cronet 替身库，实现 cronet_conn_stat 用到的 C API 子集。
+// 每个 Cronet_Engine 有一个模拟网络线程（定时器队列），DNS / 连接 / TLS / 首包 / 读
+// 各阶段的延迟可通过环境变量 CRONET_SHIM_CONFIG 配置，例如:
+//   CRONET_SHIM_CONFIG="dns_ms=2,connect_ms=5,ssl_ms=8,ttfb_ms=20,jitter=0.2,body_bytes=2048"
+// 支持的 key 见 ShimConfig。URL 路由模仿 httpbin: /get /json /bytes/N /delay/N /redirect/N /status/N，
+// 另有 /cache/N 返回 Cache-Control: max-age=N，开启 HTTP 缓存时可被缓存
+// 双向流（bidirectional_stream_c.h）把写入的数据原样回显，用于 gRPC 式的流式压测
+
+#include <cronet/bidirectional_stream_c.h>
+#include <cronet/cronet_c.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct ShimConfig {
+    double dns_ms = 1;
+    double connect_ms = 2;
+    double ssl_ms = 4;
+    double send_ms = 0.1;
+    double ttfb_ms = 5;
+    double read_ms = 0.05;          // 每次 Read 的耗时
+    double jitter = 0.1;            // 各阶段叠加 指数分布(均值 = 阶段耗时 * jitter)
+    int64_t body_bytes = 512;       // 未指定路由时的响应体大小
+    int max_sockets_per_host = 6;   // HTTP/1.1 每 host 的连接上限
+    double idle_timeout_ms = 30000; // 空闲连接保持时间
+    double fail_rate = 0;           // 随机失败比例
+    double slow_rate = 0;           // 以这个比例在首包前额外停顿 slow_ms，模拟长尾的慢请求
+    double slow_ms = 0;
+    int64_t header_bytes = 220;     // 模拟的响应头大小
+    double cache_memory_ms = 0.05;  // 内存缓存命中时到首包的耗时
+    double cache_disk_ms = 0.5;     // 磁盘缓存命中时到首包的耗时
+};
+
+ShimConfig load_config() {
+    ShimConfig cfg;
+    const char* env = getenv("CRONET_SHIM_CONFIG");
+    if (!env) {
+        return cfg;
+    }
+    std::stringstream ss(env);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) {
+            continue;
+        }
+        std::string k = item.substr(0, eq);
+        double v = atof(item.c_str() + eq + 1);
+        if (k == "dns_ms") cfg.dns_ms = v;
+        else if (k == "connect_ms") cfg.connect_ms = v;
+        else if (k == "ssl_ms") cfg.ssl_ms = v;
+        else if (k == "send_ms") cfg.send_ms = v;
+        else if (k == "ttfb_ms") cfg.ttfb_ms = v;
+        else if (k == "read_ms") cfg.read_ms = v;
+        else if (k == "jitter") cfg.jitter = v;
+        else if (k == "body_bytes") cfg.body_bytes = (int64_t)v;
+        else if (k == "max_sockets_per_host") cfg.max_sockets_per_host = (int)v;
+        else if (k == "idle_timeout_ms") cfg.idle_timeout_ms = v;
+        else if (k == "fail_rate") cfg.fail_rate = v;
+        else if (k == "slow_rate") cfg.slow_rate = v;
+        else if (k == "slow_ms") cfg.slow_ms = v;
+        else if (k == "header_bytes") cfg.header_bytes = (int64_t)v;
+        else if (k == "cache_memory_ms") cfg.cache_memory_ms = v;
+        else if (k == "cache_disk_ms") cfg.cache_disk_ms = v;
+    }
+    return cfg;
+}
+
+typedef std::chrono::steady_clock Clock;
+
+int64_t wall_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// 模拟网络线程：按到期时间执行任务
+class NetworkThread {
+public:
+    NetworkThread() : thread_([this]() { run(); }) {}
+
+    ~NetworkThread() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cond_.notify_all();
+        thread_.join();
+    }
+
+    void post(std::function<void()> fn) { postDelayed(0, std::move(fn)); }
+
+    void postDelayed(double delay_ms, std::function<void()> fn) {
+        Clock::time_point due = Clock::now() +
+            std::chrono::microseconds((int64_t)(delay_ms * 1000));
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            timers_.push(Timer{due, seq_++, std::move(fn)});
+        }
+        cond_.notify_one();
+    }
+
+    bool onThread() const { return std::this_thread::get_id() == thread_.get_id(); }
+
+private:
+    struct Timer {
+        Clock::time_point due;
+        uint64_t seq;
+        std::function<void()> fn;
+        bool operator<(const Timer& o) const {
+            return due != o.due ? due > o.due : seq > o.seq;
+        }
+    };
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            if (timers_.empty()) {
+                if (stop_) {
+                    return;
+                }
+                cond_.wait(lock);
+                continue;
+            }
+            Clock::time_point due = timers_.top().due;
+            if (!stop_ && due > Clock::now()) {
+                cond_.wait_until(lock, due);
+                continue;
+            }
+            if (stop_) {
+                return;
+            }
+            std::function<void()> fn = std::move(const_cast<Timer&>(timers_.top()).fn);
+            timers_.pop();
+            lock.unlock();
+            fn();
+            lock.lock();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::priority_queue<Timer> timers_;
+    uint64_t seq_ = 0;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+struct RequestState;
+
+struct IdleSocket {
+    Clock::time_point last_used;
+    uint32_t log_id;                        // NetLog 中的 SOCKET 来源
+};
+
+struct HostPool {
+    int sockets = 0;                        // 已建立或正在建立的连接数
+    std::vector<IdleSocket> idle;
+    std::deque<std::shared_ptr<RequestState>> waiters;
+    std::vector<std::function<void()>> stream_waiters;     // 等会话建好的双向流
+    Clock::time_point send_free;            // 会话上一个包写完的时刻，双向流的包在会话上串行发出
+    bool session_ready = false;             // h2/h3 会话已建立
+    bool session_connecting = false;
+    uint32_t session_log_id = 0;            // 会话所在的 SOCKET（h2）或 QUIC_SESSION 来源
+    uint32_t h2_session_log_id = 0;         // h2 会话的 HTTP2_SESSION 来源
+};
+
+std::string json_escape(const std::string& s) {
+    std::string out;
+    out.reserve(s.size());
+    for (size_t i = 0; i < s.size(); ++ i) {
+        unsigned char c = (unsigned char)s[i];
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+            out.push_back((char)c);
+        }
+        else if (c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        }
+        else {
+            out.push_back((char)c);
+        }
+    }
+    return out;
+}
+
+// Chrome NetLog JSON 格式的一个子集：常量表只列出这里用到的事件与来源类型，每个事件一行。
+// 时间为毫秒 tick，加上 constants.timeTickOffset 即为墙钟时间
+class NetLogWriter {
+public:
+    enum EventType {
+        EV_REQUEST_ALIVE,
+        EV_URL_REQUEST_START_JOB,
+        EV_SOCKET_POOL_BOUND_TO_SOCKET,
+        EV_HOST_RESOLVER_MANAGER_JOB,
+        EV_TCP_CONNECT,
+        EV_TCP_CONNECT_ATTEMPT,
+        EV_SSL_CONNECT,
+        EV_HTTP2_SESSION,
+        EV_QUIC_SESSION,
+        EV_HTTP_STREAM_JOB,
+        EV_HTTP_STREAM_REQUEST_BOUND_TO_JOB,
+        EV_HTTP2_SESSION_POOL_FOUND_EXISTING_SESSION,
+        EV_HTTP_STREAM_JOB_BOUND_TO_QUIC_SESSION,
+        kEventTypeCount
+    };
+    enum SourceType {
+        SRC_URL_REQUEST,
+        SRC_HOST_RESOLVER_IMPL_JOB,
+        SRC_SOCKET,
+        SRC_HTTP2_SESSION,
+        SRC_QUIC_SESSION,
+        SRC_HTTP_STREAM_JOB,
+        kSourceTypeCount
+    };
+    enum Phase { PHASE_NONE = 0, PHASE_BEGIN = 1, PHASE_END = 2 };
+
+    bool open(const std::string& path) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (file_) {
+            return false;
+        }
+        file_ = fopen(path.c_str(), "w");
+        if (!file_) {
+            return false;
+        }
+        static const char* kEvents[kEventTypeCount] = {
+            "REQUEST_ALIVE", "URL_REQUEST_START_JOB", "SOCKET_POOL_BOUND_TO_SOCKET", "HOST_RESOLVER_MANAGER_JOB",
+            "TCP_CONNECT", "TCP_CONNECT_ATTEMPT", "SSL_CONNECT", "HTTP2_SESSION", "QUIC_SESSION", "HTTP_STREAM_JOB",
+            "HTTP_STREAM_REQUEST_BOUND_TO_JOB", "HTTP2_SESSION_POOL_FOUND_EXISTING_SESSION",
+            "HTTP_STREAM_JOB_BOUND_TO_QUIC_SESSION",
+        };
+        static const char* kSources[kSourceTypeCount] = {
+            "URL_REQUEST", "HOST_RESOLVER_IMPL_JOB", "SOCKET", "HTTP2_SESSION", "QUIC_SESSION", "HTTP_STREAM_JOB",
+        };
+        // tick 从 0 开始，与墙钟相差 offset_
+        offset_ = wall_ms() - 1;
+        fprintf(file_, "{\"constants\":{\"logEventTypes\":{");
+        for (int i = 0; i < kEventTypeCount; ++ i) {
+            fprintf(file_, "%s\"%s\":%d", i ? "," : "", kEvents[i], i);
+        }
+        fprintf(file_, "},\"logSourceType\":{");
+        for (int i = 0; i < kSourceTypeCount; ++ i) {
+            fprintf(file_, "%s\"%s\":%d", i ? "," : "", kSources[i], i);
+        }
+        fprintf(file_, "},\"logEventPhase\":{\"PHASE_BEGIN\":1,\"PHASE_END\":2,\"PHASE_NONE\":0},"
+                       "\"timeTickOffset\":\"%lld\",\"clientInfo\":{\"name\":\"cronet-shim\"}},\n\"events\": [\n",
+                (long long)offset_);
+        first_ = true;
+        enabled_ = true;
+        return true;
+    }
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        enabled_ = false;
+        if (file_) {
+            fprintf(file_, "\n],\n\"polledData\": {}}\n");
+            fclose(file_);
+            file_ = nullptr;
+        }
+    }
+    uint32_t newSource() { return next_id_.fetch_add(1) + 1; }
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // params 为 JSON 对象文本，可为空
+    void add(EventType type, SourceType source, uint32_t id, Phase phase, int64_t wall, const std::string& params) {
+        if (!enabled() || id == 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!file_) {
+            return;
+        }
+        fprintf(file_, "%s{\"phase\":%d,\"source\":{\"id\":%u,\"type\":%d},\"time\":\"%lld\",\"type\":%d",
+                first_ ? "" : ",\n", (int)phase, id, (int)source, (long long)(wall - offset_), (int)type);
+        if (!params.empty()) {
+            fprintf(file_, ",\"params\":%s", params.c_str());
+        }
+        fputc('}', file_);
+        first_ = false;
+    }
+
+private:
+    std::mutex mutex_;
+    FILE* file_ = nullptr;
+    std::atomic<bool> enabled_{false};
+    std::atomic<uint32_t> next_id_{0};
+    int64_t offset_ = 0;
+    bool first_ = true;
+};
+
+std::string source_dependency(uint32_t id, NetLogWriter::SourceType type) {
+    return "{\"source_dependency\":{\"id\":" + std::to_string(id) + ",\"type\":" + std::to_string((int)type) + "}}";
+}
+
+// 模拟 HTTP 缓存：按 URL 保存带 max-age 的 200 响应，总大小超过容量时按 LRU 淘汰。
+// 磁盘模式在引擎关闭时把索引写到 storage_path 下，下一个用同一目录的引擎启动时读回
+struct ResponseCache {
+    struct Entry {
+        int64_t body_bytes = 0;
+        bool text = false;
+        std::string protocol;
+        int64_t expires_ms = 0;     // wall_ms
+        std::list<std::string>::iterator lru;
+    };
+
+    int64_t capacity = 0;
+    int64_t used = 0;
+    std::map<std::string, Entry> entries;
+    std::list<std::string> lru;     // 最近使用的在前
+
+    const Entry* lookup(const std::string& url, int64_t now_ms) {
+        auto it = entries.find(url);
+        if (it == entries.end()) {
+            return nullptr;
+        }
+        if (it->second.expires_ms <= now_ms) {
+            erase(it);
+            return nullptr;
+        }
+        lru.splice(lru.begin(), lru, it->second.lru);
+        return &it->second;
+    }
+    void store(const std::string& url, const Entry& e) {
+        auto old = entries.find(url);
+        if (old != entries.end()) {
+            erase(old);
+        }
+        if (e.body_bytes > capacity) {
+            return;
+        }
+        while (used + e.body_bytes > capacity && !lru.empty()) {
+            erase(entries.find(lru.back()));
+        }
+        lru.push_front(url);
+        Entry& stored = entries[url];
+        stored = e;
+        stored.lru = lru.begin();
+        used += e.body_bytes;
+    }
+    void erase(std::map<std::string, Entry>::iterator it) {
+        used -= it->second.body_bytes;
+        lru.erase(it->second.lru);
+        entries.erase(it);
+    }
+
+    // 每行：expires_ms body_bytes text protocol url，按 LRU 从旧到新
+    void load(const std::string& path) {
+        FILE* f = fopen(path.c_str(), "r");
+        if (!f) {
+            return;
+        }
+        char protocol[32];
+        char url[4096];
+        long long expires_ms = 0, body_bytes = 0;
+        int text = 0;
+        while (fscanf(f, "%lld %lld %d %31s %4095s", &expires_ms, &body_bytes, &text, protocol, url) == 5) {
+            Entry e;
+            e.expires_ms = expires_ms;
+            e.body_bytes = body_bytes;
+            e.text = text != 0;
+            e.protocol = protocol;
+            store(url, e);
+        }
+        fclose(f);
+    }
+    void save(const std::string& path) const {
+        FILE* f = fopen(path.c_str(), "w");
+        if (!f) {
+            return;
+        }
+        for (auto it = lru.rbegin(); it != lru.rend(); ++ it) {
+            const Entry& e = entries.find(*it)->second;
+            fprintf(f, "%lld %lld %d %s %s\n", (long long)e.expires_ms, (long long)e.body_bytes, e.text ? 1 : 0,
+                    e.protocol.c_str(), it->c_str());
+        }
+        fclose(f);
+    }
+};
+
+} // namespace
+
+struct Cronet_Runnable {
+    Cronet_Runnable_RunFunc run = nullptr;
+    Cronet_ClientContext ctx = nullptr;
+    std::function<void()> task;
+};
+
+struct Cronet_Executor {
+    Cronet_Executor_ExecuteFunc execute = nullptr;
+    Cronet_ClientContext ctx = nullptr;
+};
+
+struct Cronet_BufferCallback {
+    Cronet_BufferCallback_OnDestroyFunc on_destroy = nullptr;
+    Cronet_ClientContext ctx = nullptr;
+};
+
+struct Cronet_Buffer {
+    Cronet_ClientContext ctx = nullptr;
+    void* data = nullptr;
+    uint64_t size = 0;
+    bool owned = false;
+    Cronet_BufferCallbackPtr callback = nullptr;
+};
+
+struct Cronet_HttpHeader {
+    std::string name;
+    std::string value;
+};
+
+struct Cronet_DateTime {
+    int64_t value = 0;
+};
+
+struct Cronet_Error {
+    Cronet_Error_ERROR_CODE error_code = Cronet_Error_ERROR_CODE_ERROR_CALLBACK;
+    std::string message;
+    int32_t internal_error_code = 0;
+    bool immediately_retryable = false;
+    int32_t quic_detailed_error_code = 0;
+};
+
+struct Cronet_QuicHint {
+    std::string host;
+    int32_t port = 0;
+    int32_t alternate_port = 0;
+};
+
+struct Cronet_EngineParams {
+    bool enable_check_result = true;
+    std::string user_agent;
+    std::string accept_language;
+    std::string storage_path;
+    bool enable_quic = true;
+    bool enable_http2 = true;
+    bool enable_brotli = true;
+    Cronet_EngineParams_HTTP_CACHE_MODE http_cache_mode = Cronet_EngineParams_HTTP_CACHE_MODE_DISABLED;
+    int64_t http_cache_max_size = 0;
+    std::vector<Cronet_QuicHint> quic_hints;
+    double network_thread_priority = 0;
+    std::string experimental_options;
+};
+
+struct Cronet_UrlResponseInfo {
+    std::string url;
+    std::vector<std::string> url_chain;
+    int32_t http_status_code = 0;
+    std::string http_status_text;
+    std::vector<Cronet_HttpHeader> headers;
+    bool was_cached = false;
+    std::string negotiated_protocol;
+    std::string proxy_server;
+    int64_t received_byte_count = 0;
+};
+
+struct Cronet_UrlRequestParams {
+    std::string http_method = "GET";
+    std::vector<Cronet_HttpHeader> request_headers;
+    bool disable_cache = false;
+    bool disable_proxy = false;
+    Cronet_UrlRequestParams_REQUEST_PRIORITY priority =
+        Cronet_UrlRequestParams_REQUEST_PRIORITY_REQUEST_PRIORITY_MEDIUM;
+    Cronet_UploadDataProviderPtr upload_data_provider = nullptr;
+    Cronet_ExecutorPtr upload_data_provider_executor = nullptr;
+    bool allow_direct_executor = false;
+    std::vector<Cronet_RawDataPtr> annotations;
+    Cronet_RequestFinishedInfoListenerPtr request_finished_listener = nullptr;
+    Cronet_ExecutorPtr request_finished_executor = nullptr;
+    Cronet_UrlRequestParams_IDEMPOTENCY idempotency =
+        Cronet_UrlRequestParams_IDEMPOTENCY_DEFAULT_IDEMPOTENCY;
+};
+
+struct Cronet_Metrics {
+    Cronet_DateTime request_start, dns_start, dns_end, connect_start, connect_end;
+    Cronet_DateTime ssl_start, ssl_end, sending_start, sending_end;
+    Cronet_DateTime push_start, push_end, response_start, request_end;
+    bool socket_reused = false;
+    int64_t sent_byte_count = -1;
+    int64_t received_byte_count = -1;
+};
+
+struct Cronet_RequestFinishedInfo {
+    Cronet_Metrics metrics;
+    bool has_metrics = true;
+    std::vector<Cronet_RawDataPtr> annotations;
+    Cronet_RequestFinishedInfo_FINISHED_REASON finished_reason =
+        Cronet_RequestFinishedInfo_FINISHED_REASON_SUCCEEDED;
+};
+
+struct Cronet_UrlRequestCallback {
+    Cronet_ClientContext ctx = nullptr;
+    Cronet_UrlRequestCallback_OnRedirectReceivedFunc on_redirect = nullptr;
+    Cronet_UrlRequestCallback_OnResponseStartedFunc on_response_started = nullptr;
+    Cronet_UrlRequestCallback_OnReadCompletedFunc on_read_completed = nullptr;
+    Cronet_UrlRequestCallback_OnSucceededFunc on_succeeded = nullptr;
+    Cronet_UrlRequestCallback_OnFailedFunc on_failed = nullptr;
+    Cronet_UrlRequestCallback_OnCanceledFunc on_canceled = nullptr;
+};
+
+struct Cronet_RequestFinishedInfoListener {
+    Cronet_ClientContext ctx = nullptr;
+    Cronet_RequestFinishedInfoListener_OnRequestFinishedFunc on_finished = nullptr;
+};
+
+struct Cronet_UrlRequestStatusListener {
+    Cronet_ClientContext ctx = nullptr;
+    Cronet_UrlRequestStatusListener_OnStatusFunc on_status = nullptr;
+};
+
+struct Cronet_Engine {
+    Cronet_ClientContext ctx = nullptr;
+    Cronet_EngineParams params;
+    ShimConfig cfg;
+    bool started = false;
+    std::unique_ptr<NetworkThread> net;
+    std::mt19937_64 rng;
+
+    std::mutex listener_mutex;
+    std::map<Cronet_RequestFinishedInfoListenerPtr, Cronet_ExecutorPtr> listeners;
+
+    // 以下只在网络线程上访问
+    std::map<std::string, HostPool> pools;
+    std::map<std::string, bool> resolved;   // DNS 缓存
+    ResponseCache cache;
+
+    NetLogWriter netlog;
+    stream_engine stream_api;               // Cronet_Engine_GetStreamEngine 返回，obj 指回引擎
+
+    double jitter(double ms) {
+        if (ms <= 0) {
+            return 0;
+        }
+        if (cfg.jitter <= 0) {
+            return ms;
+        }
+        std::exponential_distribution<double> d(1.0 / (ms * cfg.jitter));
+        return ms + d(rng);
+    }
+
+    bool roll(double p) {
+        if (p <= 0) {
+            return false;
+        }
+        std::uniform_real_distribution<double> d(0, 1);
+        return d(rng) < p;
+    }
+};
+
+namespace {
+
+enum RequestPhase {
+    PHASE_IDLE,
+    PHASE_STARTED,
+    PHASE_WAITING_REDIRECT,
+    PHASE_RESPONSE,
+    PHASE_READING,
+    PHASE_DONE,
+};
+
+struct ParsedUrl {
+    std::string scheme;
+    std::string host;       // host:port
+    std::string path;
+};
+
+ParsedUrl parse_url(const std::string& url) {
+    ParsedUrl u;
+    size_t p = url.find("://");
+    size_t begin = 0;
+    if (p != std::string::npos) {
+        u.scheme = url.substr(0, p);
+        begin = p + 3;
+    }
+    size_t slash = url.find('/', begin);
+    u.host = url.substr(begin, slash == std::string::npos ? std::string::npos : slash - begin);
+    u.path = slash == std::string::npos ? "/" : url.substr(slash);
+    if (u.host.find(':') == std::string::npos) {
+        u.host += (u.scheme == "https") ? ":443" : ":80";
+    }
+    return u;
+}
+
+struct Route {
+    int status = 200;
+    int64_t body_bytes = 0;
+    double delay_ms = 0;
+    std::string location;
+    bool text = false;      // 文本响应，按 Content-Encoding 压缩后上线
+    int max_age = 0;        // > 0 时响应带 Cache-Control: max-age，可被缓存
+};
+
+Route route(const ShimConfig& cfg, const ParsedUrl& u) {
+    Route r;
+    r.body_bytes = cfg.body_bytes;
+    std::string path = u.path.substr(0, u.path.find('?'));
+    long n = 0;
+    if (path == "/get") {
+        r.body_bytes = 300;
+        r.text = true;
+    }
+    else if (path == "/json") {
+        r.body_bytes = 429;
+        r.text = true;
+    }
+    else if (sscanf(path.c_str(), "/bytes/%ld", &n) == 1) {
+        r.body_bytes = n;
+    }
+    else if (sscanf(path.c_str(), "/delay/%ld", &n) == 1) {
+        r.body_bytes = 300;
+        r.text = true;
+        r.delay_ms = n * 1000.0;
+    }
+    else if (sscanf(path.c_str(), "/cache/%ld", &n) == 1) {
+        r.body_bytes = 300;
+        r.text = true;
+        r.max_age = (int)n;
+    }
+    else if (sscanf(path.c_str(), "/status/%ld", &n) == 1) {
+        r.status = (int)n;
+        r.body_bytes = 0;
+    }
+    else if (sscanf(path.c_str(), "/redirect/%ld", &n) == 1) {
+        r.status = 302;
+        r.body_bytes = 0;
+        std::ostringstream os;
+        os << u.scheme << "://" << u.host;
+        if (n > 1) {
+            os << "/redirect/" << (n - 1);
+        }
+        else {
+            os << "/get";
+        }
+        r.location = os.str();
+    }
+    return r;
+}
+
+struct RequestState : std::enable_shared_from_this<RequestState> {
+    Cronet_UrlRequestPtr handle = nullptr;
+    Cronet_EnginePtr engine = nullptr;
+    std::string url;
+    Cronet_UrlRequestParams params;
+    Cronet_UrlRequestCallbackPtr callback = nullptr;
+    Cronet_ExecutorPtr executor = nullptr;
+
+    RequestPhase phase = PHASE_IDLE;
+    std::atomic<bool> done{false};
+    std::atomic<bool> failed{false};
+    bool canceled = false;
+    ParsedUrl target;
+    Route rt;
+    int64_t body_left = 0;
+    double wire_ratio = 1;      // 线上字节 / 解压后字节
+    bool from_cache = false;
+    std::string cached_protocol;    // 缓存命中时为写入缓存那次的协议
+    uint32_t log_id = 0;            // NetLog 中的 URL_REQUEST 来源
+    uint32_t socket_log_id = 0;     // 当前持有的连接（或 QUIC 会话）
+    uint32_t job_log_id = 0;        // 正在找连接的 HTTP_STREAM_JOB 来源，绑定后清零
+    bool holds_socket = false;
+
+    std::shared_ptr<Cronet_UrlResponseInfo> response;
+    std::shared_ptr<Cronet_RequestFinishedInfo> finished;
+    std::shared_ptr<Cronet_Error> error;
+};
+
+void post_to_executor(Cronet_ExecutorPtr executor, std::function<void()> fn) {
+    Cronet_RunnablePtr r = new Cronet_Runnable;
+    r->task = std::move(fn);
+    Cronet_Executor_Execute(executor, r);
+}
+
+std::string protocol_for(Cronet_EnginePtr engine, const ParsedUrl& u) {
+    if (u.scheme != "https") {
+        return "http/1.1";
+    }
+    if (engine->params.enable_quic) {
+        for (size_t i = 0; i < engine->params.quic_hints.size(); ++ i) {
+            const Cronet_QuicHint& h = engine->params.quic_hints[i];
+            std::ostringstream os;
+            os << h.host << ":" << h.port;
+            if (os.str() == u.host) {
+                return "h3";
+            }
+        }
+    }
+    return engine->params.enable_http2 ? "h2" : "http/1.1";
+}
+
+// DISK_NO_HTTP 只缓存 HTTP 以外的数据
+bool http_cache_enabled(Cronet_EnginePtr engine) {
+    return engine->params.http_cache_mode == Cronet_EngineParams_HTTP_CACHE_MODE_IN_MEMORY ||
+           engine->params.http_cache_mode == Cronet_EngineParams_HTTP_CACHE_MODE_DISK;
+}
+
+bool cacheable_request(const std::shared_ptr<RequestState>& st) {
+    return http_cache_enabled(st->engine) && st->params.http_method == "GET" && !st->params.disable_cache;
+}
+
+bool multiplexed(const std::string& proto) {
+    return proto == "h2" || proto == "h3";
+}
+
+void finish_request(const std::shared_ptr<RequestState>& st,
+                    Cronet_RequestFinishedInfo_FINISHED_REASON reason);
+void begin_transaction(const std::shared_ptr<RequestState>& st);
+void release_socket(const std::shared_ptr<RequestState>& st);
+
+void fail_request(const std::shared_ptr<RequestState>& st, Cronet_Error_ERROR_CODE code,
+                  const char* message, int internal_code) {
+    if (st->phase == PHASE_DONE) {
+        return;
+    }
+    st->error = std::make_shared<Cronet_Error>();
+    st->error->error_code = code;
+    st->error->message = message;
+    st->error->internal_error_code = internal_code;
+    st->error->immediately_retryable =
+        code == Cronet_Error_ERROR_CODE_ERROR_CONNECTION_RESET ||
+        code == Cronet_Error_ERROR_CODE_ERROR_CONNECTION_CLOSED ||
+        code == Cronet_Error_ERROR_CODE_ERROR_NETWORK_CHANGED;
+    st->failed = true;
+    finish_request(st, Cronet_RequestFinishedInfo_FINISHED_REASON_FAILED);
+}
+
+void finish_request(const std::shared_ptr<RequestState>& st,
+                    Cronet_RequestFinishedInfo_FINISHED_REASON reason) {
+    if (st->phase == PHASE_DONE) {
+        return;
+    }
+    st->phase = PHASE_DONE;
+    release_socket(st);
+    if (reason == Cronet_RequestFinishedInfo_FINISHED_REASON_SUCCEEDED && !st->from_cache && st->rt.max_age > 0 &&
+        st->rt.status == 200 && cacheable_request(st)) {
+        ResponseCache::Entry e;
+        e.body_bytes = st->rt.body_bytes;
+        e.text = st->rt.text;
+        e.protocol = st->response ? st->response->negotiated_protocol : "unknown";
+        e.expires_ms = wall_ms() + st->rt.max_age * INT64_C(1000);
+        st->engine->cache.store(st->url, e);
+    }
+    Cronet_Metrics& m = st->finished->metrics;
+    m.request_end.value = wall_ms();
+    st->finished->finished_reason = reason;
+    NetLogWriter& log = st->engine->netlog;
+    if (log.enabled()) {
+        std::string params;
+        if (st->error) {
+            params = "{\"net_error\":" + std::to_string(st->error->internal_error_code) + "}";
+        }
+        // 没拿到连接就结束的 job（DNS 失败、排队时取消）
+        log.add(NetLogWriter::EV_HTTP_STREAM_JOB, NetLogWriter::SRC_HTTP_STREAM_JOB, st->job_log_id,
+                NetLogWriter::PHASE_END, m.request_end.value, params);
+        st->job_log_id = 0;
+        log.add(NetLogWriter::EV_URL_REQUEST_START_JOB, NetLogWriter::SRC_URL_REQUEST, st->log_id,
+                NetLogWriter::PHASE_END, m.request_end.value, params);
+        log.add(NetLogWriter::EV_REQUEST_ALIVE, NetLogWriter::SRC_URL_REQUEST, st->log_id, NetLogWriter::PHASE_END,
+                m.request_end.value, params);
+    }
+    if (!st->response) {
+        st->response = std::make_shared<Cronet_UrlResponseInfo>();
+        st->response->url = st->url;
+    }
+    m.received_byte_count = st->response->received_byte_count;
+
+    std::shared_ptr<RequestState> self = st;
+    Cronet_UrlResponseInfoPtr info = st->response->http_status_code ? st->response.get() : nullptr;
+    if (reason == Cronet_RequestFinishedInfo_FINISHED_REASON_SUCCEEDED) {
+        post_to_executor(st->executor, [self, info]() {
+            self->done = true;
+            self->callback->on_succeeded(self->callback, self->handle, info);
+        });
+    }
+    else if (reason == Cronet_RequestFinishedInfo_FINISHED_REASON_FAILED) {
+        post_to_executor(st->executor, [self, info]() {
+            self->done = true;
+            self->callback->on_failed(self->callback, self->handle, info, self->error.get());
+        });
+    }
+    else {
+        post_to_executor(st->executor, [self, info]() {
+            self->done = true;
+            self->callback->on_canceled(self->callback, self->handle, info);
+        });
+    }
+
+    // 请求完成后通知 finished listener（引擎级 + 请求级）
+    std::vector<std::pair<Cronet_RequestFinishedInfoListenerPtr, Cronet_ExecutorPtr>> targets;
+    {
+        std::lock_guard<std::mutex> lock(st->engine->listener_mutex);
+        targets.assign(st->engine->listeners.begin(), st->engine->listeners.end());
+    }
+    if (st->params.request_finished_listener && st->params.request_finished_executor) {
+        targets.push_back(std::make_pair(st->params.request_finished_listener,
+                                         st->params.request_finished_executor));
+    }
+    std::shared_ptr<Cronet_RequestFinishedInfo> fi = st->finished;
+    std::shared_ptr<Cronet_UrlResponseInfo> ri = st->response;
+    std::shared_ptr<Cronet_Error> err = st->error;
+    for (size_t i = 0; i < targets.size(); ++ i) {
+        Cronet_RequestFinishedInfoListenerPtr l = targets[i].first;
+        post_to_executor(targets[i].second, [l, fi, ri, err]() {
+            l->on_finished(l, fi.get(), ri.get(), err.get());
+        });
+    }
+}
+
+void release_socket(const std::shared_ptr<RequestState>& st) {
+    if (!st->holds_socket) {
+        return;
+    }
+    st->holds_socket = false;
+    Cronet_EnginePtr engine = st->engine;
+    std::string proto = protocol_for(engine, st->target);
+    if (multiplexed(proto)) {
+        return;
+    }
+    HostPool& pool = engine->pools[st->target.host];
+    if (!pool.waiters.empty()) {
+        std::shared_ptr<RequestState> next = pool.waiters.front();
+        pool.waiters.pop_front();
+        next->holds_socket = true;
+        next->finished->metrics.socket_reused = true;
+        next->socket_log_id = st->socket_log_id;
+        begin_transaction(next);
+        return;
+    }
+    IdleSocket idle;
+    idle.last_used = Clock::now();
+    idle.log_id = st->socket_log_id;
+    pool.idle.push_back(idle);
+}
+
+void start_response(const std::shared_ptr<RequestState>& st) {
+    if (st->phase == PHASE_DONE) {
+        return;
+    }
+    Cronet_EnginePtr engine = st->engine;
+    Cronet_Metrics& m = st->finished->metrics;
+    m.response_start.value = wall_ms();
+
+    std::shared_ptr<Cronet_UrlResponseInfo> info = std::make_shared<Cronet_UrlResponseInfo>();
+    if (st->response) {
+        info->url_chain = st->response->url_chain;
+        info->received_byte_count = st->response->received_byte_count;
+    }
+    info->url = st->url;
+    info->url_chain.push_back(st->url);
+    info->http_status_code = st->rt.status;
+    info->http_status_text = st->rt.status == 200 ? "OK" : (st->rt.status == 302 ? "Found" : "Status");
+    info->was_cached = st->from_cache;
+    info->negotiated_protocol = st->from_cache ? st->cached_protocol : protocol_for(engine, st->target);
+    if (!st->from_cache) {
+        info->received_byte_count += engine->cfg.header_bytes;
+    }
+    Cronet_HttpHeader h;
+    h.name = "Content-Length";
+    h.value = std::to_string(st->rt.body_bytes);
+    info->headers.push_back(h);
+    if (!st->rt.location.empty()) {
+        h.name = "Location";
+        h.value = st->rt.location;
+        info->headers.push_back(h);
+    }
+    if (st->rt.max_age > 0) {
+        h.name = "Cache-Control";
+        h.value = "public, max-age=" + std::to_string(st->rt.max_age);
+        info->headers.push_back(h);
+    }
+    // Cronet 总是接受 gzip，开启 brotli 后优先 br，压缩率取常见 JSON 的量级
+    st->wire_ratio = 1;
+    if (st->rt.text && st->rt.body_bytes > 0) {
+        h.name = "Content-Encoding";
+        h.value = engine->params.enable_brotli ? "br" : "gzip";
+        info->headers.push_back(h);
+        st->wire_ratio = engine->params.enable_brotli ? 0.35 : 0.45;
+    }
+    if (st->from_cache) {
+        st->wire_ratio = 0;
+    }
+    st->response = info;
+    // HEAD 只有头部，Content-Length 仍是 GET 时的长度
+    st->body_left = st->params.http_method == "HEAD" ? 0 : st->rt.body_bytes;
+
+    std::shared_ptr<RequestState> self = st;
+    Cronet_UrlResponseInfoPtr raw = info.get();
+    if (!st->rt.location.empty()) {
+        st->phase = PHASE_WAITING_REDIRECT;
+        std::string location = st->rt.location;
+        post_to_executor(st->executor, [self, raw, location]() {
+            self->callback->on_redirect(self->callback, self->handle, raw, location.c_str());
+        });
+        return;
+    }
+    st->phase = PHASE_RESPONSE;
+    post_to_executor(st->executor, [self, raw]() {
+        self->callback->on_response_started(self->callback, self->handle, raw);
+    });
+}
+
+// NetLog：每次找连接开一个 HTTP_STREAM_JOB，与 Chrome 一样由 job 绑定连接，请求再绑定到 job
+void begin_stream_job(const std::shared_ptr<RequestState>& st) {
+    NetLogWriter& log = st->engine->netlog;
+    if (!log.enabled() || st->log_id == 0) {
+        return;
+    }
+    st->job_log_id = log.newSource();
+    log.add(NetLogWriter::EV_HTTP_STREAM_JOB, NetLogWriter::SRC_HTTP_STREAM_JOB, st->job_log_id,
+            NetLogWriter::PHASE_BEGIN, wall_ms(), "{\"url\":\"" + json_escape(st->url) + "\"}");
+}
+
+// job 拿到连接：新建或空闲的 TCP 连接为 SOCKET，复用的 h2 会话为 HTTP2_SESSION，h3 为 QUIC_SESSION
+void bind_stream_job(const std::shared_ptr<RequestState>& st, int64_t now) {
+    Cronet_EnginePtr engine = st->engine;
+    NetLogWriter& log = engine->netlog;
+    if (st->job_log_id == 0) {
+        // 同 host 重定向直接在原连接上继续，另开一个 job
+        begin_stream_job(st);
+    }
+    uint32_t job = st->job_log_id;
+    std::string proto = protocol_for(engine, st->target);
+    HostPool& pool = engine->pools[st->target.host];
+    if (proto == "h3") {
+        log.add(NetLogWriter::EV_HTTP_STREAM_JOB_BOUND_TO_QUIC_SESSION, NetLogWriter::SRC_HTTP_STREAM_JOB, job,
+                NetLogWriter::PHASE_NONE, now, source_dependency(st->socket_log_id, NetLogWriter::SRC_QUIC_SESSION));
+    }
+    else if (multiplexed(proto) && st->finished->metrics.socket_reused && pool.h2_session_log_id != 0) {
+        log.add(NetLogWriter::EV_HTTP2_SESSION_POOL_FOUND_EXISTING_SESSION, NetLogWriter::SRC_HTTP_STREAM_JOB, job,
+                NetLogWriter::PHASE_NONE, now,
+                source_dependency(pool.h2_session_log_id, NetLogWriter::SRC_HTTP2_SESSION));
+    }
+    else {
+        log.add(NetLogWriter::EV_SOCKET_POOL_BOUND_TO_SOCKET, NetLogWriter::SRC_HTTP_STREAM_JOB, job,
+                NetLogWriter::PHASE_NONE, now, source_dependency(st->socket_log_id, NetLogWriter::SRC_SOCKET));
+    }
+    log.add(NetLogWriter::EV_HTTP_STREAM_JOB, NetLogWriter::SRC_HTTP_STREAM_JOB, job, NetLogWriter::PHASE_END, now,
+            "");
+    log.add(NetLogWriter::EV_HTTP_STREAM_REQUEST_BOUND_TO_JOB, NetLogWriter::SRC_URL_REQUEST, st->log_id,
+            NetLogWriter::PHASE_NONE, now, source_dependency(job, NetLogWriter::SRC_HTTP_STREAM_JOB));
+    st->job_log_id = 0;
+}
+
+// 已拿到连接：发送请求并等待首包
+void begin_transaction(const std::shared_ptr<RequestState>& st) {
+    if (st->phase == PHASE_DONE) {
+        release_socket(st);
+        return;
+    }
+    Cronet_EnginePtr engine = st->engine;
+    Cronet_Metrics& m = st->finished->metrics;
+    m.sending_start.value = wall_ms();
+    if (engine->netlog.enabled()) {
+        bind_stream_job(st, m.sending_start.value);
+    }
+    int64_t sent = (int64_t)(st->params.http_method.size() + st->url.size() + 40);
+    for (size_t i = 0; i < st->params.request_headers.size(); ++ i) {
+        sent += (int64_t)(st->params.request_headers[i].name.size() +
+                          st->params.request_headers[i].value.size() + 4);
+    }
+    m.sent_byte_count = (m.sent_byte_count > 0 ? m.sent_byte_count : 0) + sent;
+
+    std::shared_ptr<RequestState> self = st;
+    double send = engine->jitter(engine->cfg.send_ms);
+    engine->net->postDelayed(send, [self]() {
+        if (self->phase == PHASE_DONE) {
+            return;
+        }
+        self->finished->metrics.sending_end.value = wall_ms();
+        Cronet_EnginePtr engine = self->engine;
+        if (engine->roll(engine->cfg.fail_rate)) {
+            engine->net->postDelayed(engine->jitter(engine->cfg.ttfb_ms), [self]() {
+                fail_request(self, Cronet_Error_ERROR_CODE_ERROR_CONNECTION_RESET,
+                             "net::ERR_CONNECTION_RESET", -101);
+            });
+            return;
+        }
+        double ttfb = engine->jitter(engine->cfg.ttfb_ms) + self->rt.delay_ms;
+        if (engine->roll(engine->cfg.slow_rate)) {
+            ttfb += engine->cfg.slow_ms;
+        }
+        engine->net->postDelayed(ttfb, [self]() { start_response(self); });
+    });
+}
+
+// h2/h3 会话建好：排队的请求与双向流都开始在会话上发送
+void session_established(HostPool& pool) {
+    pool.session_ready = true;
+    pool.session_connecting = false;
+    std::deque<std::shared_ptr<RequestState>> waiters;
+    waiters.swap(pool.waiters);
+    for (size_t i = 0; i < waiters.size(); ++ i) {
+        waiters[i]->holds_socket = true;
+        waiters[i]->finished->metrics.socket_reused = true;
+        waiters[i]->socket_log_id = pool.session_log_id;
+        begin_transaction(waiters[i]);
+    }
+    std::vector<std::function<void()>> streams;
+    streams.swap(pool.stream_waiters);
+    for (size_t i = 0; i < streams.size(); ++ i) {
+        streams[i]();
+    }
+}
+
+void connect_new_socket(const std::shared_ptr<RequestState>& st, bool multiplex) {
+    Cronet_EnginePtr engine = st->engine;
+    Cronet_Metrics& m = st->finished->metrics;
+    HostPool& pool = engine->pools[st->target.host];
+    ++ pool.sockets;
+    if (multiplex) {
+        pool.session_connecting = true;
+    }
+
+    double dns = 0;
+    if (!engine->resolved[st->target.host]) {
+        dns = engine->jitter(engine->cfg.dns_ms);
+    }
+    // QUIC 的传输与 TLS 握手合在一个往返里完成，ssl 阶段与 connect 重合
+    bool quic = protocol_for(engine, st->target) == "h3";
+    double connect = engine->jitter(quic ? std::max(engine->cfg.connect_ms, engine->cfg.ssl_ms)
+                                         : engine->cfg.connect_ms);
+    double ssl = st->target.scheme == "https" && !quic ? engine->jitter(engine->cfg.ssl_ms) : 0;
+
+    // NetLog：DNS 任务与连接（h3 为 QUIC 会话）各占一个来源
+    NetLogWriter& log = engine->netlog;
+    std::string host_param = "{\"host\":\"" + json_escape(st->target.host) + "\"}";
+    uint32_t dns_id = dns > 0 ? log.newSource() : 0;
+    st->socket_log_id = log.newSource();
+
+    std::shared_ptr<RequestState> self = st;
+    m.dns_start.value = wall_ms();
+    log.add(NetLogWriter::EV_HOST_RESOLVER_MANAGER_JOB, NetLogWriter::SRC_HOST_RESOLVER_IMPL_JOB, dns_id,
+            NetLogWriter::PHASE_BEGIN, m.dns_start.value, host_param);
+    engine->net->postDelayed(dns, [self, connect, ssl, multiplex, quic, dns_id, host_param]() {
+        Cronet_EnginePtr engine = self->engine;
+        Cronet_Metrics& m = self->finished->metrics;
+        NetLogWriter& log = engine->netlog;
+        m.dns_end.value = wall_ms();
+        engine->resolved[self->target.host] = true;
+        if (self->target.host.compare(0, 12, "fail.invalid") == 0) {
+            log.add(NetLogWriter::EV_HOST_RESOLVER_MANAGER_JOB, NetLogWriter::SRC_HOST_RESOLVER_IMPL_JOB, dns_id,
+                    NetLogWriter::PHASE_END, m.dns_end.value, "{\"net_error\":-105}");
+            HostPool& pool = engine->pools[self->target.host];
+            -- pool.sockets;
+            std::deque<std::shared_ptr<RequestState>> waiters;
+            if (multiplex) {
+                // 等这个会话的请求都依赖这次解析，一起失败
+                pool.session_connecting = false;
+                waiters.swap(pool.waiters);
+            }
+            else if (!pool.waiters.empty()) {
+                // 空出的连接名额给下一个排队的请求
+                std::shared_ptr<RequestState> next = pool.waiters.front();
+                pool.waiters.pop_front();
+                connect_new_socket(next, false);
+            }
+            fail_request(self, Cronet_Error_ERROR_CODE_ERROR_HOSTNAME_NOT_RESOLVED,
+                         "net::ERR_NAME_NOT_RESOLVED", -105);
+            for (size_t i = 0; i < waiters.size(); ++ i) {
+                fail_request(waiters[i], Cronet_Error_ERROR_CODE_ERROR_HOSTNAME_NOT_RESOLVED,
+                             "net::ERR_NAME_NOT_RESOLVED", -105);
+            }
+            return;
+        }
+        log.add(NetLogWriter::EV_HOST_RESOLVER_MANAGER_JOB, NetLogWriter::SRC_HOST_RESOLVER_IMPL_JOB, dns_id,
+                NetLogWriter::PHASE_END, m.dns_end.value, "");
+        m.connect_start.value = wall_ms();
+        if (quic) {
+            m.ssl_start.value = m.connect_start.value;
+            log.add(NetLogWriter::EV_QUIC_SESSION, NetLogWriter::SRC_QUIC_SESSION, self->socket_log_id,
+                    NetLogWriter::PHASE_BEGIN, m.connect_start.value, host_param);
+        }
+        else {
+            std::string address = "\"" + json_escape(self->target.host) + "\"";
+            log.add(NetLogWriter::EV_TCP_CONNECT, NetLogWriter::SRC_SOCKET, self->socket_log_id,
+                    NetLogWriter::PHASE_BEGIN, m.connect_start.value, "{\"address_list\":[" + address + "]}");
+            log.add(NetLogWriter::EV_TCP_CONNECT_ATTEMPT, NetLogWriter::SRC_SOCKET, self->socket_log_id,
+                    NetLogWriter::PHASE_BEGIN, m.connect_start.value, "{\"address\":" + address + "}");
+        }
+        engine->net->postDelayed(connect, [self, ssl, multiplex, quic, host_param]() {
+            Cronet_EnginePtr engine = self->engine;
+            Cronet_Metrics& m = self->finished->metrics;
+            NetLogWriter& log = engine->netlog;
+            int64_t connected = wall_ms();
+            if (!quic) {
+                log.add(NetLogWriter::EV_TCP_CONNECT_ATTEMPT, NetLogWriter::SRC_SOCKET, self->socket_log_id,
+                        NetLogWriter::PHASE_END, connected, "");
+                log.add(NetLogWriter::EV_TCP_CONNECT, NetLogWriter::SRC_SOCKET, self->socket_log_id,
+                        NetLogWriter::PHASE_END, connected, "");
+            }
+            if (ssl > 0) {
+                m.ssl_start.value = connected;
+                log.add(NetLogWriter::EV_SSL_CONNECT, NetLogWriter::SRC_SOCKET, self->socket_log_id,
+                        NetLogWriter::PHASE_BEGIN, connected, "");
+            }
+            engine->net->postDelayed(ssl, [self, ssl, multiplex, quic, host_param]() {
+                Cronet_EnginePtr engine = self->engine;
+                Cronet_Metrics& m = self->finished->metrics;
+                NetLogWriter& log = engine->netlog;
+                int64_t now = wall_ms();
+                if (ssl > 0 || quic) {
+                    m.ssl_end.value = now;
+                }
+                if (ssl > 0) {
+                    log.add(NetLogWriter::EV_SSL_CONNECT, NetLogWriter::SRC_SOCKET, self->socket_log_id,
+                            NetLogWriter::PHASE_END, now, "");
+                }
+                m.connect_end.value = now;
+                self->holds_socket = true;
+                HostPool& pool = engine->pools[self->target.host];
+                if (multiplex) {
+                    pool.session_log_id = self->socket_log_id;
+                    if (!quic && log.enabled()) {
+                        // h2 会话挂在刚建好的 TLS 连接上
+                        std::string params = host_param.substr(0, host_param.size() - 1) + "," +
+                                             source_dependency(self->socket_log_id, NetLogWriter::SRC_SOCKET).substr(1);
+                        pool.h2_session_log_id = log.newSource();
+                        log.add(NetLogWriter::EV_HTTP2_SESSION, NetLogWriter::SRC_HTTP2_SESSION,
+                                pool.h2_session_log_id, NetLogWriter::PHASE_BEGIN, now, params);
+                    }
+                }
+                // 建连的请求先绑定，NetLog 里新连接上的第一个请求是它而不是排队的请求
+                begin_transaction(self);
+                if (multiplex) {
+                    session_established(pool);
+                }
+            });
+        });
+    });
+}
+
+// 按优先级排进等待队列，同优先级先到先出，与 Chrome 连接池的等待队列一致
+void enqueue_waiter(HostPool& pool, const std::shared_ptr<RequestState>& st) {
+    auto it = pool.waiters.end();
+    while (it != pool.waiters.begin() && (*(it - 1))->params.priority < st->params.priority) {
+        -- it;
+    }
+    pool.waiters.insert(it, st);
+}
+
+// 为请求分配连接：复用空闲连接、新建连接或排队
+void acquire_socket(const std::shared_ptr<RequestState>& st) {
+    Cronet_EnginePtr engine = st->engine;
+    st->target = parse_url(st->url);
+    st->rt = route(engine->cfg, st->target);
+    begin_stream_job(st);
+    HostPool& pool = engine->pools[st->target.host];
+    std::string proto = protocol_for(engine, st->target);
+
+    if (multiplexed(proto)) {
+        if (pool.session_ready) {
+            st->holds_socket = true;
+            st->finished->metrics.socket_reused = true;
+            st->socket_log_id = pool.session_log_id;
+            begin_transaction(st);
+        }
+        else if (pool.session_connecting) {
+            enqueue_waiter(pool, st);
+        }
+        else {
+            connect_new_socket(st, true);
+        }
+        return;
+    }
+
+    Clock::time_point now = Clock::now();
+    while (!pool.idle.empty()) {
+        IdleSocket idle = pool.idle.back();
+        pool.idle.pop_back();
+        double idle_ms = std::chrono::duration<double, std::milli>(now - idle.last_used).count();
+        if (idle_ms <= engine->cfg.idle_timeout_ms) {
+            st->holds_socket = true;
+            st->finished->metrics.socket_reused = true;
+            st->socket_log_id = idle.log_id;
+            begin_transaction(st);
+            return;
+        }
+        -- pool.sockets;
+    }
+    if (pool.sockets < engine->cfg.max_sockets_per_host) {
+        connect_new_socket(st, false);
+    }
+    else {
+        enqueue_waiter(pool, st);
+    }
+}
+
+void start_on_network(const std::shared_ptr<RequestState>& st) {
+    st->finished = std::make_shared<Cronet_RequestFinishedInfo>();
+    st->finished->annotations = st->params.annotations;
+    st->finished->metrics.request_start.value = wall_ms();
+    st->phase = PHASE_STARTED;
+    NetLogWriter& log = st->engine->netlog;
+    if (log.enabled()) {
+        int64_t start = st->finished->metrics.request_start.value;
+        st->log_id = log.newSource();
+        log.add(NetLogWriter::EV_REQUEST_ALIVE, NetLogWriter::SRC_URL_REQUEST, st->log_id, NetLogWriter::PHASE_BEGIN,
+                start, "");
+        log.add(NetLogWriter::EV_URL_REQUEST_START_JOB, NetLogWriter::SRC_URL_REQUEST, st->log_id,
+                NetLogWriter::PHASE_BEGIN, start,
+                "{\"method\":\"" + json_escape(st->params.http_method) + "\",\"url\":\"" + json_escape(st->url) +
+                    "\"}");
+    }
+    if (cacheable_request(st)) {
+        Cronet_EnginePtr engine = st->engine;
+        const ResponseCache::Entry* e = engine->cache.lookup(st->url, st->finished->metrics.request_start.value);
+        if (e) {
+            // 命中缓存不建连接，也没有 DNS/连接/TLS 阶段
+            st->from_cache = true;
+            st->cached_protocol = e->protocol;
+            st->target = parse_url(st->url);
+            st->rt = Route();
+            st->rt.body_bytes = e->body_bytes;
+            st->rt.text = e->text;
+            bool disk = engine->params.http_cache_mode == Cronet_EngineParams_HTTP_CACHE_MODE_DISK;
+            double delay = engine->jitter(disk ? engine->cfg.cache_disk_ms : engine->cfg.cache_memory_ms);
+            engine->net->postDelayed(delay, [st]() { start_response(st); });
+            return;
+        }
+    }
+    acquire_socket(st);
+}
+
+} // namespace
+
+struct Cronet_UrlRequest {
+    Cronet_ClientContext ctx = nullptr;
+    std::shared_ptr<RequestState> state;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Buffer
+
+Cronet_BufferPtr Cronet_Buffer_Create(void) {
+    return new Cronet_Buffer;
+}
+
+void Cronet_Buffer_Destroy(Cronet_BufferPtr self) {
+    if (!self) {
+        return;
+    }
+    if (self->callback) {
+        Cronet_BufferCallback_OnDestroy(self->callback, self);
+    }
+    if (self->owned) {
+        free(self->data);
+    }
+    delete self;
+}
+
+void Cronet_Buffer_SetClientContext(Cronet_BufferPtr self, Cronet_ClientContext client_context) {
+    self->ctx = client_context;
+}
+
+Cronet_ClientContext Cronet_Buffer_GetClientContext(Cronet_BufferPtr self) {
+    return self->ctx;
+}
+
+void Cronet_Buffer_InitWithDataAndCallback(Cronet_BufferPtr self, Cronet_RawDataPtr data,
+                                           uint64_t size, Cronet_BufferCallbackPtr callback) {
+    self->data = data;
+    self->size = size;
+    self->owned = false;
+    self->callback = callback;
+}
+
+void Cronet_Buffer_InitWithAlloc(Cronet_BufferPtr self, uint64_t size) {
+    self->data = malloc(size ? size : 1);
+    self->size = size;
+    self->owned = true;
+}
+
+uint64_t Cronet_Buffer_GetSize(Cronet_BufferPtr self) {
+    return self->size;
+}
+
+Cronet_RawDataPtr Cronet_Buffer_GetData(Cronet_BufferPtr self) {
+    return self->data;
+}
+
+void Cronet_BufferCallback_Destroy(Cronet_BufferCallbackPtr self) {
+    delete self;
+}
+
+void Cronet_BufferCallback_SetClientContext(Cronet_BufferCallbackPtr self,
+                                            Cronet_ClientContext client_context) {
+    self->ctx = client_context;
+}
+
+Cronet_ClientContext Cronet_BufferCallback_GetClientContext(Cronet_BufferCallbackPtr self) {
+    return self->ctx;
+}
+
+void Cronet_BufferCallback_OnDestroy(Cronet_BufferCallbackPtr self, Cronet_BufferPtr buffer) {
+    if (self->on_destroy) {
+        self->on_destroy(self, buffer);
+    }
+}
+
+Cronet_BufferCallbackPtr Cronet_BufferCallback_CreateWith(Cronet_BufferCallback_OnDestroyFunc OnDestroyFunc) {
+    Cronet_BufferCallbackPtr cb = new Cronet_BufferCallback;
+    cb->on_destroy = OnDestroyFunc;
+    return cb;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Runnable / Executor
+
+void Cronet_Runnable_Destroy(Cronet_RunnablePtr self) {
+    delete self;
+}
+
+void Cronet_Runnable_SetClientContext(Cronet_RunnablePtr self, Cronet_ClientContext client_context) {
+    self->ctx = client_context;
+}
+
+Cronet_ClientContext Cronet_Runnable_GetClientContext(Cronet_RunnablePtr self) {
+    return self->ctx;
+}
+
+void Cronet_Runnable_Run(Cronet_RunnablePtr self) {
+    if (self->run) {
+        self->run(self);
+    }
+    else if (self->task) {
+        self->task();
+    }
+}
+
+Cronet_RunnablePtr Cronet_Runnable_CreateWith(Cronet_Runnable_RunFunc RunFunc) {
+    Cronet_RunnablePtr r = new Cronet_Runnable;
+    r->run = RunFunc;
+    return r;
+}
+
+void Cronet_Executor_Destroy(Cronet_ExecutorPtr self) {
+    delete self;
+}
+
+void Cronet_Executor_SetClientContext(Cronet_ExecutorPtr self, Cronet_ClientContext client_context) {
+    self->ctx = client_context;
+}
+
+Cronet_ClientContext Cronet_Executor_GetClientContext(Cronet_ExecutorPtr self) {
+    return self->ctx;
+}
+
+void Cronet_Executor_Execute(Cronet_ExecutorPtr self, Cronet_RunnablePtr command) {
+    self->execute(self, command);
+}
+
+Cronet_ExecutorPtr Cronet_Executor_CreateWith(Cronet_Executor_ExecuteFunc ExecuteFunc) {
+    Cronet_ExecutorPtr e = new Cronet_Executor;
+    e->execute = ExecuteFunc;
+    return e;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Engine
+
+Cronet_EnginePtr Cronet_Engine_Create(void) {
+    Cronet_EnginePtr e = new Cronet_Engine;
+    e->cfg = load_config();
+    e->rng.seed(std::random_device()());
+    return e;
+}
+
+void Cronet_Engine_Destroy(Cronet_EnginePtr self) {
+    if (!self) {
+        return;
+    }
+    Cronet_Engine_Shutdown(self);
+    delete self;
+}
+
+void Cronet_Engine_SetClientContext(Cronet_EnginePtr self, Cronet_ClientContext client_context) {
+    self->ctx = client_context;
+}
+
+Cronet_ClientContext Cronet_Engine_GetClientContext(Cronet_EnginePtr self) {
+    return self->ctx;
+}
+
+Cronet_RESULT Cronet_Engine_StartWithParams(Cronet_EnginePtr self, Cronet_EngineParamsPtr params) {
+    if (self->started) {
+        return Cronet_RESULT_ILLEGAL_STATE_ENGINE_ALREADY_STARTED;
+    }
+    if (params) {
+        self->params = *params;
+    }
+    bool disk = self->params.http_cache_mode == Cronet_EngineParams_HTTP_CACHE_MODE_DISK ||
+                self->params.http_cache_mode == Cronet_EngineParams_HTTP_CACHE_MODE_DISK_NO_HTTP;
+    if (disk) {
+        struct stat sb;
+        if (self->params.storage_path.empty() || stat(self->params.storage_path.c_str(), &sb) != 0 ||
+            !S_ISDIR(sb.st_mode)) {
+            return Cronet_RESULT_ILLEGAL_ARGUMENT_STORAGE_PATH_MUST_EXIST;
+        }
+    }
+    self->cache = ResponseCache();
+    self->cache.capacity = self->params.http_cache_max_size;
+    if (self->params.http_cache_mode == Cronet_EngineParams_HTTP_CACHE_MODE_DISK) {
+        self->cache.load(self->params.storage_path + "/shim_http_cache");
+    }
+    self->net.reset(new NetworkThread);
+    self->started = true;
+    return Cronet_RESULT_SUCCESS;
+}
+
+// 模拟器没有字节级事件，log_all 不影响输出
+bool Cronet_Engine_StartNetLogToFile(Cronet_EnginePtr self, Cronet_String file_name, bool /* log_all */) {
+    return file_name && self->netlog.open(file_name);
+}
+
+void Cronet_Engine_StopNetLog(Cronet_EnginePtr self) {
+    self->netlog.close();
+}
+
+Cronet_RESULT Cronet_Engine_Shutdown(Cronet_EnginePtr self) {
+    if (self->net && self->net->onThread()) {
+        return Cronet_RESULT_ILLEGAL_STATE_CANNOT_SHUTDOWN_ENGINE_FROM_NETWORK_THREAD;
+    }
+    self->net.reset();
+    self->pools.clear();
+    self->netlog.close();
+    if (self->started && self->params.http_cache_mode == Cronet_EngineParams_HTTP_CACHE_MODE_DISK) {
+        self->cache.save(self->params.storage_path + "/shim_http_cache");
+    }
+    self->started = false;
+    return Cronet_RESULT_SUCCESS;
+}
+
+Cronet_String Cronet_Engine_GetVersionString(Cronet_EnginePtr) {
+    return "cronet-shim/1.0";
+}
+
+Cronet_String Cronet_Engine_GetDefaultUserAgent(Cronet_EnginePtr) {
+    return "cronet-shim";
+}
+
+void Cronet_Engine_AddRequestFinishedListener(Cronet_EnginePtr self,
+                                              Cronet_RequestFinishedInfoListenerPtr listener,
+                                              Cronet_ExecutorPtr executor) {
+    std::lock_guard<std::mutex> lock(self->listener_mutex);
+    self->listeners[listener] = executor;
+}
+
+void Cronet_Engine_RemoveRequestFinishedListener(Cronet_EnginePtr self,
+                                                 Cronet_RequestFinishedInfoListenerPtr listener) {
+    std::lock_guard<std::mutex> lock(self->listener_mutex);
+    self->listeners.erase(listener);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// UrlRequestCallback / RequestFinishedInfoListener / StatusListener
+
+void Cronet_UrlRequestCallback_Destroy(Cronet_UrlRequestCallbackPtr self) {
+    delete self;
+}
+
+void Cronet_UrlRequestCallback_SetClientContext(Cronet_UrlRequestCallbackPtr self,
+                                                Cronet_ClientContext client_context) {
+    self->ctx = client_context;
+}
+
+Cronet_ClientContext Cronet_UrlRequestCallback_GetClientContext(Cronet_UrlRequestCallbackPtr self) {
+    return self->ctx;
+}
+
+Cronet_UrlRequestCallbackPtr Cronet_UrlRequestCallback_CreateWith(
+    Cronet_UrlRequestCallback_OnRedirectReceivedFunc OnRedirectReceivedFunc,
+    Cronet_UrlRequestCallback_OnResponseStartedFunc OnResponseStartedFunc,
+    Cronet_UrlRequestCallback_OnReadCompletedFunc OnReadCompletedFunc,
+    Cronet_UrlRequestCallback_OnSucceededFunc OnSucceededFunc,
+    Cronet_UrlRequestCallback_OnFailedFunc OnFailedFunc,
+    Cronet_UrlRequestCallback_OnCanceledFunc OnCanceledFunc) {
+    Cronet_UrlRequestCallbackPtr cb = new Cronet_UrlRequestCallback;
+    cb->on_redirect = OnRedirectReceivedFunc;
+    cb->on_response_started = OnResponseStartedFunc;
+    cb->on_read_completed = OnReadCompletedFunc;
+    cb->on_succeeded = OnSucceededFunc;
+    cb->on_failed = OnFailedFunc;
+    cb->on_canceled = OnCanceledFunc;
+    return cb;
+}
+
+void Cronet_RequestFinishedInfoListener_Destroy(Cronet_RequestFinishedInfoListenerPtr self) {
+    delete self;
+}
+
+void Cronet_RequestFinishedInfoListener_SetClientContext(Cronet_RequestFinishedInfoListenerPtr self,
+                                                         Cronet_ClientContext client_context) {
+    self->ctx = client_context;
+}
+
+Cronet_ClientContext Cronet_RequestFinishedInfoListener_GetClientContext(
+    Cronet_RequestFinishedInfoListenerPtr self) {
+    return self->ctx;
+}
+
+void Cronet_RequestFinishedInfoListener_OnRequestFinished(Cronet_RequestFinishedInfoListenerPtr self,
+                                                          Cronet_RequestFinishedInfoPtr request_info,
+                                                          Cronet_UrlResponseInfoPtr response_info,
+                                                          Cronet_ErrorPtr error) {
+    self->on_finished(self, request_info, response_info, error);
+}
+
+Cronet_RequestFinishedInfoListenerPtr Cronet_RequestFinishedInfoListener_CreateWith(
+    Cronet_RequestFinishedInfoListener_OnRequestFinishedFunc OnRequestFinishedFunc) {
+    Cronet_RequestFinishedInfoListenerPtr l = new Cronet_RequestFinishedInfoListener;
+    l->on_finished = OnRequestFinishedFunc;
+    return l;
+}
+
+void Cronet_UrlRequestStatusListener_Destroy(Cronet_UrlRequestStatusListenerPtr self) {
+    delete self;
+}
+
+void Cronet_UrlRequestStatusListener_SetClientContext(Cronet_UrlRequestStatusListenerPtr self,
+                                                      Cronet_ClientContext client_context) {
+    self->ctx = client_context;
+}
+
+Cronet_ClientContext Cronet_UrlRequestStatusListener_GetClientContext(
+    Cronet_UrlRequestStatusListenerPtr self) {
+    return self->ctx;
+}
+
+void Cronet_UrlRequestStatusListener_OnStatus(Cronet_UrlRequestStatusListenerPtr self,
+                                              Cronet_UrlRequestStatusListener_Status status) {
+    self->on_status(self, status);
+}
+
+Cronet_UrlRequestStatusListenerPtr Cronet_UrlRequestStatusListener_CreateWith(
+    Cronet_UrlRequestStatusListener_OnStatusFunc OnStatusFunc) {
+    Cronet_UrlRequestStatusListenerPtr l = new Cronet_UrlRequestStatusListener;
+    l->on_status = OnStatusFunc;
+    return l;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// UrlRequest
+
+Cronet_UrlRequestPtr Cronet_UrlRequest_Create(void) {
+    return new Cronet_UrlRequest;
+}
+
+void Cronet_UrlRequest_Destroy(Cronet_UrlRequestPtr self) {
+    if (!self) {
+        return;
+    }
+    std::shared_ptr<RequestState> st = self->state;
+    if (st && !st->done && st->engine->net) {
+        // 仍在进行中的请求先取消，网络线程上的任务持有 state 的引用
+        st->engine->net->post([st]() {
+            st->canceled = true;
+            st->handle = nullptr;
+            if (st->phase != PHASE_DONE && st->phase != PHASE_IDLE) {
+                st->phase = PHASE_DONE;
+                release_socket(st);
+            }
+        });
+    }
+    delete self;
+}
+
+void Cronet_UrlRequest_SetClientContext(Cronet_UrlRequestPtr self, Cronet_ClientContext client_context) {
+    self->ctx = client_context;
+}
+
+Cronet_ClientContext Cronet_UrlRequest_GetClientContext(Cronet_UrlRequestPtr self) {
+    return self->ctx;
+}
+
+Cronet_RESULT Cronet_UrlRequest_InitWithParams(Cronet_UrlRequestPtr self, Cronet_EnginePtr engine,
+                                               Cronet_String url, Cronet_UrlRequestParamsPtr params,
+                                               Cronet_UrlRequestCallbackPtr callback,
+                                               Cronet_ExecutorPtr executor) {
+    if (self->state) {
+        return Cronet_RESULT_ILLEGAL_STATE_REQUEST_ALREADY_INITIALIZED;
+    }
+    if (!engine) return Cronet_RESULT_NULL_POINTER_ENGINE;
+    if (!url) return Cronet_RESULT_NULL_POINTER_URL;
+    if (!params) return Cronet_RESULT_NULL_POINTER_PARAMS;
+    if (!callback) return Cronet_RESULT_NULL_POINTER_CALLBACK;
+    if (!executor) return Cronet_RESULT_NULL_POINTER_EXECUTOR;
+    if (!engine->started) return Cronet_RESULT_ILLEGAL_STATE;
+
+    std::shared_ptr<RequestState> st = std::make_shared<RequestState>();
+    st->handle = self;
+    st->engine = engine;
+    st->url = url;
+    st->params = *params;
+    st->callback = callback;
+    st->executor = executor;
+    self->state = st;
+    return Cronet_RESULT_SUCCESS;
+}
+
+Cronet_RESULT Cronet_UrlRequest_Start(Cronet_UrlRequestPtr self) {
+    std::shared_ptr<RequestState> st = self->state;
+    if (!st) {
+        return Cronet_RESULT_ILLEGAL_STATE_REQUEST_NOT_INITIALIZED;
+    }
+    if (st->phase != PHASE_IDLE) {
+        return Cronet_RESULT_ILLEGAL_STATE_REQUEST_ALREADY_STARTED;
+    }
+    st->phase = PHASE_STARTED;
+    st->engine->net->post([st]() { start_on_network(st); });
+    return Cronet_RESULT_SUCCESS;
+}
+
+Cronet_RESULT Cronet_UrlRequest_FollowRedirect(Cronet_UrlRequestPtr self) {
+    std::shared_ptr<RequestState> st = self->state;
+    if (!st) {
+        return Cronet_RESULT_ILLEGAL_STATE_REQUEST_NOT_INITIALIZED;
+    }
+    st->engine->net->post([st]() {
+        if (st->phase != PHASE_WAITING_REDIRECT) {
+            return;
+        }
+        std::string next = st->rt.location;
+        bool same_host = parse_url(next).host == st->target.host;
+        st->url = next;
+        if (same_host) {
+            st->target = parse_url(st->url);
+            st->rt = route(st->engine->cfg, st->target);
+            st->phase = PHASE_STARTED;
+            begin_transaction(st);
+        }
+        else {
+            release_socket(st);
+            st->phase = PHASE_STARTED;
+            acquire_socket(st);
+        }
+    });
+    return Cronet_RESULT_SUCCESS;
+}
+
+Cronet_RESULT Cronet_UrlRequest_Read(Cronet_UrlRequestPtr self, Cronet_BufferPtr buffer) {
+    std::shared_ptr<RequestState> st = self->state;
+    if (!st) {
+        return Cronet_RESULT_ILLEGAL_STATE_REQUEST_NOT_INITIALIZED;
+    }
+    st->engine->net->post([st, buffer]() {
+        if (st->phase != PHASE_RESPONSE && st->phase != PHASE_READING) {
+            return;
+        }
+        st->phase = PHASE_READING;
+        if (st->body_left <= 0) {
+            finish_request(st, Cronet_RequestFinishedInfo_FINISHED_REASON_SUCCEEDED);
+            return;
+        }
+        Cronet_EnginePtr engine = st->engine;
+        engine->net->postDelayed(engine->jitter(engine->cfg.read_ms), [st, buffer]() {
+            if (st->phase != PHASE_READING) {
+                return;
+            }
+            uint64_t n = (uint64_t)st->body_left;
+            if (n > buffer->size) {
+                n = buffer->size;
+            }
+            memset(buffer->data, 'x', (size_t)n);
+            st->body_left -= (int64_t)n;
+            st->response->received_byte_count += (int64_t)(n * st->wire_ratio + 0.5);
+            Cronet_UrlResponseInfoPtr info = st->response.get();
+            post_to_executor(st->executor, [st, info, buffer, n]() {
+                st->callback->on_read_completed(st->callback, st->handle, info, buffer, n);
+            });
+        });
+    });
+    return Cronet_RESULT_SUCCESS;
+}
+
+void Cronet_UrlRequest_Cancel(Cronet_UrlRequestPtr self) {
+    std::shared_ptr<RequestState> st = self->state;
+    if (!st || !st->engine->net) {
+        return;
+    }
+    st->engine->net->post([st]() {
+        if (st->phase == PHASE_IDLE || st->phase == PHASE_DONE) {
+            return;
+        }
+        st->canceled = true;
+        // 排队中的请求从等待队列中移除
+        HostPool& pool = st->engine->pools[st->target.host];
+        for (auto it = pool.waiters.begin(); it != pool.waiters.end(); ++ it) {
+            if (it->get() == st.get()) {
+                pool.waiters.erase(it);
+                break;
+            }
+        }
+        finish_request(st, Cronet_RequestFinishedInfo_FINISHED_REASON_CANCELED);
+    });
+}
+
+bool Cronet_UrlRequest_IsDone(Cronet_UrlRequestPtr self) {
+    return self->state && self->state->done;
+}
+
+bool Cronet_UrlRequest_IsFailed(Cronet_UrlRequestPtr self) {
+    return self->state && self->state->failed;
+}
+
+void Cronet_UrlRequest_GetStatus(Cronet_UrlRequestPtr self, Cronet_UrlRequestStatusListenerPtr listener) {
+    std::shared_ptr<RequestState> st = self->state;
+    Cronet_UrlRequestStatusListener_Status status = Cronet_UrlRequestStatusListener_Status_INVALID;
+    if (st && !st->done) {
+        status = st->phase == PHASE_READING ? Cronet_UrlRequestStatusListener_Status_READING_RESPONSE
+                                            : Cronet_UrlRequestStatusListener_Status_WAITING_FOR_RESPONSE;
+    }
+    Cronet_UrlRequestStatusListener_OnStatus(listener, status);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Structs
+
+Cronet_ErrorPtr Cronet_Error_Create(void) { return new Cronet_Error; }
+void Cronet_Error_Destroy(Cronet_ErrorPtr self) { delete self; }
+void Cronet_Error_error_code_set(Cronet_ErrorPtr self, const Cronet_Error_ERROR_CODE error_code) { self->error_code = error_code; }
+void Cronet_Error_message_set(Cronet_ErrorPtr self, const Cronet_String message) { self->message = message ? message : ""; }
+void Cronet_Error_internal_error_code_set(Cronet_ErrorPtr self, const int32_t v) { self->internal_error_code = v; }
+void Cronet_Error_immediately_retryable_set(Cronet_ErrorPtr self, const bool v) { self->immediately_retryable = v; }
+void Cronet_Error_quic_detailed_error_code_set(Cronet_ErrorPtr self, const int32_t v) { self->quic_detailed_error_code = v; }
+Cronet_Error_ERROR_CODE Cronet_Error_error_code_get(const Cronet_ErrorPtr self) { return self->error_code; }
+Cronet_String Cronet_Error_message_get(const Cronet_ErrorPtr self) { return self->message.c_str(); }
+int32_t Cronet_Error_internal_error_code_get(const Cronet_ErrorPtr self) { return self->internal_error_code; }
+bool Cronet_Error_immediately_retryable_get(const Cronet_ErrorPtr self) { return self->immediately_retryable; }
+int32_t Cronet_Error_quic_detailed_error_code_get(const Cronet_ErrorPtr self) { return self->quic_detailed_error_code; }
+
+Cronet_QuicHintPtr Cronet_QuicHint_Create(void) { return new Cronet_QuicHint; }
+void Cronet_QuicHint_Destroy(Cronet_QuicHintPtr self) { delete self; }
+void Cronet_QuicHint_host_set(Cronet_QuicHintPtr self, const Cronet_String host) { self->host = host ? host : ""; }
+void Cronet_QuicHint_port_set(Cronet_QuicHintPtr self, const int32_t port) { self->port = port; }
+void Cronet_QuicHint_alternate_port_set(Cronet_QuicHintPtr self, const int32_t v) { self->alternate_port = v; }
+Cronet_String Cronet_QuicHint_host_get(const Cronet_QuicHintPtr self) { return self->host.c_str(); }
+int32_t Cronet_QuicHint_port_get(const Cronet_QuicHintPtr self) { return self->port; }
+int32_t Cronet_QuicHint_alternate_port_get(const Cronet_QuicHintPtr self) { return self->alternate_port; }
+
+Cronet_EngineParamsPtr Cronet_EngineParams_Create(void) { return new Cronet_EngineParams; }
+void Cronet_EngineParams_Destroy(Cronet_EngineParamsPtr self) { delete self; }
+void Cronet_EngineParams_enable_check_result_set(Cronet_EngineParamsPtr self, const bool v) { self->enable_check_result = v; }
+void Cronet_EngineParams_user_agent_set(Cronet_EngineParamsPtr self, const Cronet_String v) { self->user_agent = v ? v : ""; }
+void Cronet_EngineParams_accept_language_set(Cronet_EngineParamsPtr self, const Cronet_String v) { self->accept_language = v ? v : ""; }
+void Cronet_EngineParams_storage_path_set(Cronet_EngineParamsPtr self, const Cronet_String v) { self->storage_path = v ? v : ""; }
+void Cronet_EngineParams_enable_quic_set(Cronet_EngineParamsPtr self, const bool v) { self->enable_quic = v; }
+void Cronet_EngineParams_enable_http2_set(Cronet_EngineParamsPtr self, const bool v) { self->enable_http2 = v; }
+void Cronet_EngineParams_enable_brotli_set(Cronet_EngineParamsPtr self, const bool v) { self->enable_brotli = v; }
+void Cronet_EngineParams_http_cache_mode_set(Cronet_EngineParamsPtr self, const Cronet_EngineParams_HTTP_CACHE_MODE v) { self->http_cache_mode = v; }
+void Cronet_EngineParams_http_cache_max_size_set(Cronet_EngineParamsPtr self, const int64_t v) { self->http_cache_max_size = v; }
+void Cronet_EngineParams_quic_hints_add(Cronet_EngineParamsPtr self, const Cronet_QuicHintPtr element) { self->quic_hints.push_back(*element); }
+void Cronet_EngineParams_network_thread_priority_set(Cronet_EngineParamsPtr self, const double v) { self->network_thread_priority = v; }
+void Cronet_EngineParams_experimental_options_set(Cronet_EngineParamsPtr self, const Cronet_String v) { self->experimental_options = v ? v : ""; }
+bool Cronet_EngineParams_enable_check_result_get(const Cronet_EngineParamsPtr self) { return self->enable_check_result; }
+Cronet_String Cronet_EngineParams_user_agent_get(const Cronet_EngineParamsPtr self) { return self->user_agent.c_str(); }
+Cronet_String Cronet_EngineParams_accept_language_get(const Cronet_EngineParamsPtr self) { return self->accept_language.c_str(); }
+Cronet_String Cronet_EngineParams_storage_path_get(const Cronet_EngineParamsPtr self) { return self->storage_path.c_str(); }
+bool Cronet_EngineParams_enable_quic_get(const Cronet_EngineParamsPtr self) { return self->enable_quic; }
+bool Cronet_EngineParams_enable_http2_get(const Cronet_EngineParamsPtr self) { return self->enable_http2; }
+bool Cronet_EngineParams_enable_brotli_get(const Cronet_EngineParamsPtr self) { return self->enable_brotli; }
+Cronet_EngineParams_HTTP_CACHE_MODE Cronet_EngineParams_http_cache_mode_get(const Cronet_EngineParamsPtr self) { return self->http_cache_mode; }
+int64_t Cronet_EngineParams_http_cache_max_size_get(const Cronet_EngineParamsPtr self) { return self->http_cache_max_size; }
+uint32_t Cronet_EngineParams_quic_hints_size(const Cronet_EngineParamsPtr self) { return (uint32_t)self->quic_hints.size(); }
+Cronet_QuicHintPtr Cronet_EngineParams_quic_hints_at(const Cronet_EngineParamsPtr self, uint32_t index) { return &self->quic_hints[index]; }
+void Cronet_EngineParams_quic_hints_clear(Cronet_EngineParamsPtr self) { self->quic_hints.clear(); }
+double Cronet_EngineParams_network_thread_priority_get(const Cronet_EngineParamsPtr self) { return self->network_thread_priority; }
+Cronet_String Cronet_EngineParams_experimental_options_get(const Cronet_EngineParamsPtr self) { return self->experimental_options.c_str(); }
+
+Cronet_HttpHeaderPtr Cronet_HttpHeader_Create(void) { return new Cronet_HttpHeader; }
+void Cronet_HttpHeader_Destroy(Cronet_HttpHeaderPtr self) { delete self; }
+void Cronet_HttpHeader_name_set(Cronet_HttpHeaderPtr self, const Cronet_String name) { self->name = name ? name : ""; }
+void Cronet_HttpHeader_value_set(Cronet_HttpHeaderPtr self, const Cronet_String value) { self->value = value ? value : ""; }
+Cronet_String Cronet_HttpHeader_name_get(const Cronet_HttpHeaderPtr self) { return self->name.c_str(); }
+Cronet_String Cronet_HttpHeader_value_get(const Cronet_HttpHeaderPtr self) { return self->value.c_str(); }
+
+Cronet_UrlResponseInfoPtr Cronet_UrlResponseInfo_Create(void) { return new Cronet_UrlResponseInfo; }
+void Cronet_UrlResponseInfo_Destroy(Cronet_UrlResponseInfoPtr self) { delete self; }
+Cronet_String Cronet_UrlResponseInfo_url_get(const Cronet_UrlResponseInfoPtr self) { return self->url.c_str(); }
+uint32_t Cronet_UrlResponseInfo_url_chain_size(const Cronet_UrlResponseInfoPtr self) { return (uint32_t)self->url_chain.size(); }
+Cronet_String Cronet_UrlResponseInfo_url_chain_at(const Cronet_UrlResponseInfoPtr self, uint32_t index) { return self->url_chain[index].c_str(); }
+int32_t Cronet_UrlResponseInfo_http_status_code_get(const Cronet_UrlResponseInfoPtr self) { return self->http_status_code; }
+Cronet_String Cronet_UrlResponseInfo_http_status_text_get(const Cronet_UrlResponseInfoPtr self) { return self->http_status_text.c_str(); }
+uint32_t Cronet_UrlResponseInfo_all_headers_list_size(const Cronet_UrlResponseInfoPtr self) { return (uint32_t)self->headers.size(); }
+Cronet_HttpHeaderPtr Cronet_UrlResponseInfo_all_headers_list_at(const Cronet_UrlResponseInfoPtr self, uint32_t index) { return &self->headers[index]; }
+bool Cronet_UrlResponseInfo_was_cached_get(const Cronet_UrlResponseInfoPtr self) { return self->was_cached; }
+Cronet_String Cronet_UrlResponseInfo_negotiated_protocol_get(const Cronet_UrlResponseInfoPtr self) { return self->negotiated_protocol.c_str(); }
+Cronet_String Cronet_UrlResponseInfo_proxy_server_get(const Cronet_UrlResponseInfoPtr self) { return self->proxy_server.c_str(); }
+int64_t Cronet_UrlResponseInfo_received_byte_count_get(const Cronet_UrlResponseInfoPtr self) { return self->received_byte_count; }
+
+Cronet_UrlRequestParamsPtr Cronet_UrlRequestParams_Create(void) { return new Cronet_UrlRequestParams; }
+void Cronet_UrlRequestParams_Destroy(Cronet_UrlRequestParamsPtr self) { delete self; }
+void Cronet_UrlRequestParams_http_method_set(Cronet_UrlRequestParamsPtr self, const Cronet_String v) { self->http_method = v ? v : "GET"; }
+void Cronet_UrlRequestParams_request_headers_add(Cronet_UrlRequestParamsPtr self, const Cronet_HttpHeaderPtr element) { self->request_headers.push_back(*element); }
+void Cronet_UrlRequestParams_disable_cache_set(Cronet_UrlRequestParamsPtr self, const bool v) { self->disable_cache = v; }
+void Cronet_UrlRequestParams_disable_proxy_set(Cronet_UrlRequestParamsPtr self, const bool v) { self->disable_proxy = v; }
+void Cronet_UrlRequestParams_priority_set(Cronet_UrlRequestParamsPtr self, const Cronet_UrlRequestParams_REQUEST_PRIORITY v) { self->priority = v; }
+void Cronet_UrlRequestParams_upload_data_provider_set(Cronet_UrlRequestParamsPtr self, const Cronet_UploadDataProviderPtr v) { self->upload_data_provider = v; }
+void Cronet_UrlRequestParams_upload_data_provider_executor_set(Cronet_UrlRequestParamsPtr self, const Cronet_ExecutorPtr v) { self->upload_data_provider_executor = v; }
+void Cronet_UrlRequestParams_allow_direct_executor_set(Cronet_UrlRequestParamsPtr self, const bool v) { self->allow_direct_executor = v; }
+void Cronet_UrlRequestParams_annotations_add(Cronet_UrlRequestParamsPtr self, const Cronet_RawDataPtr element) { self->annotations.push_back(element); }
+void Cronet_UrlRequestParams_request_finished_listener_set(Cronet_UrlRequestParamsPtr self, const Cronet_RequestFinishedInfoListenerPtr v) { self->request_finished_listener = v; }
+void Cronet_UrlRequestParams_request_finished_executor_set(Cronet_UrlRequestParamsPtr self, const Cronet_ExecutorPtr v) { self->request_finished_executor = v; }
+void Cronet_UrlRequestParams_idempotency_set(Cronet_UrlRequestParamsPtr self, const Cronet_UrlRequestParams_IDEMPOTENCY v) { self->idempotency = v; }
+Cronet_String Cronet_UrlRequestParams_http_method_get(const Cronet_UrlRequestParamsPtr self) { return self->http_method.c_str(); }
+uint32_t Cronet_UrlRequestParams_request_headers_size(const Cronet_UrlRequestParamsPtr self) { return (uint32_t)self->request_headers.size(); }
+Cronet_HttpHeaderPtr Cronet_UrlRequestParams_request_headers_at(const Cronet_UrlRequestParamsPtr self, uint32_t index) { return &self->request_headers[index]; }
+void Cronet_UrlRequestParams_request_headers_clear(Cronet_UrlRequestParamsPtr self) { self->request_headers.clear(); }
+bool Cronet_UrlRequestParams_disable_cache_get(const Cronet_UrlRequestParamsPtr self) { return self->disable_cache; }
+Cronet_UrlRequestParams_REQUEST_PRIORITY Cronet_UrlRequestParams_priority_get(const Cronet_UrlRequestParamsPtr self) { return self->priority; }
+Cronet_UploadDataProviderPtr Cronet_UrlRequestParams_upload_data_provider_get(const Cronet_UrlRequestParamsPtr self) { return self->upload_data_provider; }
+Cronet_ExecutorPtr Cronet_UrlRequestParams_upload_data_provider_executor_get(const Cronet_UrlRequestParamsPtr self) { return self->upload_data_provider_executor; }
+bool Cronet_UrlRequestParams_allow_direct_executor_get(const Cronet_UrlRequestParamsPtr self) { return self->allow_direct_executor; }
+uint32_t Cronet_UrlRequestParams_annotations_size(const Cronet_UrlRequestParamsPtr self) { return (uint32_t)self->annotations.size(); }
+Cronet_RawDataPtr Cronet_UrlRequestParams_annotations_at(const Cronet_UrlRequestParamsPtr self, uint32_t index) { return self->annotations[index]; }
+void Cronet_UrlRequestParams_annotations_clear(Cronet_UrlRequestParamsPtr self) { self->annotations.clear(); }
+Cronet_RequestFinishedInfoListenerPtr Cronet_UrlRequestParams_request_finished_listener_get(const Cronet_UrlRequestParamsPtr self) { return self->request_finished_listener; }
+Cronet_ExecutorPtr Cronet_UrlRequestParams_request_finished_executor_get(const Cronet_UrlRequestParamsPtr self) { return self->request_finished_executor; }
+Cronet_UrlRequestParams_IDEMPOTENCY Cronet_UrlRequestParams_idempotency_get(const Cronet_UrlRequestParamsPtr self) { return self->idempotency; }
+
+Cronet_DateTimePtr Cronet_DateTime_Create(void) { return new Cronet_DateTime; }
+void Cronet_DateTime_Destroy(Cronet_DateTimePtr self) { delete self; }
+void Cronet_DateTime_value_set(Cronet_DateTimePtr self, const int64_t value) { self->value = value; }
+int64_t Cronet_DateTime_value_get(const Cronet_DateTimePtr self) { return self->value; }
+
+// 未发生的阶段返回 nullptr，与真实 Cronet 一致
+static Cronet_DateTimePtr date_or_null(Cronet_DateTime& dt) {
+    return dt.value ? &dt : nullptr;
+}
+
+Cronet_MetricsPtr Cronet_Metrics_Create(void) { return new Cronet_Metrics; }
+void Cronet_Metrics_Destroy(Cronet_MetricsPtr self) { delete self; }
+Cronet_DateTimePtr Cronet_Metrics_request_start_get(const Cronet_MetricsPtr self) { return date_or_null(self->request_start); }
+Cronet_DateTimePtr Cronet_Metrics_dns_start_get(const Cronet_MetricsPtr self) { return date_or_null(self->dns_start); }
+Cronet_DateTimePtr Cronet_Metrics_dns_end_get(const Cronet_MetricsPtr self) { return date_or_null(self->dns_end); }
+Cronet_DateTimePtr Cronet_Metrics_connect_start_get(const Cronet_MetricsPtr self) { return date_or_null(self->connect_start); }
+Cronet_DateTimePtr Cronet_Metrics_connect_end_get(const Cronet_MetricsPtr self) { return date_or_null(self->connect_end); }
+Cronet_DateTimePtr Cronet_Metrics_ssl_start_get(const Cronet_MetricsPtr self) { return date_or_null(self->ssl_start); }
+Cronet_DateTimePtr Cronet_Metrics_ssl_end_get(const Cronet_MetricsPtr self) { return date_or_null(self->ssl_end); }
+Cronet_DateTimePtr Cronet_Metrics_sending_start_get(const Cronet_MetricsPtr self) { return date_or_null(self->sending_start); }
+Cronet_DateTimePtr Cronet_Metrics_sending_end_get(const Cronet_MetricsPtr self) { return date_or_null(self->sending_end); }
+Cronet_DateTimePtr Cronet_Metrics_push_start_get(const Cronet_MetricsPtr self) { return date_or_null(self->push_start); }
+Cronet_DateTimePtr Cronet_Metrics_push_end_get(const Cronet_MetricsPtr self) { return date_or_null(self->push_end); }
+Cronet_DateTimePtr Cronet_Metrics_response_start_get(const Cronet_MetricsPtr self) { return date_or_null(self->response_start); }
+Cronet_DateTimePtr Cronet_Metrics_request_end_get(const Cronet_MetricsPtr self) { return date_or_null(self->request_end); }
+bool Cronet_Metrics_socket_reused_get(const Cronet_MetricsPtr self) { return self->socket_reused; }
+int64_t Cronet_Metrics_sent_byte_count_get(const Cronet_MetricsPtr self) { return self->sent_byte_count; }
+int64_t Cronet_Metrics_received_byte_count_get(const Cronet_MetricsPtr self) { return self->received_byte_count; }
+
+Cronet_RequestFinishedInfoPtr Cronet_RequestFinishedInfo_Create(void) { return new Cronet_RequestFinishedInfo; }
+void Cronet_RequestFinishedInfo_Destroy(Cronet_RequestFinishedInfoPtr self) { delete self; }
+Cronet_MetricsPtr Cronet_RequestFinishedInfo_metrics_get(const Cronet_RequestFinishedInfoPtr self) { return self->has_metrics ? &self->metrics : nullptr; }
+uint32_t Cronet_RequestFinishedInfo_annotations_size(const Cronet_RequestFinishedInfoPtr self) { return (uint32_t)self->annotations.size(); }
+Cronet_RawDataPtr Cronet_RequestFinishedInfo_annotations_at(const Cronet_RequestFinishedInfoPtr self, uint32_t index) { return self->annotations[index]; }
+Cronet_RequestFinishedInfo_FINISHED_REASON Cronet_RequestFinishedInfo_finished_reason_get(const Cronet_RequestFinishedInfoPtr self) { return self->finished_reason; }
+
+// ---- bidirectional_stream（gRPC 用的双向流）----
+// 服务端把收到的数据原样回显；客户端写完 end_of_stream 且回显全部读走后流结束。
+// 流只能跑在 h2/h3 会话上，与 UrlRequest 共用同一 host 的会话。
+// 状态只在网络线程上访问，回调也在网络线程上同步调用（与 Cronet 一致）
+
+namespace {
+
+struct BidiStream {
+    Cronet_EnginePtr engine = nullptr;
+    bidirectional_stream handle;
+    bidirectional_stream_callback* callback = nullptr;
+    std::shared_ptr<BidiStream> self;   // 到 destroy 为止保持存活，定时任务另各持一份
+    ParsedUrl target;
+    std::string protocol;
+    bool auto_flush = true;
+    bool delay_headers = false;
+    bool headers_sent = false;
+    bool headers_received = false;
+    bool request_eos = false;           // 客户端不会再写（start 时或 write 带 end_of_stream）
+    bool response_eos = false;          // 服务端回显完毕
+    bool eos_read = false;              // 读端已收到 0 字节
+    bool destroyed = false;
+    std::atomic<bool> started{false};
+    std::atomic<bool> done{false};
+
+    struct Write {
+        const char* data;
+        int length;
+        bool eos;
+    };
+    std::deque<Write> pending;          // 已 write、未 flush
+    int writes_in_flight = 0;           // 已 flush、未回调 on_write_completed
+    int64_t echo_available = 0;         // 已回到客户端、未读走的字节
+    char* read_buffer = nullptr;        // 挂起的读
+    int read_capacity = 0;
+    bool read_in_progress = false;
+};
+
+BidiStream* bidi_of(bidirectional_stream* stream) {
+    return stream ? (BidiStream*)stream->obj : nullptr;
+}
+
+// 回调前检查：destroy 之后或流已结束时不再回调
+bool bidi_alive(const std::shared_ptr<BidiStream>& st) {
+    return !st->destroyed && !st->done;
+}
+
+void bidi_fail(const std::shared_ptr<BidiStream>& st, int net_error) {
+    if (!bidi_alive(st)) {
+        return;
+    }
+    st->done = true;
+    st->callback->on_failed(&st->handle, net_error);
+}
+
+void bidi_maybe_succeed(const std::shared_ptr<BidiStream>& st) {
+    if (!bidi_alive(st) || !st->eos_read || !st->request_eos || st->writes_in_flight > 0 || !st->pending.empty()) {
+        return;
+    }
+    st->done = true;
+    st->callback->on_succeded(&st->handle);
+}
+
+// 把已回到客户端的字节交给挂起的读；每次读耗时 read_ms
+void bidi_deliver_read(const std::shared_ptr<BidiStream>& st) {
+    if (!bidi_alive(st) || !st->read_buffer || st->read_in_progress || !st->headers_received) {
+        return;
+    }
+    if (st->echo_available == 0 && !st->response_eos) {
+        return;
+    }
+    int n = (int)std::min<int64_t>(st->echo_available, st->read_capacity);
+    st->echo_available -= n;
+    char* buffer = st->read_buffer;
+    st->read_buffer = nullptr;
+    st->read_in_progress = true;
+    st->engine->net->postDelayed(n > 0 ? st->engine->jitter(st->engine->cfg.read_ms) : 0, [st, buffer, n]() {
+        st->read_in_progress = false;
+        if (!bidi_alive(st)) {
+            return;
+        }
+        if (n == 0) {
+            st->eos_read = true;
+        }
+        st->callback->on_read_completed(&st->handle, buffer, n);
+        bidi_maybe_succeed(st);
+    });
+}
+
+// 请求头到达服务端后 ttfb_ms 回响应头；请求已结束时响应随即结束
+void bidi_schedule_response_headers(const std::shared_ptr<BidiStream>& st, double delay) {
+    st->engine->net->postDelayed(delay, [st]() {
+        if (!bidi_alive(st)) {
+            return;
+        }
+        st->headers_received = true;
+        bidirectional_stream_header header = {":status", "200"};
+        bidirectional_stream_header_array headers = {1, 1, &header};
+        st->callback->on_response_headers_received(&st->handle, &headers, st->protocol.c_str());
+        bidi_deliver_read(st);
+    });
+}
+
+// 在会话上发一个包：每个包付一次 send_ms（一次写 socket），同一会话上的包排队串行
+double bidi_send_packet(const std::shared_ptr<BidiStream>& st) {
+    Cronet_EnginePtr engine = st->engine;
+    HostPool& pool = engine->pools[st->target.host];
+    Clock::time_point now = Clock::now();
+    double wait = pool.send_free > now ? std::chrono::duration<double, std::milli>(pool.send_free - now).count() : 0;
+    double send = wait + engine->jitter(engine->cfg.send_ms);
+    pool.send_free = now + std::chrono::microseconds((int64_t)(send * 1000));
+    return send;
+}
+
+// 一次 flush 的数据（以及尚未发出的请求头）合在一个包里发出。
+// 数据到达服务端后再过 ttfb_ms 回显到客户端
+void bidi_flush(const std::shared_ptr<BidiStream>& st) {
+    if (!bidi_alive(st) || (st->pending.empty() && st->headers_sent)) {
+        return;
+    }
+    Cronet_EnginePtr engine = st->engine;
+    double send = bidi_send_packet(st);
+    double echo = send + engine->jitter(engine->cfg.ttfb_ms);
+    if (!st->headers_sent) {
+        st->headers_sent = true;
+        bidi_schedule_response_headers(st, echo);
+    }
+    std::vector<BidiStream::Write> batch(st->pending.begin(), st->pending.end());
+    st->pending.clear();
+    if (batch.empty()) {
+        return;
+    }
+    st->writes_in_flight += (int)batch.size();
+    int64_t bytes = 0;
+    bool eos = false;
+    for (size_t i = 0; i < batch.size(); ++ i) {
+        bytes += batch[i].length;
+        eos = eos || batch[i].eos;
+    }
+    engine->net->postDelayed(send, [st, batch]() {
+        for (size_t i = 0; i < batch.size(); ++ i) {
+            -- st->writes_in_flight;
+            if (bidi_alive(st)) {
+                st->callback->on_write_completed(&st->handle, batch[i].data);
+            }
+        }
+        bidi_maybe_succeed(st);
+    });
+    engine->net->postDelayed(echo, [st, bytes, eos]() {
+        st->echo_available += bytes;
+        if (eos) {
+            st->response_eos = true;
+        }
+        bidi_deliver_read(st);
+    });
+}
+
+// 会话就绪：不延迟请求头时先发出请求头，发出后回调 on_stream_ready
+void bidi_on_session(const std::shared_ptr<BidiStream>& st) {
+    if (!bidi_alive(st)) {
+        return;
+    }
+    Cronet_EnginePtr engine = st->engine;
+    if (st->delay_headers && !st->request_eos) {
+        st->callback->on_stream_ready(&st->handle);
+        return;
+    }
+    double send = bidi_send_packet(st);
+    st->headers_sent = true;
+    bidi_schedule_response_headers(st, send + engine->jitter(engine->cfg.ttfb_ms));
+    if (st->request_eos) {
+        // 没有请求体，服务端回完响应头即结束
+        st->response_eos = true;
+    }
+    engine->net->postDelayed(send, [st]() {
+        if (bidi_alive(st)) {
+            st->callback->on_stream_ready(&st->handle);
+        }
+    });
+}
+
+// 复用 host 上已有的 h2/h3 会话，没有时建一个（DNS + 连接 + TLS，QUIC 合并握手）
+void bidi_acquire_session(const std::shared_ptr<BidiStream>& st) {
+    Cronet_EnginePtr engine = st->engine;
+    HostPool& pool = engine->pools[st->target.host];
+    if (pool.session_ready) {
+        bidi_on_session(st);
+        return;
+    }
+    pool.stream_waiters.push_back([st]() { bidi_on_session(st); });
+    if (pool.session_connecting) {
+        return;
+    }
+    ++ pool.sockets;
+    pool.session_connecting = true;
+    double delay = engine->resolved[st->target.host] ? 0 : engine->jitter(engine->cfg.dns_ms);
+    if (st->protocol == "h3") {
+        delay += engine->jitter(std::max(engine->cfg.connect_ms, engine->cfg.ssl_ms));
+    }
+    else {
+        delay += engine->jitter(engine->cfg.connect_ms) + engine->jitter(engine->cfg.ssl_ms);
+    }
+    std::string host = st->target.host;
+    engine->net->postDelayed(delay, [engine, host]() {
+        engine->resolved[host] = true;
+        session_established(engine->pools[host]);
+    });
+}
+
+} // namespace
+
+stream_engine* Cronet_Engine_GetStreamEngine(Cronet_EnginePtr engine) {
+    engine->stream_api.obj = engine;
+    engine->stream_api.annotation = nullptr;
+    return &engine->stream_api;
+}
+
+bidirectional_stream* bidirectional_stream_create(stream_engine* engine, void* annotation,
+                                                  bidirectional_stream_callback* callback) {
+    if (!engine || !engine->obj || !callback) {
+        return nullptr;
+    }
+    std::shared_ptr<BidiStream> st = std::make_shared<BidiStream>();
+    st->engine = (Cronet_EnginePtr)engine->obj;
+    st->callback = callback;
+    st->handle.obj = st.get();
+    st->handle.annotation = annotation;
+    st->self = st;
+    return &st->handle;
+}
+
+int bidirectional_stream_destroy(bidirectional_stream* stream) {
+    BidiStream* raw = bidi_of(stream);
+    if (!raw) {
+        return -1;
+    }
+    std::shared_ptr<BidiStream> st = raw->self;
+    Cronet_EnginePtr engine = st->engine;
+    if (engine->net) {
+        engine->net->post([st]() {
+            st->destroyed = true;
+            st->self.reset();
+        });
+    }
+    else {
+        st->destroyed = true;
+        st->self.reset();
+    }
+    return 0;
+}
+
+void bidirectional_stream_disable_auto_flush(bidirectional_stream* stream, bool disable_auto_flush) {
+    BidiStream* st = bidi_of(stream);
+    if (st && !st->started) {
+        st->auto_flush = !disable_auto_flush;
+    }
+}
+
+void bidirectional_stream_delay_request_headers_until_flush(bidirectional_stream* stream,
+                                                            bool delay_headers_until_flush) {
+    BidiStream* st = bidi_of(stream);
+    if (st && !st->started) {
+        st->delay_headers = delay_headers_until_flush;
+    }
+}
+
+int bidirectional_stream_start(bidirectional_stream* stream, const char* url, int /* priority */,
+                               const char* /* method */, const bidirectional_stream_header_array* /* headers */,
+                               bool end_of_stream) {
+    BidiStream* raw = bidi_of(stream);
+    if (!raw || !url || !raw->engine->net || raw->started.exchange(true)) {
+        return -1;
+    }
+    std::shared_ptr<BidiStream> st = raw->self;
+    st->target = parse_url(url);
+    st->request_eos = end_of_stream;
+    st->engine->net->post([st]() {
+        st->protocol = protocol_for(st->engine, st->target);
+        if (st->protocol == "http/1.1") {
+            // 双向流需要 h2 或 QUIC
+            bidi_fail(st, -11);     // net::ERR_NOT_IMPLEMENTED
+            return;
+        }
+        bidi_acquire_session(st);
+    });
+    return 0;
+}
+
+int bidirectional_stream_read(bidirectional_stream* stream, char* buffer, int capacity) {
+    BidiStream* raw = bidi_of(stream);
+    if (!raw || !buffer || capacity <= 0 || !raw->engine->net) {
+        return false;
+    }
+    std::shared_ptr<BidiStream> st = raw->self;
+    st->engine->net->post([st, buffer, capacity]() {
+        st->read_buffer = buffer;
+        st->read_capacity = capacity;
+        bidi_deliver_read(st);
+    });
+    return true;
+}
+
+int bidirectional_stream_write(bidirectional_stream* stream, const char* buffer, int buffer_length,
+                               bool end_of_stream) {
+    BidiStream* raw = bidi_of(stream);
+    if (!raw || buffer_length < 0 || !raw->engine->net) {
+        return false;
+    }
+    std::shared_ptr<BidiStream> st = raw->self;
+    st->engine->net->post([st, buffer, buffer_length, end_of_stream]() {
+        if (!bidi_alive(st) || st->request_eos) {
+            return;
+        }
+        BidiStream::Write w = {buffer, buffer_length, end_of_stream};
+        st->pending.push_back(w);
+        if (end_of_stream) {
+            st->request_eos = true;
+        }
+        if (st->auto_flush) {
+            bidi_flush(st);
+        }
+    });
+    return true;
+}
+
+void bidirectional_stream_flush(bidirectional_stream* stream) {
+    BidiStream* raw = bidi_of(stream);
+    if (!raw || !raw->engine->net) {
+        return;
+    }
+    std::shared_ptr<BidiStream> st = raw->self;
+    st->engine->net->post([st]() { bidi_flush(st); });
+}
+
+void bidirectional_stream_cancel(bidirectional_stream* stream) {
+    BidiStream* raw = bidi_of(stream);
+    if (!raw || !raw->started || !raw->engine->net) {
+        return;
+    }
+    std::shared_ptr<BidiStream> st = raw->self;
+    st->engine->net->post([st]() {
+        if (bidi_alive(st)) {
+            st->done = true;
+            st->callback->on_canceled(&st->handle);
+        }
+    });
+}
+
+bool bidirectional_stream_is_done(bidirectional_stream* stream) {
+    BidiStream* st = bidi_of(stream);
+    return st && st->started && st->done;
+}
@@ -0,0 +1,76 @@
+#include "single_flight.h"
+
+SingleFlight::SingleFlight(const Workload& workload, Sink sink) : sink_(sink) {
+    std::map<std::string, int> ids;
+    keys_.resize(workload.endpoints.size(), -1);
+    for (size_t i = 0; i < workload.endpoints.size(); ++ i) {
+        const Endpoint& ep = workload.endpoints[i];
+        if (ep.method != "GET") {
+            continue;
+        }
+        std::string id = ep.url;
+        for (size_t h = 0; h < ep.headers.size(); ++ h) {
+            id += "\n" + ep.headers[h].first + ":" + ep.headers[h].second;
+        }
+        auto it = ids.insert(std::make_pair(id, (int)ids.size())).first;
+        keys_[i] = it->second;
+    }
+    key_count_ = ids.size();
+}
+
+Flight* SingleFlight::join(int key, void* waiter, bool* leader) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = open_.find(key);
+    if (it != open_.end()) {
+        Flight* flight = it->second;
+        flight->waiters.push_back(waiter);
+        joined_.fetch_add(1, std::memory_order_relaxed);
+        if (flight->waiters.size() > max_waiters_.load(std::memory_order_relaxed)) {
+            max_waiters_.store(flight->waiters.size(), std::memory_order_relaxed);
+        }
+        *leader = false;
+        return flight;
+    }
+    Flight* flight = new Flight;
+    flight->owner = this;
+    flight->key = key;
+    open_[key] = flight;
+    leaders_.fetch_add(1, std::memory_order_relaxed);
+    *leader = true;
+    return flight;
+}
+
+void SingleFlight::close(Flight* flight) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (flight->open) {
+        flight->open = false;
+        open_.erase(flight->key);
+    }
+}
+
+std::vector<void*> SingleFlight::finish(Flight* flight) {
+    close(flight);
+    std::vector<void*> waiters;
+    waiters.swap(flight->waiters);
+    delete flight;
+    return waiters;
+}
+
+void SingleFlight::fanout(Flight* flight, const char* data, uint64_t bytes) {
+    // 响应头之后 flight 已关闭，waiters 不再变化
+    for (size_t w = 0; w < flight->waiters.size(); ++ w) {
+        sink_(flight->waiters[w], data, bytes);
+    }
+    flight->delivered = true;
+    chunks_.fetch_add(1, std::memory_order_relaxed);
+    fanout_bytes_.fetch_add(flight->waiters.size() * bytes, std::memory_order_relaxed);
+}
+
+void SingleFlight::report(std::ostream& os) const {
+    uint64_t leaders = leaders_.load();
+    uint64_t joined = joined_.load();
+    os << "coalescing: " << key_count_ << " key(s), requests=" << leaders + joined << " sent=" << leaders
+       << " joined=" << joined << " (hit rate " << (leaders + joined ? 100.0 * joined / (leaders + joined) : 0)
+       << "%) max_waiters=" << max_waiters_.load() << " fanned out " << fanout_bytes_.load() << " bytes in "
+       << chunks_.load() << " chunk(s)" << std::endl;
+}
@@ -0,0 +1,69 @@
+#ifndef CRONET_CONN_STAT_SINGLE_FLIGHT_H
+#define CRONET_CONN_STAT_SINGLE_FLIGHT_H
+
+#include "workload.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+class SingleFlight;
+
+// 一次在途的合并请求。waiters 为调用方的上下文，只在加锁时追加；
+// 关闭后只有 leader 的回调线程读它
+struct Flight {
+    SingleFlight* owner = nullptr;
+    int key = -1;
+    bool open = true;
+    bool delivered = false;     // 已有 body 交给等待者，leader 失败后不能再从头重试
+    std::vector<void*> waiters;
+};
+
+// 相同 GET 的合并：同一时刻同一个 key 只有一个请求（leader）真正发出，之后到达的请求挂在它上面，
+// 不再访问源站。收到响应头前都可以加入；leader 读到的每块 body 以同一缓冲的指针与长度交给各等待者的 sink，
+// 不拷贝，数据只在 sink 调用期间有效。leader 结束时等待者随之结束
+class SingleFlight {
+public:
+    // 等待者收到一块 body：waiter 为 join 时传入的上下文
+    typedef std::function<void(void* waiter, const char* data, uint64_t bytes)> Sink;
+
+    // URL 与端点请求头都相同的 GET 端点共用一个 key
+    SingleFlight(const Workload& workload, Sink sink);
+
+    // 端点的合并 key，不参与合并时为 -1
+    int key(uint32_t endpoint) const { return keys_[endpoint]; }
+
+    // 有同 key 且仍可加入的 flight 时把 waiter 挂上去并返回它，*leader 为 false；
+    // 否则新建一个由调用方作为 leader 发出的 flight，*leader 为 true
+    Flight* join(int key, void* waiter, bool* leader);
+    // leader 收到响应头：之后的同 key 请求另起一个 flight
+    void close(Flight* flight);
+    // leader 结束：关闭 flight 并取出全部等待者，flight 随即释放
+    std::vector<void*> finish(Flight* flight);
+    // leader 读到一块 body：在 leader 的回调线程上依次交给各等待者的 sink
+    void fanout(Flight* flight, const char* data, uint64_t bytes);
+
+    uint64_t joined() const { return joined_.load(); }
+    void report(std::ostream& os) const;
+
+private:
+    SingleFlight(const SingleFlight&);
+    SingleFlight& operator=(const SingleFlight&);
+
+    Sink sink_;
+    std::vector<int> keys_;
+    size_t key_count_ = 0;
+    std::mutex mutex_;
+    std::map<int, Flight*> open_;       // 还可以加入的 flight
+    std::atomic<uint64_t> leaders_{0};
+    std::atomic<uint64_t> joined_{0};
+    std::atomic<uint64_t> chunks_{0};
+    std::atomic<uint64_t> fanout_bytes_{0};     // 交给等待者的字节数，即省下的源站流量
+    std::atomic<size_t> max_waiters_{0};
+};
+
+#endif // CRONET_CONN_STAT_SINGLE_FLIGHT_H
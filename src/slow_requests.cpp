@@ -0,0 +1,149 @@
+#include "slow_requests.h"
+#include "executor_thread.h"
+#include <algorithm>
+#include <iomanip>
+
+const char* trace_event_name(int type) {
+    switch (type) {
+    case TRACE_START: return "start";
+    case TRACE_REDIRECT: return "redirect";
+    case TRACE_RESPONSE_STARTED: return "response_started";
+    case TRACE_READ_COMPLETED: return "read_completed";
+    case TRACE_SUCCEEDED: return "succeeded";
+    case TRACE_FAILED: return "failed";
+    case TRACE_CANCELED: return "canceled";
+    case TRACE_FINISHED_LISTENER: return "finished_listener";
+    default: return "unknown";
+    }
+}
+
+void RequestTrace::reset() {
+    count_ = 0;
+    dropped_ = 0;
+}
+
+void RequestTrace::start() {
+    reset();
+    start_ = Clock::now();
+    add(TRACE_START);
+}
+
+void RequestTrace::add(TraceEventType type, uint64_t bytes) {
+    // 最后两格留给结束类事件，保证总耗时可用
+    size_t limit = type >= TRACE_SUCCEEDED ? kMaxEvents : kMaxEvents - 2;
+    if (count_ >= limit) {
+        ++ dropped_;
+        return;
+    }
+    uint64_t at = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start_).count();
+    TraceEvent& e = events_[count_ ++];
+    e.type = (uint8_t)type;
+    e.at_us = at > 0xffffffffULL ? 0xffffffffU : (uint32_t)at;
+    e.exec_wait_us = (uint32_t)std::min<uint64_t>(ExecutorThread::currentQueueWait(), 0xffffffffULL);
+    e.bytes = bytes;
+}
+
+static bool slower(const SlowRequest& a, const SlowRequest& b) {
+    return a.total_us > b.total_us;
+}
+
+SlowRequestReservoir::SlowRequestReservoir(size_t k, uint64_t interval_ms)
+    : k_(k ? k : 1), interval_us_((int64_t)interval_ms * 1000), epoch_(Clock::now()),
+      deadline_us_((int64_t)interval_ms * 1000) {
+}
+
+bool SlowRequestReservoir::offer(const RequestMetrics& m, const RequestTrace& trace) {
+    uint64_t total = trace.elapsedUs();
+    int64_t end_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        trace.startTime() - epoch_).count() + (int64_t)total;
+    if (total < threshold_us_.load(std::memory_order_relaxed) &&
+        end_us < deadline_us_.load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (end_us >= deadline_us_.load(std::memory_order_relaxed)) {
+        rotate(end_us);
+    }
+    if (current_.size() >= k_) {
+        if (total <= current_.front().total_us) {
+            return false;
+        }
+        std::pop_heap(current_.begin(), current_.end(), slower);
+        current_.pop_back();
+    }
+
+    SlowRequest r;
+    r.total_us = total;
+    r.metrics = m;
+    r.events.assign(trace.events(), trace.events() + trace.count());
+    r.dropped_events = trace.droppedEvents();
+    current_.push_back(r);
+    std::push_heap(current_.begin(), current_.end(), slower);
+    if (current_.size() >= k_) {
+        threshold_us_.store(current_.front().total_us, std::memory_order_relaxed);
+    }
+    admitted_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void SlowRequestReservoir::rotate(int64_t now_us) {
+    int64_t deadline = deadline_us_.load(std::memory_order_relaxed);
+    // 跳过的空周期不保留
+    previous_.swap(current_);
+    if (now_us >= deadline + interval_us_) {
+        previous_.clear();
+    }
+    current_.clear();
+    while (deadline <= now_us) {
+        deadline += interval_us_;
+    }
+    threshold_us_.store(0, std::memory_order_relaxed);
+    deadline_us_.store(deadline, std::memory_order_relaxed);
+}
+
+std::vector<SlowRequest> SlowRequestReservoir::slowest() const {
+    std::vector<SlowRequest> out;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        out = previous_.empty() ? current_ : previous_;
+    }
+    std::sort(out.begin(), out.end(), slower);
+    return out;
+}
+
+void SlowRequestReservoir::report(std::ostream& os) const {
+    std::vector<SlowRequest> slow = slowest();
+    std::ios::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << std::fixed << std::setprecision(3);
+    os << "slowest " << slow.size() << " requests (admitted " << admitted() << "):" << std::endl;
+    for (size_t i = 0; i < slow.size(); ++ i) {
+        const SlowRequest& r = slow[i];
+        const RequestMetrics& m = r.metrics;
+        os << "  #" << i + 1 << " " << r.total_us / 1000.0 << " ms " << m.url
+           << " status=" << m.http_status << " reason=" << m.finished_reason
+           << " error=" << m.error_code << " protocol=" << m.protocol
+           << " reused=" << (m.socket_reused ? 1 : 0) << std::endl;
+        os << "     phases(ms): dns=" << phase_ms(m.dns_start_ms, m.dns_end_ms)
+           << " connect=" << phase_ms(m.connect_start_ms, m.connect_end_ms)
+           << " ssl=" << phase_ms(m.ssl_start_ms, m.ssl_end_ms)
+           << " send=" << phase_ms(m.sending_start_ms, m.sending_end_ms)
+           << " ttfb=" << phase_ms(m.request_start_ms, m.response_start_ms)
+           << " total=" << phase_ms(m.request_start_ms, m.request_end_ms) << std::endl;
+        for (size_t j = 0; j < r.events.size(); ++ j) {
+            const TraceEvent& e = r.events[j];
+            os << "     +" << e.at_us / 1000.0 << " ms " << trace_event_name(e.type)
+               << " exec_wait=" << e.exec_wait_us / 1000.0 << " ms";
+            if (e.type == TRACE_READ_COMPLETED) {
+                os << " bytes=" << e.bytes;
+            }
+            os << std::endl;
+        }
+        if (r.dropped_events) {
+            os << "     (" << r.dropped_events << " events not kept)" << std::endl;
+        }
+    }
+    os.flags(flags);
+    os.precision(precision);
+}
@@ -0,0 +1,98 @@
+#ifndef CRONET_CONN_STAT_SLOW_REQUESTS_H
+#define CRONET_CONN_STAT_SLOW_REQUESTS_H
+
+#include "request_metrics.h"
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+enum TraceEventType {
+    TRACE_START = 0,
+    TRACE_REDIRECT,
+    TRACE_RESPONSE_STARTED,
+    TRACE_READ_COMPLETED,
+    TRACE_SUCCEEDED,
+    TRACE_FAILED,
+    TRACE_CANCELED,
+    TRACE_FINISHED_LISTENER,
+};
+
+const char* trace_event_name(int type);
+
+struct TraceEvent {
+    uint8_t type;
+    uint32_t at_us;         // 相对 TRACE_START
+    uint32_t exec_wait_us;  // 该回调在执行器队列中等待的时间
+    uint64_t bytes;         // TRACE_READ_COMPLETED 的 bytes_read
+};
+
+// 单个请求的回调时间线，只在请求自己的回调里写（同一执行器，无需加锁）。
+// 事件数有上限，超出的只计数，保证大响应的逐次 read 不会无限增长
+class RequestTrace {
+public:
+    typedef std::chrono::steady_clock Clock;
+    static const size_t kMaxEvents = 64;
+
+    RequestTrace() { reset(); }
+
+    void reset();
+    void start();
+    void add(TraceEventType type, uint64_t bytes = 0);
+
+    Clock::time_point startTime() const { return start_; }
+    // 最后一个事件相对开始的时间，即目前观察到的请求总耗时
+    uint64_t elapsedUs() const { return count_ ? events_[count_ - 1].at_us : 0; }
+    const TraceEvent* events() const { return events_; }
+    size_t count() const { return count_; }
+    uint64_t droppedEvents() const { return dropped_; }
+
+private:
+    Clock::time_point start_;
+    TraceEvent events_[kMaxEvents];
+    size_t count_;
+    uint64_t dropped_;
+};
+
+struct SlowRequest {
+    uint64_t total_us = 0;
+    RequestMetrics metrics;
+    std::vector<TraceEvent> events;
+    uint64_t dropped_events = 0;
+};
+
+// 每个统计周期保留最慢的 K 个请求的完整细节。
+// offer() 先用原子阈值（当前第 K 慢的耗时）做一次比较，绝大多数请求到此为止，不加锁也不拷贝
+class SlowRequestReservoir {
+public:
+    SlowRequestReservoir(size_t k, uint64_t interval_ms);
+
+    // 在 request finished listener 上调用，返回是否被收录
+    bool offer(const RequestMetrics& m, const RequestTrace& trace);
+
+    // 上一个完整周期的最慢请求（由慢到快）；尚无完整周期时为当前周期
+    std::vector<SlowRequest> slowest() const;
+    uint64_t admitted() const { return admitted_.load(std::memory_order_relaxed); }
+
+    void report(std::ostream& os) const;
+
+private:
+    typedef RequestTrace::Clock Clock;
+
+    void rotate(int64_t now_us);
+
+    const size_t k_;
+    const int64_t interval_us_;
+    const Clock::time_point epoch_;
+    std::atomic<uint64_t> threshold_us_{0};   // 当前周期已满 K 个后，其中最小的耗时
+    std::atomic<int64_t> deadline_us_;        // 当前周期结束时间，相对 epoch_
+    std::atomic<uint64_t> admitted_{0};
+
+    mutable std::mutex mutex_;
+    std::vector<SlowRequest> current_;      // 以 total_us 为键的最小堆
+    std::vector<SlowRequest> previous_;
+};
+
+#endif // CRONET_CONN_STAT_SLOW_REQUESTS_H
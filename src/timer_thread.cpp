@@ -0,0 +1,51 @@
+#include "timer_thread.h"
+
+TimerThread::TimerThread() : thread_([this]() { run(); }) {
+}
+
+TimerThread::~TimerThread() {
+    stop();
+}
+
+bool TimerThread::schedule(Clock::time_point due, std::function<void()> fn) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stop_) {
+            return false;
+        }
+        tasks_.insert(std::make_pair(due, std::move(fn)));
+    }
+    cond_.notify_all();
+    return true;
+}
+
+void TimerThread::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+        tasks_.clear();
+    }
+    cond_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void TimerThread::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_) {
+        if (tasks_.empty()) {
+            cond_.wait(lock);
+            continue;
+        }
+        if (tasks_.begin()->first > Clock::now()) {
+            cond_.wait_until(lock, tasks_.begin()->first);
+            continue;
+        }
+        std::function<void()> fn = std::move(tasks_.begin()->second);
+        tasks_.erase(tasks_.begin());
+        lock.unlock();
+        fn();
+        lock.lock();
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef CRONET_CONN_STAT_TIMER_THREAD_H
+#define CRONET_CONN_STAT_TIMER_THREAD_H
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+// 定时线程：任务到期后按时间顺序在该线程上执行。任务应很快返回，通常只是把工作投回某个执行器
+class TimerThread {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    TimerThread();
+    // 未到期的任务直接丢弃
+    ~TimerThread();
+
+    // 已 stop 时不接受任务，返回 false，调用方要自己收尾
+    bool schedule(Clock::time_point due, std::function<void()> fn);
+    // 丢弃未到期的任务并等线程退出，返回后不会再有任务执行；之后的 schedule 返回 false
+    void stop();
+
+private:
+    TimerThread(const TimerThread&);
+    TimerThread& operator=(const TimerThread&);
+
+    void run();
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::multimap<Clock::time_point, std::function<void()>> tasks_;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+#endif // CRONET_CONN_STAT_TIMER_THREAD_H
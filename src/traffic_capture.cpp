@@ -0,0 +1,233 @@
+#include "traffic_capture.h"
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+
+static const char kMagic[8] = {'C', 'C', 'S', 'T', 'R', 'F', '0', '1'};
+static const size_t kFlushBytes = 64 * 1024;
+
+static void put_varint(std::string* out, uint64_t v) {
+    while (v >= 0x80) {
+        out->push_back((char)(v | 0x80));
+        v >>= 7;
+    }
+    out->push_back((char)v);
+}
+
+static void put_signed(std::string* out, int64_t v) {
+    put_varint(out, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+static void put_string(std::string* out, const std::string& s) {
+    put_varint(out, s.size());
+    out->append(s);
+}
+
+// 逐字段读取，越界后 ok 置为 false
+struct Cursor {
+    const std::string& data;
+    size_t pos;
+    bool ok;
+
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (pos >= data.size()) {
+                ok = false;
+                return 0;
+            }
+            uint8_t b = (uint8_t)data[pos ++];
+            v |= (uint64_t)(b & 0x7f) << shift;
+            if (!(b & 0x80)) {
+                return v;
+            }
+        }
+        ok = false;
+        return 0;
+    }
+    int64_t signedVarint() {
+        uint64_t v = varint();
+        return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+    }
+    std::string string() {
+        uint64_t n = varint();
+        if (!ok || n > data.size() - pos) {
+            ok = false;
+            pos = data.size();
+            return std::string();
+        }
+        std::string s = data.substr(pos, (size_t)n);
+        pos += (size_t)n;
+        return s;
+    }
+};
+
+HistogramSnapshot TrafficRecording::latency() const {
+    LatencyHistogram hist;
+    for (size_t i = 0; i < requests.size(); ++ i) {
+        hist.record(requests[i].latency_us);
+    }
+    return hist.snapshot();
+}
+
+TrafficRecorder::TrafficRecorder() {
+}
+
+TrafficRecorder::~TrafficRecorder() {
+    close();
+}
+
+bool TrafficRecorder::open(const std::string& path, const Workload& workload) {
+    file_ = fopen(path.c_str(), "wb");
+    if (!file_) {
+        return false;
+    }
+    workload_ = &workload;
+    ids_.assign(workload.endpoints.size(), -1);
+    buffer_.assign(kMagic, sizeof(kMagic));
+    begin_ = std::chrono::steady_clock::now();
+    return true;
+}
+
+void TrafficRecorder::record(uint32_t endpoint, std::chrono::steady_clock::time_point started, uint64_t latency_us,
+                             const RequestMetrics& m) {
+    const int64_t phases[CapturedRequest::kPhaseCount] = {
+        phase_ms(m.dns_start_ms, m.dns_end_ms),
+        phase_ms(m.connect_start_ms, m.connect_end_ms),
+        phase_ms(m.ssl_start_ms, m.ssl_end_ms),
+        phase_ms(m.sending_start_ms, m.sending_end_ms),
+        phase_ms(m.request_start_ms, m.response_start_ms),
+        phase_ms(m.request_start_ms, m.request_end_ms),
+    };
+    int64_t offset_us = std::chrono::duration_cast<std::chrono::microseconds>(started - begin_).count();
+    if (offset_us < 0) {
+        offset_us = 0;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!file_ || endpoint >= ids_.size()) {
+        return;
+    }
+    if (ids_[endpoint] < 0) {
+        ids_[endpoint] = next_id_ ++;
+        buffer_.push_back('E');
+        put_string(&buffer_, workload_->endpoints[endpoint].method);
+        put_string(&buffer_, workload_->endpoints[endpoint].url);
+    }
+    buffer_.push_back('R');
+    put_signed(&buffer_, offset_us - (int64_t)last_offset_us_);
+    last_offset_us_ = (uint64_t)offset_us;
+    put_varint(&buffer_, (uint64_t)ids_[endpoint]);
+    put_signed(&buffer_, m.sent_bytes);
+    put_signed(&buffer_, m.body_bytes);
+    put_varint(&buffer_, (uint64_t)(m.http_status > 0 ? m.http_status : 0));
+    put_varint(&buffer_, (uint64_t)m.finished_reason);
+    for (int p = 0; p < CapturedRequest::kPhaseCount; ++ p) {
+        put_signed(&buffer_, phases[p]);
+    }
+    put_varint(&buffer_, latency_us);
+    ++ recorded_;
+    if (buffer_.size() >= kFlushBytes) {
+        flush();
+    }
+}
+
+void TrafficRecorder::flush() {
+    if (file_ && !buffer_.empty()) {
+        fwrite(buffer_.data(), 1, buffer_.size(), file_);
+        buffer_.clear();
+    }
+}
+
+void TrafficRecorder::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flush();
+    if (file_) {
+        fclose(file_);
+        file_ = nullptr;
+    }
+}
+
+bool load_traffic(const std::string& path, TrafficRecording* out, std::string* error) {
+    std::ifstream ifs(path.c_str(), std::ios::binary);
+    if (!ifs) {
+        *error = "cannot open " + path;
+        return false;
+    }
+    std::string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    if (data.size() < sizeof(kMagic) || memcmp(data.data(), kMagic, sizeof(kMagic)) != 0) {
+        *error = path + ": not a traffic recording";
+        return false;
+    }
+    Cursor c = {data, sizeof(kMagic), true};
+    int64_t offset_us = 0;
+    while (c.ok && c.pos < data.size()) {
+        char tag = data[c.pos ++];
+        if (tag == 'E') {
+            Endpoint ep;
+            ep.method = c.string();
+            ep.url = c.string();
+            if (c.ok) {
+                out->endpoints.push_back(ep);
+            }
+        }
+        else if (tag == 'R') {
+            CapturedRequest r;
+            offset_us += c.signedVarint();
+            r.offset_us = offset_us > 0 ? (uint64_t)offset_us : 0;
+            r.endpoint = (uint32_t)c.varint();
+            r.sent_bytes = c.signedVarint();
+            r.body_bytes = c.signedVarint();
+            r.http_status = (int32_t)c.varint();
+            r.reason = (uint8_t)c.varint();
+            for (int p = 0; p < CapturedRequest::kPhaseCount; ++ p) {
+                r.phase_ms[p] = (int32_t)c.signedVarint();
+            }
+            r.latency_us = c.varint();
+            if (c.ok && r.endpoint >= out->endpoints.size()) {
+                *error = path + ": request refers to undefined endpoint";
+                return false;
+            }
+            if (c.ok) {
+                out->requests.push_back(r);
+            }
+        }
+        else {
+            c.ok = false;
+        }
+    }
+    // 录制进程中途退出时最后一条可能不完整，直接丢掉；其它位置读不下去说明文件损坏
+    if (!c.ok && c.pos < data.size()) {
+        *error = path + ": corrupt record";
+        return false;
+    }
+    std::stable_sort(out->requests.begin(), out->requests.end(),
+                     [](const CapturedRequest& a, const CapturedRequest& b) { return a.offset_us < b.offset_us; });
+    return true;
+}
+
+void print_replay_diff(std::ostream& os, const HistogramSnapshot& recorded, const HistogramSnapshot& replayed) {
+    static const double kQuantiles[] = {0.50, 0.90, 0.99, 0.999};
+    static const char* kNames[] = {"p50", "p90", "p99", "p99.9"};
+    std::ios::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << "==== replay vs recording (ms) ====" << std::endl;
+    os << std::setw(8) << "" << std::setw(12) << "recorded" << std::setw(12) << "replayed" << std::setw(10) << "delta"
+       << std::endl;
+    os << std::fixed << std::setprecision(2);
+    for (int q = 0; q <= 4; ++ q) {
+        uint64_t a = q < 4 ? recorded.percentile(kQuantiles[q]) : recorded.max;
+        uint64_t b = q < 4 ? replayed.percentile(kQuantiles[q]) : replayed.max;
+        os << std::setw(8) << (q < 4 ? kNames[q] : "max") << std::setw(12) << a / 1000.0 << std::setw(12)
+           << b / 1000.0;
+        if (a > 0) {
+            os << std::setw(9) << std::showpos << ((double)b / a - 1) * 100 << std::noshowpos << "%";
+        }
+        os << std::endl;
+    }
+    os << "requests: recorded=" << recorded.count << " replayed=" << replayed.count << std::endl;
+    os.flags(flags);
+    os.precision(precision);
+}
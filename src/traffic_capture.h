@@ -0,0 +1,84 @@
+#ifndef CRONET_CONN_STAT_TRAFFIC_CAPTURE_H
+#define CRONET_CONN_STAT_TRAFFIC_CAPTURE_H
+
+#include "histogram.h"
+#include "request_metrics.h"
+#include "workload.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// 录制文件中的一个请求。阶段耗时单位为毫秒，-1 表示未发生
+struct CapturedRequest {
+    enum Phase { PHASE_DNS = 0, PHASE_CONNECT, PHASE_SSL, PHASE_SEND, PHASE_TTFB, PHASE_TOTAL, kPhaseCount };
+
+    uint64_t offset_us = 0;     // 相对录制开始的发起时间
+    uint32_t endpoint = 0;      // TrafficRecording::endpoints 的下标
+    int64_t sent_bytes = -1;
+    int64_t body_bytes = -1;
+    int32_t http_status = 0;
+    uint8_t reason = 0;         // Cronet_RequestFinishedInfo_FINISHED_REASON
+    int32_t phase_ms[kPhaseCount];
+    uint64_t latency_us = 0;    // 客户端观测的 Start -> terminal 回调
+
+    CapturedRequest() {
+        for (int p = 0; p < kPhaseCount; ++ p) {
+            phase_ms[p] = -1;
+        }
+    }
+};
+
+struct TrafficRecording {
+    std::vector<Endpoint> endpoints;        // 只有 method 与 url
+    std::vector<CapturedRequest> requests;  // 按 offset_us 排序
+
+    // 录制时客户端观测的延迟分布（微秒）
+    HistogramSnapshot latency() const;
+};
+
+// 录制文件是紧凑的二进制流：8 字节魔数 "CCSTRF01"，之后是一串记录，每条以一个标记字节开头：
+//   'E' 端点定义，下标按出现顺序递增：varint 长度 + method，varint 长度 + url
+//   'R' 请求：varint 字段，有符号值用 zigzag，offset 为与上一条请求的差值
+// 请求按结束顺序写入，读取后再按发起时间排序
+class TrafficRecorder {
+public:
+    TrafficRecorder();
+    ~TrafficRecorder();
+
+    // 录制开始时间为 open 的时刻
+    bool open(const std::string& path, const Workload& workload);
+    // finished listener 中调用，可在多个执行器线程上并发
+    void record(uint32_t endpoint, std::chrono::steady_clock::time_point started, uint64_t latency_us,
+                const RequestMetrics& m);
+    void close();
+
+    std::chrono::steady_clock::time_point begin() const { return begin_; }
+    uint64_t recorded() const { return recorded_; }
+
+private:
+    TrafficRecorder(const TrafficRecorder&);
+    TrafficRecorder& operator=(const TrafficRecorder&);
+
+    void flush();
+
+    FILE* file_ = nullptr;
+    const Workload* workload_ = nullptr;
+    std::chrono::steady_clock::time_point begin_;
+    std::mutex mutex_;
+    std::string buffer_;
+    std::vector<int64_t> ids_;      // workload 端点 -> 文件中的端点下标，-1 为尚未写出
+    uint32_t next_id_ = 0;
+    uint64_t last_offset_us_ = 0;
+    uint64_t recorded_ = 0;
+};
+
+bool load_traffic(const std::string& path, TrafficRecording* out, std::string* error);
+
+// 回放与录制的延迟分布逐个分位数对比
+void print_replay_diff(std::ostream& os, const HistogramSnapshot& recorded, const HistogramSnapshot& replayed);
+
+#endif // CRONET_CONN_STAT_TRAFFIC_CAPTURE_H
@@ -0,0 +1,224 @@
+#include "workload.h"
+#include <stdlib.h>
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+static std::string trim(const std::string& s) {
+    size_t b = s.find_first_not_of(" \t\r\n");
+    if (b == std::string::npos) {
+        return std::string();
+    }
+    size_t e = s.find_last_not_of(" \t\r\n");
+    return s.substr(b, e - b + 1);
+}
+
+bool parse_header(const std::string& text, std::pair<std::string, std::string>* out) {
+    size_t colon = text.find(':');
+    if (colon == std::string::npos || colon == 0) {
+        return false;
+    }
+    out->first = trim(text.substr(0, colon));
+    out->second = trim(text.substr(colon + 1));
+    return !out->first.empty();
+}
+
+static const char* kPriorities[] = {"idle", "lowest", "low", "medium", "highest"};
+
+int parse_priority(const std::string& name) {
+    for (int p = 0; p < 5; ++ p) {
+        if (name == kPriorities[p]) {
+            return p;
+        }
+    }
+    return -1;
+}
+
+const char* priority_name(int priority) {
+    return priority >= 0 && priority < 5 ? kPriorities[priority] : "default";
+}
+
+bool parse_endpoint(const std::string& line, Endpoint* out, std::string* error) {
+    std::istringstream is(line);
+    Endpoint ep;
+    if (!(is >> ep.method >> ep.url)) {
+        *error = "expect: METHOD URL [weight=N] [count=N] [header=Name:Value] [priority=P] [no-cache] [idempotent=yes|no] "
+                 "[class=NAME]";
+        return false;
+    }
+    if (ep.url.find("://") == std::string::npos) {
+        *error = "bad url " + ep.url;
+        return false;
+    }
+    std::string opt;
+    while (is >> opt) {
+        if (opt.compare(0, 7, "weight=") == 0) {
+            ep.weight = (uint32_t)strtoul(opt.c_str() + 7, nullptr, 10);
+        }
+        else if (opt.compare(0, 6, "count=") == 0) {
+            ep.count = strtoull(opt.c_str() + 6, nullptr, 10);
+        }
+        else if (opt.compare(0, 7, "header=") == 0) {
+            std::pair<std::string, std::string> h;
+            if (!parse_header(opt.substr(7), &h)) {
+                *error = "bad header " + opt;
+                return false;
+            }
+            ep.headers.push_back(h);
+        }
+        else if (opt.compare(0, 9, "priority=") == 0) {
+            std::string name = opt.substr(9);
+            ep.priority = parse_priority(name);
+            if (ep.priority < 0) {
+                *error = "bad priority " + name;
+                return false;
+            }
+        }
+        else if (opt == "no-cache") {
+            ep.disable_cache = true;
+        }
+        else if (opt == "idempotent=yes") {
+            ep.idempotency = 1;
+        }
+        else if (opt == "idempotent=no") {
+            ep.idempotency = 2;
+        }
+        else if (opt.compare(0, 6, "class=") == 0 && opt.size() > 6) {
+            ep.traffic_class = opt.substr(6);
+        }
+        else {
+            *error = "unknown option " + opt;
+            return false;
+        }
+    }
+    *out = ep;
+    return true;
+}
+
+bool load_workload(const std::string& path, Workload* out, std::string* error) {
+    std::ifstream ifs(path.c_str());
+    if (!ifs) {
+        *error = "cannot open " + path;
+        return false;
+    }
+    std::string line;
+    int lineno = 0;
+    while (std::getline(ifs, line)) {
+        ++ lineno;
+        line = trim(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::ostringstream where;
+        where << path << ":" << lineno << ": ";
+        if (line.compare(0, 9, "requests ") == 0) {
+            out->requests = strtoull(line.c_str() + 9, nullptr, 10);
+            continue;
+        }
+        if (line.compare(0, 7, "header ") == 0) {
+            std::pair<std::string, std::string> h;
+            if (!parse_header(line.substr(7), &h)) {
+                *error = where.str() + "bad header";
+                return false;
+            }
+            out->headers.push_back(h);
+            continue;
+        }
+        if (line.compare(0, 6, "class ") == 0) {
+            std::istringstream is(line.substr(6));
+            TrafficClass tc;
+            std::string opt;
+            is >> tc.name;
+            while (is >> opt) {
+                if (opt.compare(0, 9, "priority=") == 0 && (tc.priority = parse_priority(opt.substr(9))) >= 0) {
+                    continue;
+                }
+                *error = where.str() + "expect: class NAME [priority=P]";
+                return false;
+            }
+            if (tc.name.empty()) {
+                *error = where.str() + "expect: class NAME [priority=P]";
+                return false;
+            }
+            out->classes.push_back(tc);
+            continue;
+        }
+        Endpoint ep;
+        std::string err;
+        if (!parse_endpoint(line, &ep, &err)) {
+            *error = where.str() + err;
+            return false;
+        }
+        out->endpoints.push_back(ep);
+    }
+    if (out->endpoints.empty()) {
+        *error = path + ": no endpoint";
+        return false;
+    }
+    resolve_classes(out);
+    return true;
+}
+
+void resolve_classes(Workload* workload) {
+    for (size_t i = 0; i < workload->endpoints.size(); ++ i) {
+        Endpoint& ep = workload->endpoints[i];
+        if (ep.traffic_class.empty()) {
+            continue;
+        }
+        size_t c = 0;
+        while (c < workload->classes.size() && workload->classes[c].name != ep.traffic_class) {
+            ++ c;
+        }
+        if (c == workload->classes.size()) {
+            TrafficClass tc;
+            tc.name = ep.traffic_class;
+            workload->classes.push_back(tc);
+        }
+        ep.class_index = (int)c;
+        if (ep.priority < 0) {
+            ep.priority = workload->classes[c].priority;
+        }
+    }
+}
+
+uint64_t Workload::total() const {
+    uint64_t n = 0;
+    bool weighted = false;
+    for (size_t i = 0; i < endpoints.size(); ++ i) {
+        if (endpoints[i].count) {
+            n += endpoints[i].count;
+        }
+        else if (endpoints[i].weight) {
+            weighted = true;
+        }
+    }
+    return weighted ? n + requests : n;
+}
+
+std::vector<uint32_t> Workload::schedule(uint32_t seed) const {
+    std::vector<uint32_t> order;
+    order.reserve((size_t)total());
+    std::vector<uint32_t> weighted;
+    std::vector<double> weights;
+    for (size_t i = 0; i < endpoints.size(); ++ i) {
+        const Endpoint& ep = endpoints[i];
+        if (ep.count) {
+            order.insert(order.end(), (size_t)ep.count, (uint32_t)i);
+        }
+        else if (ep.weight) {
+            weighted.push_back((uint32_t)i);
+            weights.push_back(ep.weight);
+        }
+    }
+
+    std::mt19937 rng(seed);
+    if (!weighted.empty()) {
+        std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+        for (uint64_t n = 0; n < requests; ++ n) {
+            order.push_back(weighted[pick(rng)]);
+        }
+    }
+    std::shuffle(order.begin(), order.end(), rng);
+    return order;
+}
@@ -0,0 +1,69 @@
+#ifndef CRONET_CONN_STAT_WORKLOAD_H
+#define CRONET_CONN_STAT_WORKLOAD_H
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+// 一个请求端点。count > 0 时固定发这么多次，否则按 weight 从 Workload::requests 中分配
+struct Endpoint {
+    std::string method = "GET";
+    std::string url;
+    std::vector<std::pair<std::string, std::string>> headers;
+    uint32_t weight = 1;
+    uint64_t count = 0;
+    int priority = -1;              // Cronet_UrlRequestParams_REQUEST_PRIORITY，-1 为引擎默认
+    bool disable_cache = false;
+    int idempotency = 0;            // Cronet_UrlRequestParams_IDEMPOTENCY
+    std::string traffic_class;      // 所属负载类，按类统计延迟；为空时不属于任何类
+    int class_index = -1;           // 在 Workload::classes 中的下标，由 resolve_classes 填写
+
+    // 实际生效的优先级，未指定时为 Cronet 默认的 MEDIUM
+    int effectivePriority() const { return priority >= 0 ? priority : 3; }
+};
+
+// 负载类（如 interactive、bulk），类内端点没有单独指定 priority 时使用类的优先级
+struct TrafficClass {
+    std::string name;
+    int priority = -1;
+};
+
+// 负载描述文件，'#' 开头为注释，每行一项：
+//   requests 20000
+//   header User-Agent: Cronet-C-Client           （所有端点共用的请求头）
+//   GET http://httpbin.org/get weight=3
+//   HEAD http://httpbin.org/bytes/1024 count=500 header=Accept:*/*
+//   GET http://127.0.0.1:8080/json priority=highest no-cache idempotent=yes
+//   class interactive priority=highest           （定义负载类及其优先级）
+//   GET http://127.0.0.1:8080/item weight=1 class=interactive
+struct Workload {
+    uint64_t requests = 0;      // 按权重分配的请求总数，不含固定 count 的端点
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::vector<Endpoint> endpoints;
+    std::vector<TrafficClass> classes;
+
+    // 展开为端点下标序列：固定次数的端点加上按权重随机抽取的请求，整体打乱。
+    // 同一 seed 得到同样的序列，便于对比不同配置
+    std::vector<uint32_t> schedule(uint32_t seed) const;
+    uint64_t total() const;
+};
+
+// "Name: Value" 或 "Name:Value"
+bool parse_header(const std::string& text, std::pair<std::string, std::string>* out);
+
+// 解析一行端点描述："METHOD URL [weight=N] [count=N] [header=Name:Value]... [priority=P] [no-cache]
+// [idempotent=yes|no] [class=NAME]"，P 为 idle/lowest/low/medium/highest
+bool parse_endpoint(const std::string& line, Endpoint* out, std::string* error);
+
+// 优先级名字转 Cronet_UrlRequestParams_REQUEST_PRIORITY，未知名字返回 -1
+int parse_priority(const std::string& name);
+const char* priority_name(int priority);
+
+// 把端点的 class=NAME 对应到 classes，未定义的类按引擎默认优先级补上；
+// 没有单独指定 priority 的端点继承类的优先级
+void resolve_classes(Workload* workload);
+
+bool load_workload(const std::string& path, Workload* out, std::string* error);
+
+#endif // CRONET_CONN_STAT_WORKLOAD_H